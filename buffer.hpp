@@ -141,28 +141,30 @@ public:
 		this->data.resize(size);
 	}
 	
+	// each index is only written by one side, so the other side's index needs acquiring
+	// and our own store releasing, no more
 	bool push(T &&value) {
-		auto writePos = mTail.load();
+		auto writePos = mTail.load(std::memory_order_relaxed);
 		auto nextWritePos = (writePos + 1) % this->mSize;
 		
-		if (nextWritePos != mHead.load()) {
+		if (nextWritePos != mHead.load(std::memory_order_acquire)) {
 			this->data[writePos] = value;
-			mTail.store(nextWritePos);
+			mTail.store(nextWritePos, std::memory_order_release);
 			return true;
 		}
 		return false;
 	}
 	
 	bool pop(T &output) {
-		auto readPos = mHead.load();
-		if (readPos == mTail.load()) {
+		auto readPos = mHead.load(std::memory_order_relaxed);
+		if (readPos == mTail.load(std::memory_order_acquire)) {
 			return false;
 		}
 		
 		auto nextReadPos = (readPos + 1) % this->mSize;
 		
 		output = std::move(this->data[readPos]);
-		mHead.store(nextReadPos);
+		mHead.store(nextReadPos, std::memory_order_release);
 		return true;
 	}
 	
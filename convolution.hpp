@@ -0,0 +1,258 @@
+#pragma once
+
+#include "whelpersg/dsp.h"
+#include "whelpersg/buffer.h"
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <algorithm>
+
+namespace dsp {
+
+#ifdef USE_FFTW
+
+/// Uniformly partitioned overlap-save convolution.
+/// The impulse response is cut into blockSize partitions which are transformed once,
+/// incoming blocks are transformed once and kept in a frequency-domain delay line,
+/// so every block costs one forward FFT, one inverse FFT and a complex multiply-add
+/// per partition. Latency is one block whatever the length of the impulse response.
+class PartitionedConvolver {
+public:
+
+	PartitionedConvolver(): mBlockSize(0), mNumBins(0), mNumPartitions(0), mFDLHead(0) {}
+
+	PartitionedConvolver(const float *ir, size_t irLength, size_t blockSize): PartitionedConvolver() {
+		setImpulseResponse(ir, irLength, blockSize);
+	}
+
+	PartitionedConvolver(const std::vector<float> &ir, size_t blockSize): PartitionedConvolver() {
+		setImpulseResponse(ir, blockSize);
+	}
+
+	void setImpulseResponse(const std::vector<float> &ir, size_t blockSize) {
+		setImpulseResponse(ir.data(), ir.size(), blockSize);
+	}
+
+	void setImpulseResponse(const float *ir, size_t irLength, size_t blockSize) {
+
+		mBlockSize = blockSize;
+		mNumBins = mBlockSize + 1; // (2 * blockSize) / 2 + 1
+		mNumPartitions = std::max<size_t>(1, (irLength + mBlockSize - 1) / mBlockSize);
+
+		if (!mFFT || mFFT->getSize() != mBlockSize * 2) {
+			mFFT = std::unique_ptr<RealFFT>(new RealFFT(mBlockSize * 2));
+		}
+		// we scale once in the inverse so the spectra can be multiplied directly
+		mFFT->setNormalisesOutput(false);
+
+		mIRSpectra.assign(mNumPartitions * mNumBins, 0);
+		std::vector<float> partition(mBlockSize * 2, 0);
+
+		for (size_t p = 0; p < mNumPartitions; p++) {
+
+			size_t start = p * mBlockSize;
+			size_t end = std::min(start + mBlockSize, irLength);
+
+			std::fill(partition.begin(), partition.end(), 0.0f);
+			std::copy(ir + start, ir + end, partition.begin());
+
+			mFFT->forward(&partition[0]);
+			const auto &spectrum = mFFT->getOutput();
+			std::copy(spectrum.begin(), spectrum.end(), mIRSpectra.begin() + p * mNumBins);
+		}
+
+		mFDL.assign(mNumPartitions * mNumBins, 0);
+		mAccumulator.assign(mNumBins, 0);
+		mInputBuffer.assign(mBlockSize * 2, 0);
+		mFDLHead = 0;
+	}
+
+	/// input and output must hold getBlockSize() samples, they may be the same buffer
+	void process(const float *input, float *output) {
+
+		std::copy(input, input + mBlockSize, mInputBuffer.begin() + mBlockSize);
+		mFFT->forward(&mInputBuffer[0]);
+
+		// the FDL is a ring, newest spectrum at the head, the one from p blocks ago at head + p
+		mFDLHead = (mFDLHead + mNumPartitions - 1) % mNumPartitions;
+		const auto &spectrum = mFFT->getOutput();
+		std::copy(spectrum.begin(), spectrum.end(), mFDL.begin() + mFDLHead * mNumBins);
+
+		std::fill(mAccumulator.begin(), mAccumulator.end(), 0.0f);
+
+		// plain float pointers so the multiply-add vectorises without complex NaN checks
+		float *acc = reinterpret_cast<float*>(&mAccumulator[0]);
+		const size_t N = mNumBins * 2;
+
+		for (size_t p = 0; p < mNumPartitions; p++) {
+			size_t slot = (mFDLHead + p) % mNumPartitions;
+			const float *x = reinterpret_cast<const float*>(&mFDL[slot * mNumBins]);
+			const float *h = reinterpret_cast<const float*>(&mIRSpectra[p * mNumBins]);
+
+			for (size_t i = 0; i < N; i+= 2) {
+				acc[i] += x[i] * h[i] - x[i+1] * h[i+1];
+				acc[i+1] += x[i] * h[i+1] + x[i+1] * h[i];
+			}
+		}
+
+		mFFT->inverse(mAccumulator);
+
+		// overlap-save: only the second half is free of circular wrap
+		const auto &result = mFFT->getInput();
+		std::copy(mInputBuffer.begin() + mBlockSize, mInputBuffer.end(), mInputBuffer.begin());
+		std::copy(result.begin() + mBlockSize, result.end(), output);
+	}
+
+	void process(const std::vector<float> &input, std::vector<float> &output) {
+		output.resize(mBlockSize);
+		process(&input[0], &output[0]);
+	}
+
+	void reset() {
+		std::fill(mFDL.begin(), mFDL.end(), 0.0f);
+		std::fill(mInputBuffer.begin(), mInputBuffer.end(), 0.0f);
+		mFDLHead = 0;
+	}
+
+	size_t getBlockSize() const { return mBlockSize; }
+	size_t getNumPartitions() const { return mNumPartitions; }
+	size_t getLatency() const { return mBlockSize; }
+
+protected:
+	size_t mBlockSize, mNumBins, mNumPartitions, mFDLHead;
+	std::unique_ptr<RealFFT> mFFT;
+
+	std::vector<std::complex<float>> mIRSpectra; // partition major, mNumBins each
+	std::vector<std::complex<float>> mFDL; // same layout as mIRSpectra
+	std::vector<std::complex<float>> mAccumulator;
+	std::vector<float> mInputBuffer; // previous block followed by the current one
+};
+
+
+/// Non-uniformly partitioned convolution for long impulse responses.
+/// The head of the response is handled by a convolver running at the host block size,
+/// later segments by convolvers with larger blocks (4x each time) which are far cheaper
+/// per sample. A segment that starts at offset d can use any block size up to d + blockSize
+/// and still be on time, its output is just held back in a FIFO until it is due.
+/// NB: larger stages do all of their work in the callback that completes their block,
+/// so the cost is lower on average but spikier than the uniform convolver.
+class NonUniformConvolver {
+public:
+
+	NonUniformConvolver(): mBlockSize(0) {}
+
+	NonUniformConvolver(const std::vector<float> &ir, size_t blockSize, size_t maxBlockSize=8192): NonUniformConvolver() {
+		setImpulseResponse(ir.data(), ir.size(), blockSize, maxBlockSize);
+	}
+
+	void setImpulseResponse(const std::vector<float> &ir, size_t blockSize, size_t maxBlockSize=8192) {
+		setImpulseResponse(ir.data(), ir.size(), blockSize, maxBlockSize);
+	}
+
+	void setImpulseResponse(const float *ir, size_t irLength, size_t blockSize, size_t maxBlockSize=8192) {
+
+		mBlockSize = blockSize;
+		mStages.clear();
+		mTemp.resize(mBlockSize);
+
+		const size_t growth = 4;
+		size_t offset = 0, stageSize = mBlockSize;
+
+		do {
+			size_t remaining = irLength > offset ? irLength - offset : 0;
+			size_t nextSize = stageSize * growth;
+			size_t length;
+
+			if (nextSize > maxBlockSize || remaining <= nextSize) {
+				// last stage takes the rest
+				length = std::max(remaining, stageSize);
+			}
+			else {
+				// cover enough that the next, larger stage can be on time
+				size_t needed = nextSize - mBlockSize - offset;
+				length = std::max<size_t>(1, (needed + stageSize - 1) / stageSize) * stageSize;
+				length = std::min(length, remaining);
+			}
+
+			std::unique_ptr<Stage> stage(new Stage());
+			stage->offset = offset;
+			stage->convolver.setImpulseResponse(ir + std::min(offset, irLength), std::min(length, remaining), stageSize);
+			stage->input.resize(stageSize, 0);
+			stage->output.resize(stageSize, 0);
+			stage->inputCount = 0;
+
+			if (offset > 0) {
+				stage->fifo.resize(offset + stageSize + 1);
+				for (size_t i = 0; i < offset; i++) {
+					stage->fifo.push(0.0f);
+				}
+			}
+			mStages.push_back(std::move(stage));
+
+			offset+= length;
+			stageSize = nextSize;
+
+		} while (offset < irLength && stageSize <= maxBlockSize);
+	}
+
+	/// input and output must hold getBlockSize() samples, they may be the same buffer
+	void process(const float *input, float *output) {
+
+		std::copy(input, input + mBlockSize, mTemp.begin());
+		std::fill(output, output + mBlockSize, 0.0f);
+
+		for (auto &stage : mStages) {
+
+			auto &s = *stage;
+
+			if (s.offset == 0) {
+				// the head runs at the host block size, no buffering needed
+				s.convolver.process(&mTemp[0], &s.output[0]);
+				for (size_t i = 0; i < mBlockSize; i++) {
+					output[i]+= s.output[i];
+				}
+				continue;
+			}
+
+			std::copy(mTemp.begin(), mTemp.end(), s.input.begin() + s.inputCount);
+			s.inputCount+= mBlockSize;
+
+			if (s.inputCount == s.input.size()) {
+				s.convolver.process(&s.input[0], &s.output[0]);
+				s.fifo.push(&s.output[0], s.output.size());
+				s.inputCount = 0;
+			}
+
+			for (size_t i = 0; i < mBlockSize; i++) {
+				output[i]+= s.fifo.pop();
+			}
+		}
+	}
+
+	void process(const std::vector<float> &input, std::vector<float> &output) {
+		output.resize(mBlockSize);
+		process(&input[0], &output[0]);
+	}
+
+	size_t getBlockSize() const { return mBlockSize; }
+	size_t getLatency() const { return mBlockSize; }
+	size_t getNumStages() const { return mStages.size(); }
+
+protected:
+
+	struct Stage {
+		PartitionedConvolver convolver;
+		size_t offset, inputCount;
+		std::vector<float> input, output;
+		whg::RingBuffer<float> fifo;
+	};
+
+	size_t mBlockSize;
+	std::vector<std::unique_ptr<Stage>> mStages;
+	std::vector<float> mTemp;
+};
+
+#endif // end USE_FFTW
+
+} // namespace dsp
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "whelpersg/dsp.h"
+#include "whelpersg/audio.h"
+#include "whelpersg/simd.h"
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <cmath>
+
+namespace dsp {
+
+#ifdef USE_FFTW
+
+/// The longest kernel, Q * sampleRate / minFrequency samples with Q = 1 / (2^(1 / binsPerOctave) - 1),
+/// sets the FFT size each frame needs. The defaults, 12 bins per octave over 6 octaves from
+/// 130.8Hz, need 8192 at 44.1kHz where 36 bins per octave from 65.4Hz would need 65536.
+/// Each halving of minFrequency or doubling of binsPerOctave doubles it. That bigger FFT is
+/// most of the cost, so a frame costs a few times chromaFilterbank's on a 2048 point FFT
+/// (test/bench_cqt measures both) for chroma that gets the notes right where the filterbank
+/// often doesn't; chroma moves slowly, so a longer hop than the other features' claws it back
+struct ConstantQSettings {
+	uint sampleRate = 44100;
+	uint binsPerOctave = 12;
+	uint numBins = 12 * 6;
+	double minFrequency = audio::C0_frequency * 4;
+	float sparsity = 0.0054f; // spectral kernel values under this fraction of the kernel's peak are dropped
+};
+
+
+/// Spectral kernels for the Brown & Puckette constant-Q transform, each row is the
+/// conjugated FFT of a windowed complex exponential, trimmed to the bins that matter.
+/// Kernels are built once per settings and shared, see get().
+struct ConstantQKernel {
+
+	size_t fftSize;
+	std::vector<size_t> starts, lengths, offsets;
+
+	// interleaved complex weights, and the same with re/im swapped so the
+	// complex multiply-add is two plain float multiply-adds
+	whg::AlignedVector<float> weights, swappedWeights;
+
+	static std::shared_ptr<const ConstantQKernel> get(const ConstantQSettings &s) {
+
+		static std::mutex mutex;
+		static std::map<std::tuple<uint, uint, uint, double, float>, std::shared_ptr<const ConstantQKernel>> registry;
+
+		auto key = std::make_tuple(s.sampleRate, s.binsPerOctave, s.numBins, s.minFrequency, s.sparsity);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = registry.find(key);
+		if (it != registry.end()) {
+			return it->second;
+		}
+
+		std::shared_ptr<const ConstantQKernel> kernel = std::make_shared<const ConstantQKernel>(s);
+		registry.emplace(key, kernel);
+		return kernel;
+	}
+
+	ConstantQKernel(const ConstantQSettings &s) {
+
+		const double Q = 1.0 / (std::pow(2.0, 1.0 / s.binsPerOctave) - 1.0);
+		const size_t longest = static_cast<size_t>(std::ceil(Q * s.sampleRate / s.minFrequency));
+
+		fftSize = 1;
+		while (fftSize < longest) fftSize<<= 1;
+
+		RealFFT fft(fftSize);
+		fft.setNormalisesOutput(false);
+
+		const size_t nbins = fftSize / 2 + 1;
+		std::vector<float> real(fftSize), imag(fftSize);
+		std::vector<std::complex<float>> spectrum(nbins);
+
+		for (uint k = 0; k < s.numBins; k++) {
+
+			double frequency = s.minFrequency * std::pow(2.0, static_cast<double>(k) / s.binsPerOctave);
+			size_t length = static_cast<size_t>(std::ceil(Q * s.sampleRate / frequency));
+			size_t start = (fftSize - length) / 2; // centred so all kernels share a phase reference
+
+			std::fill(real.begin(), real.end(), 0.0f);
+			std::fill(imag.begin(), imag.end(), 0.0f);
+
+			for (size_t n = 0; n < length; n++) {
+				double hamming = 0.54 - 0.46 * std::cos(2.0 * PI * n / (length - 1.0));
+				double theta = 2.0 * PI * Q * n / length;
+				real[start + n] = hamming / length * std::cos(theta);
+				imag[start + n] = hamming / length * std::sin(theta);
+			}
+
+			// FFT(re + i im) = FFT(re) + i FFT(im), only the positive half is needed for real input
+			fft.forward(&real[0]);
+			spectrum = fft.getOutput();
+			fft.forward(&imag[0]);
+			const auto &imagSpectrum = fft.getOutput();
+
+			float peak = 0;
+			for (size_t j = 0; j < nbins; j++) {
+				spectrum[j]+= std::complex<float>(0, 1) * imagSpectrum[j];
+				peak = std::max(peak, std::abs(spectrum[j]));
+			}
+
+			float threshold = peak * s.sparsity;
+			size_t first = 0, last = nbins;
+			while (first < last && std::abs(spectrum[first]) <= threshold) first++;
+			while (last > first && std::abs(spectrum[last-1]) <= threshold) last--;
+
+			starts.push_back(first);
+			lengths.push_back(last - first);
+			offsets.push_back(weights.size());
+
+			for (size_t j = first; j < last; j++) {
+				auto w = std::conj(spectrum[j]);
+				weights.push_back(w.real());
+				weights.push_back(w.imag());
+				swappedWeights.push_back(w.imag());
+				swappedWeights.push_back(w.real());
+			}
+		}
+	}
+
+	size_t getNumBins() const { return starts.size(); }
+};
+
+
+/// Constant-Q magnitudes and chroma from FFT frames of getFFTSize()
+class ConstantQ {
+public:
+
+	ConstantQ(ConstantQSettings s=ConstantQSettings()): mSettings(s) {
+		mKernel = ConstantQKernel::get(s);
+		mMagnitudes.resize(mKernel->getNumBins());
+	}
+
+	size_t getFFTSize() const { return mKernel->fftSize; }
+	size_t getNumBins() const { return mKernel->getNumBins(); }
+
+	/// spectrum is the output of a normalising RealFFT of getFFTSize(), ie getFFTSize() / 2 + 1 bins
+	void transform(const std::complex<float> *spectrum, float *magnitudes) const {
+
+		const float *x = reinterpret_cast<const float*>(spectrum);
+		const auto &k = *mKernel;
+
+		for (size_t bin = 0; bin < k.getNumBins(); bin++) {
+
+			const float *xs = x + 2 * k.starts[bin];
+			const float *w = &k.weights[k.offsets[bin]];
+			const float *ws = &k.swappedWeights[k.offsets[bin]];
+			const size_t N = 2 * k.lengths[bin];
+
+			// real parts alternate sign in products, imaginary parts all add
+			whg::simd::float4 products(0.0f), crossProducts(0.0f);
+			size_t i = 0;
+			for (; i + 4 <= N; i+= 4) {
+				auto xv = whg::simd::float4::load(xs + i);
+				products+= xv * whg::simd::float4::load(w + i);
+				crossProducts+= xv * whg::simd::float4::load(ws + i);
+			}
+
+			float p[4], c[4];
+			products.store(p);
+			crossProducts.store(c);
+			float real = p[0] - p[1] + p[2] - p[3];
+			float imag = c[0] + c[1] + c[2] + c[3];
+
+			for (; i < N; i+= 2) {
+				real+= xs[i] * w[i] - xs[i+1] * w[i+1];
+				imag+= xs[i] * ws[i] + xs[i+1] * ws[i+1];
+			}
+
+			magnitudes[bin] = std::sqrt(real * real + imag * imag);
+		}
+	}
+
+	const std::vector<float>& transform(const std::vector<std::complex<float>> &spectrum) {
+		transform(&spectrum[0], &mMagnitudes[0]);
+		return mMagnitudes;
+	}
+
+	/// folds constant-Q magnitudes into numChromas pitch classes, index 0 is C
+	void chroma(const float *magnitudes, float *output, uint numChromas=12) const {
+
+		std::fill(output, output + numChromas, 0.0f);
+
+		// where the first bin sits relative to C, in chroma steps
+		const double offset = audio::ftoo(mSettings.minFrequency) * numChromas;
+		const double step = static_cast<double>(numChromas) / mSettings.binsPerOctave;
+
+		for (size_t bin = 0; bin < getNumBins(); bin++) {
+			long c = std::lround(offset + bin * step) % static_cast<long>(numChromas);
+			output[c < 0 ? c + numChromas : c]+= magnitudes[bin];
+		}
+	}
+
+	std::vector<float> chroma(const std::vector<std::complex<float>> &spectrum, uint numChromas=12) {
+		std::vector<float> output(numChromas);
+		transform(&spectrum[0], &mMagnitudes[0]);
+		chroma(&mMagnitudes[0], &output[0], numChromas);
+		return output;
+	}
+
+	const std::vector<float>& getMagnitudes() const { return mMagnitudes; }
+
+	double frequencyForBin(size_t bin) const {
+		return mSettings.minFrequency * std::pow(2.0, static_cast<double>(bin) / mSettings.binsPerOctave);
+	}
+
+protected:
+	ConstantQSettings mSettings;
+	std::shared_ptr<const ConstantQKernel> mKernel;
+	std::vector<float> mMagnitudes;
+};
+
+#endif // end USE_FFTW
+
+} // namespace dsp
@@ -5,8 +5,15 @@
 #include <cmath>
 #include <complex>
 #include <type_traits>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 #include "whelpersg/audio.h"
+#include "whelpersg/simd.h"
 
 
 #ifndef PI
@@ -20,70 +27,101 @@ template <typename T>
 class window {
 public:
 	using FuncType = std::function<void(T *, size_t)>;
+	using Table = whg::AlignedVector<T>;
+	using TablePtr = std::shared_ptr<const Table>;
 	
-	static FuncType createBartlett() {
-		return [](T * input, size_t N) {
-			for (size_t i = 0; i < N; i++) {
-				input[i]*= 1.0 - std::abs(2.0 * i / (N - 1.0) - 1.0);
-
+	enum class Type { BARTLETT, WELCH, HANN, BLACKMAN };
+	
+	/// the parameter a window type uses when none is given (only Blackman has one, alpha)
+	static double defaultParameter(Type type) {
+		return type == Type::BLACKMAN ? 0.16 : 0.0;
+	}
+	
+	/// immutable lookup table for a window, built once per (type, size, parameter)
+	/// and shared by everyone that asks for it, safe to call from any thread
+	static TablePtr get(Type type, size_t N, double param) {
+		
+		static std::mutex mutex;
+		static std::map<std::tuple<Type, size_t, double>, TablePtr> registry;
+		
+		auto key = std::make_tuple(type, N, param);
+		
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = registry.find(key);
+		if (it != registry.end()) {
+			return it->second;
+		}
+		
+		TablePtr table = std::make_shared<const Table>(build(type, N, param));
+		registry.emplace(key, table);
+		return table;
+	}
+	
+	static TablePtr get(Type type, size_t N) {
+		return get(type, N, defaultParameter(type));
+	}
+	
+	/// the function keeps the table it last used and only goes back to get() when N changes,
+	/// so like any FuncType it's one per thread (setWindowFunc() takes a copy)
+	static FuncType create(Type type, double param) {
+		TablePtr table;
+		return [type, param, table](T * input, size_t N) mutable {
+			if (!table || table->size() != N) {
+				table = get(type, N, param);
 			}
+			whg::simd::multiply(table->data(), input, input, N);
 		};
 	}
 	
-	static FuncType createWelch() {
-		return [](T * input, size_t N) {
-			
-			static std::vector<T> lookup;
-			if (lookup.size() != N) {
-				lookup.resize(N);
-				T nm1o2 = (N - 1.0) / 2.0, temp;
+	static FuncType createBartlett() { return create(Type::BARTLETT, 0); }
+	
+	static FuncType createWelch() { return create(Type::WELCH, 0); }
+	
+	static FuncType createHann() { return create(Type::HANN, 0); }
+	
+	static FuncType createBlackman(double alpha=0.16) { return create(Type::BLACKMAN, alpha); }
+	
+protected:
+	
+	static Table build(Type type, size_t N, double param) {
+		
+		Table lookup(N);
+		double nm1 = N > 1 ? N - 1.0 : 1.0;
+		
+		switch (type) {
+			case Type::BARTLETT:
+				for (size_t i = 0; i < N; i++) {
+					lookup[i] = 1.0 - std::abs(2.0 * i / nm1 - 1.0);
+				}
+				break;
+				
+			case Type::WELCH: {
+				double nm1o2 = nm1 / 2.0, temp;
 				for (size_t i = 0; i < N; i++) {
 					temp = (i - nm1o2) / nm1o2;
 					lookup[i] = 1.0 - temp * temp;
 				}
+				break;
 			}
-		
-			for (size_t i = 0; i < N; i++) {
-				input[i]*= lookup[i];
-			}
-		};
-	}
-	
-	static FuncType createHann() {
-		return [](T * input, size_t N) {
-			
-			static std::vector<T> lookup;
-			if (lookup.size() != N) {
-				lookup.resize(N);
+				
+			case Type::HANN:
 				for (size_t i = 0; i < N; i++) {
-					lookup[i] = 0.5 * (1.0 - std::cos(2.0 * PI * i / (N - 1.0)));
+					lookup[i] = 0.5 * (1.0 - std::cos(2.0 * PI * i / nm1));
 				}
-			}
-			
-			for (size_t i = 0; i < N; i++) {
-				input[i]*= lookup[i];
-			}
-		};
-	}
-	
-	static FuncType createBlackman(float alpha=0.16) {
-		return [alpha](T * input, size_t N) {
-			
-			static std::vector<T> lookup;
-			if (lookup.size() != N) {
-				lookup.resize(N);
-				double a0 = (1.0-alpha)/2.0, a1 = 0.5, a2 = alpha / 2.0;
+				break;
+				
+			case Type::BLACKMAN: {
+				double a0 = (1.0 - param) / 2.0, a1 = 0.5, a2 = param / 2.0;
 				double theta;
 				for (size_t i = 0; i < N; i++) {
-					theta = 2 * PI * i / (N - 1);
-					lookup[i] = a0 - a1 * std::cos(theta) + a2 * std::cos(theta* 2.0);
+					theta = 2 * PI * i / nm1;
+					lookup[i] = a0 - a1 * std::cos(theta) + a2 * std::cos(theta * 2.0);
 				}
+				break;
 			}
-			
-			for (size_t i = 0; i < N; i++) {
-				input[i]*= lookup[i];
-			}
-		};
+		}
+		
+		return lookup;
 	}
 
 };
@@ -94,12 +132,49 @@ template <typename T>
 class WindowMixin {
 	
 public:
-	WindowMixin(): mWindowFunc(nullptr) {}
+	WindowMixin(): mWindowFunc(nullptr), mHasWindowType(false) {}
+	
+	void setWindowFunc(typename window<T>::FuncType func) {
+		mWindowFunc = func;
+		clearWindow();
+	}
 	
-	void setWindowFunc(typename window<T>::FuncType func) { mWindowFunc = func; }
+	/// windows set by type come from the registry and are applied while the input is copied in
+	void setWindow(typename window<T>::Type type, double param) {
+		mWindowFunc = nullptr;
+		mWindowType = type;
+		mWindowParam = param;
+		mHasWindowType = true;
+		mWindowTable.reset();
+	}
+	
+	void setWindow(typename window<T>::Type type) {
+		setWindow(type, window<T>::defaultParameter(type));
+	}
+	
+	void clearWindow() {
+		mHasWindowType = false;
+		mWindowTable.reset();
+	}
 
 protected:
-	 typename window<T>::FuncType mWindowFunc;
+	typename window<T>::FuncType mWindowFunc;
+	
+	typename window<T>::TablePtr mWindowTable;
+	typename window<T>::Type mWindowType;
+	double mWindowParam;
+	bool mHasWindowType;
+	
+	/// nullptr when no window type is set
+	const T* getWindowTable(size_t N) {
+		if (!mHasWindowType) {
+			return nullptr;
+		}
+		if (!mWindowTable || mWindowTable->size() != N) {
+			mWindowTable = window<T>::get(mWindowType, N, mWindowParam);
+		}
+		return mWindowTable->data();
+	}
 };
 
 
@@ -218,6 +293,9 @@ public:
 	void forward(InputIterator begin, InputIterator end) {
 	
 		mInput.assign(begin, end);
+		if (auto table = getWindowTable(mSize)) {
+			whg::simd::multiply(table, &mInput[0], &mInput[0], mSize);
+		}
 		forwardExecute();
 	}
 	
@@ -229,11 +307,22 @@ public:
 	
 	void forward(const inputType &input) {
 		
-		forward(input.begin(), input.end());
+		if (input.size() == mSize) {
+			forward(&input[0]);
+		}
+		else {
+			forward(input.begin(), input.end());
+		}
 	}
 	
 	void forward(const float *input) {
-		std::copy(input, input + mSize, mInput.begin());
+		if (auto table = getWindowTable(mSize)) {
+			// window as we copy, no separate pass
+			whg::simd::multiply(input, table, &mInput[0], mSize);
+		}
+		else {
+			std::copy(input, input + mSize, mInput.begin());
+		}
 		forwardExecute();
 	}
 	
@@ -278,6 +367,9 @@ protected:
 		tOutput = (fftwf_complex*) fftwf_malloc(outputSize * sizeof(fftwf_complex));
 #endif
 		
+		// only fftwf_execute is thread safe, planning has to take turns
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
+		
 		mForwardPlan = fftwf_plan_dft_r2c_1d(static_cast<int>(mSize),
 									  static_cast<float*>(&mInput[0]),
 #ifdef FFTW_COPY_OUTPUT
@@ -298,11 +390,17 @@ protected:
 
 	}
 	
+	static std::mutex& getPlannerMutex() {
+		static std::mutex mutex;
+		return mutex;
+	}
+	
 	void destroy() {
 #ifdef FFTW_COPY_OUTPUT
 		fftwf_free(tOutput);
 #endif
 
+		std::lock_guard<std::mutex> lock(getPlannerMutex());
 		fftwf_destroy_plan(mForwardPlan);
 		fftwf_destroy_plan(mInversePlan);
 		
@@ -322,7 +420,7 @@ protected:
 		
 		if (mNormalisesOutput) {
 			float size = static_cast<float>(mSize);
-			for (size_t i = 0; i < mSize; i++) {
+			for (size_t i = 0; i < mOutput.size(); i++) {
 				mOutput[i]  /= size;
 			}
 		}
@@ -332,7 +430,7 @@ protected:
 
 		if (!mNormalisesOutput) {
 			float size = static_cast<float>(mSize);
-			for (size_t i = 0; i < mSize; i++) {
+			for (size_t i = 0; i < mOutput.size(); i++) {
 				mOutput[i]  /= size;
 			}
 		}
@@ -509,6 +607,61 @@ inline std::vector<std::vector<T>> melFilterbank(MelFilterSettings s) {
 	return output;
 }
 
+/// a filterbank keeping only the non-zero run of bins in each band,
+/// so applying it costs the size of the bands instead of numBands * nbins
+template <typename T>
+class SparseFilterbank {
+public:
+	
+	SparseFilterbank(): mNumBins(0) {}
+	
+	/// bands are rows of the dense matrix, weights at or below threshold are dropped
+	SparseFilterbank(const std::vector<std::vector<T>> &dense, T threshold=0) {
+		
+		mNumBins = dense.empty() ? 0 : dense[0].size();
+		mStarts.resize(dense.size());
+		mLengths.resize(dense.size());
+		mOffsets.resize(dense.size());
+		
+		for (size_t band = 0; band < dense.size(); band++) {
+			
+			const auto &row = dense[band];
+			size_t first = 0, last = row.size();
+			while (first < last && std::abs(row[first]) <= threshold) first++;
+			while (last > first && std::abs(row[last-1]) <= threshold) last--;
+			
+			mStarts[band] = first;
+			mLengths[band] = last - first;
+			mOffsets[band] = mWeights.size();
+			mWeights.insert(mWeights.end(), row.begin() + first, row.begin() + last);
+		}
+	}
+	
+	/// spectrum has getNumBins() values, output getNumBands()
+	void apply(const T *spectrum, T *output) const {
+		for (size_t band = 0; band < mStarts.size(); band++) {
+			output[band] = whg::simd::dot(&mWeights[0] + mOffsets[band], spectrum + mStarts[band], mLengths[band]);
+		}
+	}
+	
+	std::vector<T> apply(const std::vector<T> &spectrum) const {
+		std::vector<T> output(getNumBands());
+		apply(&spectrum[0], &output[0]);
+		return output;
+	}
+	
+	size_t getNumBands() const { return mStarts.size(); }
+	size_t getNumBins() const { return mNumBins; }
+	size_t getNumWeights() const { return mWeights.size(); }
+	
+protected:
+	size_t mNumBins;
+	std::vector<size_t> mStarts, mLengths, mOffsets;
+	whg::AlignedVector<T> mWeights;
+};
+
+#ifdef USE_FFTW
+
 template<typename T>
 std::vector<T> autocorrelate(const std::vector<T> &input) {
 	RealFFT fft(input.size());
@@ -519,4 +672,6 @@ std::vector<T> autocorrelate(const std::vector<T> &input) {
 	return fft.getInput();
 }
 
+#endif // end USE_FFTW
+
 } // namespace dsp
\ No newline at end of file
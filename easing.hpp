@@ -1,6 +1,16 @@
 #pragma once
 
 #include <deque>
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <string>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+
+#include "whelpersg/util.h"
+#include "whelpersg/simd.h"
 
 namespace whg {
 
@@ -41,6 +51,9 @@ protected:
 	template <typename U>
 	friend class EasingChain;
 	
+	template <typename U>
+	friend class KeyframeTrack;
+	
 };
 
 template <typename T>
@@ -102,6 +115,380 @@ public:
 };
 
 
+/// every curve of Robert Penner's set, for CurveEaser, KeyframeTrack and BatchEaser. HOLD keeps
+/// the segment's end value throughout, KeyframeTrack fills gaps between segments with it
+enum class EasingCurve : uint8_t {
+	LINEAR,
+	QUAD_IN, QUAD_OUT, QUAD_IN_OUT,
+	CUBIC_IN, CUBIC_OUT, CUBIC_IN_OUT,
+	QUART_IN, QUART_OUT, QUART_IN_OUT,
+	QUINT_IN, QUINT_OUT, QUINT_IN_OUT,
+	SINE_IN, SINE_OUT, SINE_IN_OUT,
+	EXPO_IN, EXPO_OUT, EXPO_IN_OUT,
+	CIRC_IN, CIRC_OUT, CIRC_IN_OUT,
+	ELASTIC_IN, ELASTIC_OUT, ELASTIC_IN_OUT,
+	BACK_IN, BACK_OUT, BACK_IN_OUT,
+	BOUNCE_IN, BOUNCE_OUT, BOUNCE_IN_OUT,
+	HOLD
+};
+
+const size_t numEasingCurves = static_cast<size_t>(EasingCurve::HOLD) + 1;
+
+
+/// Curve shapes over t in [0, 1], from 0 to 1 (back and elastic overshoot on the way), for
+/// float or simd::float4 so the easers and batch evaluation share them. Written without
+/// branches: the in-outs are the in for the first half and the out for the second, and outs
+/// are their in backwards, 1 - in(1 - t), unless there's something cheaper.
+/// Expo and elastic are scaled to reach 0 and 1 exactly instead of Penner's special cases at
+/// the ends (under 1e-3 apart), and the back and elastic in-outs keep the overshoot and period
+/// of the in rather than Penner's wider ones
+template <EasingCurve C> struct EasingShape;
+
+/// 1 - in(1 - t)
+template <EasingCurve In>
+struct EasingReversed {
+	template <class V> static V apply(V t) { return V(1.0f) - EasingShape<In>::apply(V(1.0f) - t); }
+};
+
+/// in(2t) / 2 then 1 / 2 + out(2t - 1) / 2
+template <EasingCurve In, EasingCurve Out>
+struct EasingInOut {
+	template <class V> static V apply(V t) {
+		using std::min;
+		using std::max;
+		V twice = t + t;
+		return V(0.5f) * (EasingShape<In>::apply(min(twice, V(1.0f))) + EasingShape<Out>::apply(max(twice - V(1.0f), V(0.0f))));
+	}
+};
+
+template <> struct EasingShape<EasingCurve::LINEAR> {
+	template <class V> static V apply(V t) { return t; }
+};
+
+template <> struct EasingShape<EasingCurve::QUAD_IN> {
+	template <class V> static V apply(V t) { return t * t; }
+};
+
+template <> struct EasingShape<EasingCurve::QUAD_OUT> {
+	template <class V> static V apply(V t) { return t * (V(2.0f) - t); }
+};
+
+template <> struct EasingShape<EasingCurve::QUAD_IN_OUT> {
+	// 2a^2 for the first half plus 2s(1 - s) for the second
+	template <class V> static V apply(V t) {
+		using std::min;
+		using std::max;
+		V a = min(t, V(0.5f)), s = max(t - V(0.5f), V(0.0f));
+		return V(2.0f) * a * a + V(2.0f) * s * (V(1.0f) - s);
+	}
+};
+
+template <> struct EasingShape<EasingCurve::CUBIC_IN> {
+	template <class V> static V apply(V t) { return t * t * t; }
+};
+
+template <> struct EasingShape<EasingCurve::QUART_IN> {
+	template <class V> static V apply(V t) { V t2 = t * t; return t2 * t2; }
+};
+
+template <> struct EasingShape<EasingCurve::QUINT_IN> {
+	template <class V> static V apply(V t) { V t2 = t * t; return t2 * t2 * t; }
+};
+
+template <> struct EasingShape<EasingCurve::SINE_IN> {
+	template <class V> static V apply(V t) { using std::cos; return V(1.0f) - cos(t * V(1.57079633f)); }
+};
+
+template <> struct EasingShape<EasingCurve::SINE_OUT> {
+	template <class V> static V apply(V t) { using std::sin; return sin(t * V(1.57079633f)); }
+};
+
+template <> struct EasingShape<EasingCurve::SINE_IN_OUT> {
+	template <class V> static V apply(V t) { using std::cos; return V(0.5f) - V(0.5f) * cos(t * V(3.14159265f)); }
+};
+
+/// (2^10t - 1) / 1023
+template <> struct EasingShape<EasingCurve::EXPO_IN> {
+	template <class V> static V apply(V t) { using std::exp2; return (exp2(t * V(10.0f)) - V(1.0f)) * V(1.0f / 1023.0f); }
+};
+
+template <> struct EasingShape<EasingCurve::CIRC_IN> {
+	template <class V> static V apply(V t) { using std::sqrt; return V(1.0f) - sqrt(V(1.0f) - t * t); }
+};
+
+template <> struct EasingShape<EasingCurve::CIRC_OUT> {
+	template <class V> static V apply(V t) { using std::sqrt; return sqrt(t * (V(2.0f) - t)); }
+};
+
+/// a sine of period 0.3 decaying as 2^-10t, the decay scaled like EXPO_IN so it ends on 0
+template <> struct EasingShape<EasingCurve::ELASTIC_OUT> {
+	template <class V> static V apply(V t) {
+		using std::sin;
+		V decay = EasingShape<EasingCurve::EXPO_IN>::apply(V(1.0f) - t);
+		return V(1.0f) + decay * sin((t * V(10.0f) - V(0.75f)) * V(2.09439510f));
+	}
+};
+
+/// Penner's 10% overshoot
+template <> struct EasingShape<EasingCurve::BACK_IN> {
+	template <class V> static V apply(V t) { return t * t * (V(2.70158f) * t - V(1.70158f)); }
+};
+
+/// four parabolas, the bounce at each t being the lowest of them
+template <> struct EasingShape<EasingCurve::BOUNCE_OUT> {
+	template <class V> static V apply(V t) {
+		using std::min;
+		const V n(7.5625f);
+		V a = t - V(1.5f / 2.75f), b = t - V(2.25f / 2.75f), c = t - V(2.625f / 2.75f);
+		return min(min(n * t * t, n * a * a + V(0.75f)), min(n * b * b + V(0.9375f), n * c * c + V(0.984375f)));
+	}
+};
+
+template <> struct EasingShape<EasingCurve::HOLD> {
+	template <class V> static V apply(V) { return V(1.0f); }
+};
+
+template <> struct EasingShape<EasingCurve::CUBIC_OUT> : EasingReversed<EasingCurve::CUBIC_IN> {};
+template <> struct EasingShape<EasingCurve::QUART_OUT> : EasingReversed<EasingCurve::QUART_IN> {};
+template <> struct EasingShape<EasingCurve::QUINT_OUT> : EasingReversed<EasingCurve::QUINT_IN> {};
+template <> struct EasingShape<EasingCurve::EXPO_OUT> : EasingReversed<EasingCurve::EXPO_IN> {};
+template <> struct EasingShape<EasingCurve::ELASTIC_IN> : EasingReversed<EasingCurve::ELASTIC_OUT> {};
+template <> struct EasingShape<EasingCurve::BACK_OUT> : EasingReversed<EasingCurve::BACK_IN> {};
+template <> struct EasingShape<EasingCurve::BOUNCE_IN> : EasingReversed<EasingCurve::BOUNCE_OUT> {};
+
+template <> struct EasingShape<EasingCurve::CUBIC_IN_OUT> : EasingInOut<EasingCurve::CUBIC_IN, EasingCurve::CUBIC_OUT> {};
+template <> struct EasingShape<EasingCurve::QUART_IN_OUT> : EasingInOut<EasingCurve::QUART_IN, EasingCurve::QUART_OUT> {};
+template <> struct EasingShape<EasingCurve::QUINT_IN_OUT> : EasingInOut<EasingCurve::QUINT_IN, EasingCurve::QUINT_OUT> {};
+template <> struct EasingShape<EasingCurve::EXPO_IN_OUT> : EasingInOut<EasingCurve::EXPO_IN, EasingCurve::EXPO_OUT> {};
+template <> struct EasingShape<EasingCurve::CIRC_IN_OUT> : EasingInOut<EasingCurve::CIRC_IN, EasingCurve::CIRC_OUT> {};
+template <> struct EasingShape<EasingCurve::ELASTIC_IN_OUT> : EasingInOut<EasingCurve::ELASTIC_IN, EasingCurve::ELASTIC_OUT> {};
+template <> struct EasingShape<EasingCurve::BACK_IN_OUT> : EasingInOut<EasingCurve::BACK_IN, EasingCurve::BACK_OUT> {};
+template <> struct EasingShape<EasingCurve::BOUNCE_IN_OUT> : EasingInOut<EasingCurve::BOUNCE_IN, EasingCurve::BOUNCE_OUT> {};
+
+
+/// calls Op<curve>()(args...) and returns what it does, so a curve known at runtime picks
+/// code compiled for it:
+/// template <EasingCurve C> struct Op { float operator()(float t) const { return EasingShape<C>::apply(t); } };
+/// withEasingCurve<Op>(curve, t)
+template <template <EasingCurve> class Op, class... Args>
+inline auto withEasingCurve(EasingCurve curve, Args&&... args) -> decltype(Op<EasingCurve::LINEAR>()(std::forward<Args>(args)...)) {
+#define WHG_EASING_CURVE_CASE(C) case EasingCurve::C: return Op<EasingCurve::C>()(std::forward<Args>(args)...);
+	switch (curve) {
+		WHG_EASING_CURVE_CASE(LINEAR)
+		WHG_EASING_CURVE_CASE(QUAD_IN) WHG_EASING_CURVE_CASE(QUAD_OUT) WHG_EASING_CURVE_CASE(QUAD_IN_OUT)
+		WHG_EASING_CURVE_CASE(CUBIC_IN) WHG_EASING_CURVE_CASE(CUBIC_OUT) WHG_EASING_CURVE_CASE(CUBIC_IN_OUT)
+		WHG_EASING_CURVE_CASE(QUART_IN) WHG_EASING_CURVE_CASE(QUART_OUT) WHG_EASING_CURVE_CASE(QUART_IN_OUT)
+		WHG_EASING_CURVE_CASE(QUINT_IN) WHG_EASING_CURVE_CASE(QUINT_OUT) WHG_EASING_CURVE_CASE(QUINT_IN_OUT)
+		WHG_EASING_CURVE_CASE(SINE_IN) WHG_EASING_CURVE_CASE(SINE_OUT) WHG_EASING_CURVE_CASE(SINE_IN_OUT)
+		WHG_EASING_CURVE_CASE(EXPO_IN) WHG_EASING_CURVE_CASE(EXPO_OUT) WHG_EASING_CURVE_CASE(EXPO_IN_OUT)
+		WHG_EASING_CURVE_CASE(CIRC_IN) WHG_EASING_CURVE_CASE(CIRC_OUT) WHG_EASING_CURVE_CASE(CIRC_IN_OUT)
+		WHG_EASING_CURVE_CASE(ELASTIC_IN) WHG_EASING_CURVE_CASE(ELASTIC_OUT) WHG_EASING_CURVE_CASE(ELASTIC_IN_OUT)
+		WHG_EASING_CURVE_CASE(BACK_IN) WHG_EASING_CURVE_CASE(BACK_OUT) WHG_EASING_CURVE_CASE(BACK_IN_OUT)
+		WHG_EASING_CURVE_CASE(BOUNCE_IN) WHG_EASING_CURVE_CASE(BOUNCE_OUT) WHG_EASING_CURVE_CASE(BOUNCE_IN_OUT)
+		default: return Op<EasingCurve::HOLD>()(std::forward<Args>(args)...);
+	}
+#undef WHG_EASING_CURVE_CASE
+}
+
+
+/// an easer with any of the curves, the quads have their own classes above
+template <EasingCurve C, typename T>
+class CurveEaser : public Easer<T> {
+public:
+
+	CurveEaser(float duration, T start, T end): Easer<T>(duration, start, end) {}
+	CurveEaser(float startTime, float endTime, T start, T end): Easer<T>(startTime, endTime, start, end) {}
+
+	T valueAt(float time) const override {
+		float t = clamp((time - this->mStartTime) / this->mTimeRange);
+		return this->mValueRange * EasingShape<C>::apply(t) + this->mStartValue;
+	}
+};
+
+template <typename T> using CubicInEaser = CurveEaser<EasingCurve::CUBIC_IN, T>;
+template <typename T> using CubicOutEaser = CurveEaser<EasingCurve::CUBIC_OUT, T>;
+template <typename T> using CubicInOutEaser = CurveEaser<EasingCurve::CUBIC_IN_OUT, T>;
+template <typename T> using QuartInEaser = CurveEaser<EasingCurve::QUART_IN, T>;
+template <typename T> using QuartOutEaser = CurveEaser<EasingCurve::QUART_OUT, T>;
+template <typename T> using QuartInOutEaser = CurveEaser<EasingCurve::QUART_IN_OUT, T>;
+template <typename T> using QuintInEaser = CurveEaser<EasingCurve::QUINT_IN, T>;
+template <typename T> using QuintOutEaser = CurveEaser<EasingCurve::QUINT_OUT, T>;
+template <typename T> using QuintInOutEaser = CurveEaser<EasingCurve::QUINT_IN_OUT, T>;
+template <typename T> using SineInEaser = CurveEaser<EasingCurve::SINE_IN, T>;
+template <typename T> using SineOutEaser = CurveEaser<EasingCurve::SINE_OUT, T>;
+template <typename T> using SineInOutEaser = CurveEaser<EasingCurve::SINE_IN_OUT, T>;
+template <typename T> using ExpoInEaser = CurveEaser<EasingCurve::EXPO_IN, T>;
+template <typename T> using ExpoOutEaser = CurveEaser<EasingCurve::EXPO_OUT, T>;
+template <typename T> using ExpoInOutEaser = CurveEaser<EasingCurve::EXPO_IN_OUT, T>;
+template <typename T> using CircInEaser = CurveEaser<EasingCurve::CIRC_IN, T>;
+template <typename T> using CircOutEaser = CurveEaser<EasingCurve::CIRC_OUT, T>;
+template <typename T> using CircInOutEaser = CurveEaser<EasingCurve::CIRC_IN_OUT, T>;
+template <typename T> using ElasticInEaser = CurveEaser<EasingCurve::ELASTIC_IN, T>;
+template <typename T> using ElasticOutEaser = CurveEaser<EasingCurve::ELASTIC_OUT, T>;
+template <typename T> using ElasticInOutEaser = CurveEaser<EasingCurve::ELASTIC_IN_OUT, T>;
+template <typename T> using BackInEaser = CurveEaser<EasingCurve::BACK_IN, T>;
+template <typename T> using BackOutEaser = CurveEaser<EasingCurve::BACK_OUT, T>;
+template <typename T> using BackInOutEaser = CurveEaser<EasingCurve::BACK_IN_OUT, T>;
+template <typename T> using BounceInEaser = CurveEaser<EasingCurve::BOUNCE_IN, T>;
+template <typename T> using BounceOutEaser = CurveEaser<EasingCurve::BOUNCE_OUT, T>;
+template <typename T> using BounceInOutEaser = CurveEaser<EasingCurve::BOUNCE_IN_OUT, T>;
+/// the end value throughout
+template <typename T> using HoldEaser = CurveEaser<EasingCurve::HOLD, T>;
+
+/// the easer class of a curve
+template <EasingCurve C, typename T> struct EaserOf { typedef CurveEaser<C, T> type; };
+template <typename T> struct EaserOf<EasingCurve::LINEAR, T> { typedef LinearEaser<T> type; };
+template <typename T> struct EaserOf<EasingCurve::QUAD_IN, T> { typedef QuadInEaser<T> type; };
+template <typename T> struct EaserOf<EasingCurve::QUAD_OUT, T> { typedef QuadOutEaser<T> type; };
+template <typename T> struct EaserOf<EasingCurve::QUAD_IN_OUT, T> { typedef QuadInOutEaser<T> type; };
+
+/// the curve of an easer class
+template <class EasingClass> struct EasingCurveOf;
+template <typename T> struct EasingCurveOf<LinearEaser<T>> { static const EasingCurve value = EasingCurve::LINEAR; };
+template <typename T> struct EasingCurveOf<QuadInEaser<T>> { static const EasingCurve value = EasingCurve::QUAD_IN; };
+template <typename T> struct EasingCurveOf<QuadOutEaser<T>> { static const EasingCurve value = EasingCurve::QUAD_OUT; };
+template <typename T> struct EasingCurveOf<QuadInOutEaser<T>> { static const EasingCurve value = EasingCurve::QUAD_IN_OUT; };
+template <EasingCurve C, typename T> struct EasingCurveOf<CurveEaser<C, T>> { static const EasingCurve value = C; };
+
+/// new EaserOf<C, T>::type(args...), for withEasingCurve
+template <typename T>
+struct MakeEaserOp {
+	template <EasingCurve C>
+	struct Curve {
+		template <typename... Args>
+		Easer<T>* operator()(Args&&... args) const {
+			return new typename EaserOf<C, T>::type(std::forward<Args>(args)...);
+		}
+	};
+};
+
+/// a new easer of curve's class, args as its constructors take them
+template <typename T, typename... Args>
+inline Easer<T>* makeEaser(EasingCurve curve, Args... args) {
+	return withEasingCurve<MakeEaserOp<T>::template Curve>(curve, args...);
+}
+
+
+/// The curves by the names of their easer classes, "LinearEaser", "QuadInEaser" ... "HoldEaser",
+/// as show files and EasingChain::extend() use them.
+/// Names are found with a perfect hash: the seed is searched for at compile time so each name
+/// gets its own slot, then a lookup is one hash and one compare with the name in that slot
+namespace easing {
+
+struct Name {
+	const char *name;
+	EasingCurve curve;
+};
+
+const size_t numNameSlots = 128;
+
+struct NameTable {
+	Name names[numEasingCurves];
+	size_t lengths[numEasingCurves];
+	uint8_t slots[numNameSlots]; // index into names + 1, 0 for no name
+	uint32_t seed;
+	bool isPerfect;
+};
+
+/// FNV-1a of the rest of name, h so far
+constexpr uint32_t hashFrom(const char *name, size_t N, uint32_t h) {
+	return N == 0 ? h : hashFrom(name + 1, N - 1, (h ^ static_cast<uint8_t>(name[0])) * 16777619u);
+}
+
+/// FNV-1a starting from the seed
+constexpr uint32_t hash(const char *name, size_t N, uint32_t seed) {
+	return hashFrom(name, N, 2166136261u ^ seed);
+}
+
+constexpr Name names[numEasingCurves] = {
+	{ "LinearEaser", EasingCurve::LINEAR },
+	{ "QuadInEaser", EasingCurve::QUAD_IN }, { "QuadOutEaser", EasingCurve::QUAD_OUT }, { "QuadInOutEaser", EasingCurve::QUAD_IN_OUT },
+	{ "CubicInEaser", EasingCurve::CUBIC_IN }, { "CubicOutEaser", EasingCurve::CUBIC_OUT }, { "CubicInOutEaser", EasingCurve::CUBIC_IN_OUT },
+	{ "QuartInEaser", EasingCurve::QUART_IN }, { "QuartOutEaser", EasingCurve::QUART_OUT }, { "QuartInOutEaser", EasingCurve::QUART_IN_OUT },
+	{ "QuintInEaser", EasingCurve::QUINT_IN }, { "QuintOutEaser", EasingCurve::QUINT_OUT }, { "QuintInOutEaser", EasingCurve::QUINT_IN_OUT },
+	{ "SineInEaser", EasingCurve::SINE_IN }, { "SineOutEaser", EasingCurve::SINE_OUT }, { "SineInOutEaser", EasingCurve::SINE_IN_OUT },
+	{ "ExpoInEaser", EasingCurve::EXPO_IN }, { "ExpoOutEaser", EasingCurve::EXPO_OUT }, { "ExpoInOutEaser", EasingCurve::EXPO_IN_OUT },
+	{ "CircInEaser", EasingCurve::CIRC_IN }, { "CircOutEaser", EasingCurve::CIRC_OUT }, { "CircInOutEaser", EasingCurve::CIRC_IN_OUT },
+	{ "ElasticInEaser", EasingCurve::ELASTIC_IN }, { "ElasticOutEaser", EasingCurve::ELASTIC_OUT }, { "ElasticInOutEaser", EasingCurve::ELASTIC_IN_OUT },
+	{ "BackInEaser", EasingCurve::BACK_IN }, { "BackOutEaser", EasingCurve::BACK_OUT }, { "BackInOutEaser", EasingCurve::BACK_IN_OUT },
+	{ "BounceInEaser", EasingCurve::BOUNCE_IN }, { "BounceOutEaser", EasingCurve::BOUNCE_OUT }, { "BounceInOutEaser", EasingCurve::BOUNCE_IN_OUT },
+	{ "HoldEaser", EasingCurve::HOLD }
+};
+
+const uint32_t numSeeds = 4096;
+
+constexpr size_t length(const char *name, size_t N = 0) {
+	return name[N] ? length(name, N + 1) : N;
+}
+
+constexpr size_t slotOf(size_t i, uint32_t seed) {
+	return hash(names[i].name, length(names[i].name), seed) % numNameSlots;
+}
+
+/// no name from j on shares i's slot
+constexpr bool hasOwnSlot(size_t i, size_t j, uint32_t seed) {
+	return j == numEasingCurves || (slotOf(i, seed) != slotOf(j, seed) && hasOwnSlot(i, j + 1, seed));
+}
+
+/// the names from i on are in order and each gets its own slot
+constexpr bool isPerfect(uint32_t seed, size_t i = 0) {
+	return i == numEasingCurves ||
+		(names[i].curve == static_cast<EasingCurve>(i) && hasOwnSlot(i, i + 1, seed) && isPerfect(seed, i + 1));
+}
+
+constexpr uint32_t findSeed(uint32_t first, uint32_t count);
+
+constexpr uint32_t findSeedUnless(uint32_t found, uint32_t first, uint32_t count) {
+	return found != numSeeds ? found : findSeed(first, count);
+}
+
+/// the first perfect seed of count from first, numSeeds for none; split in halves so the
+/// recursion is only log(count) deep
+constexpr uint32_t findSeed(uint32_t first, uint32_t count) {
+	return count == 1 ? (isPerfect(first) ? first : numSeeds) :
+		findSeedUnless(findSeed(first, count / 2), first + count / 2, count - count / 2);
+}
+
+/// index into names + 1 of the name in slot, 0 for none
+constexpr uint8_t nameInSlot(size_t slot, uint32_t seed, size_t i = 0) {
+	return i == numEasingCurves ? 0 : slotOf(i, seed) == slot ? static_cast<uint8_t>(i + 1) : nameInSlot(slot, seed, i + 1);
+}
+
+template <size_t... I, size_t... S>
+constexpr NameTable makeNameTable(uint32_t seed, Indices<I...>, Indices<S...>) {
+	return { { names[I]... }, { length(names[I].name)... }, { nameInSlot(S, seed)... }, seed, seed != numSeeds };
+}
+
+inline const NameTable& nameTable() {
+	static constexpr NameTable table = makeNameTable(findSeed(0, numSeeds),
+		MakeIndices<numEasingCurves>::Type(), MakeIndices<numNameSlots>::Type());
+	static_assert(table.isPerfect, "the curve names need a bigger table, or are out of order");
+	return table;
+}
+
+} // namespace easing
+
+/// the curve of an easer class name, false if there's no such easer
+inline bool easingCurveFromName(const char *className, size_t N, EasingCurve &curve) {
+	const auto &table = easing::nameTable();
+	const uint8_t slot = table.slots[easing::hash(className, N, table.seed) % easing::numNameSlots];
+	if (slot == 0 || table.lengths[slot - 1] != N || std::memcmp(table.names[slot - 1].name, className, N) != 0) {
+		return false;
+	}
+	curve = table.names[slot - 1].curve;
+	return true;
+}
+
+inline bool easingCurveFromName(const std::string &className, EasingCurve &curve) {
+	return easingCurveFromName(className.data(), className.size(), curve);
+}
+
+/// the easer class name of curve
+inline const char* getEasingCurveName(EasingCurve curve) {
+	return easing::nameTable().names[static_cast<size_t>(curve)].name;
+}
+
+
 template <typename T>
 class EasingChain : public Easer<T> {
 public:
@@ -115,17 +502,9 @@ public:
 	}
     
     void extend(std::string className, float duration, T endValue) {
-        if (className == "LinearEaser") {
-            add(new LinearEaser<T>(duration, mEasers.back()->mEndValue, endValue));
-        }
-        else if (className == "QuadInEaser") {
-            add(new QuadInEaser<T>(duration, mEasers.back()->mEndValue, endValue));
-        }
-        else if (className == "QuadOutEaser") {
-            add(new QuadOutEaser<T>(duration, mEasers.back()->mEndValue, endValue));
-        }
-        else if (className == "QuadInOutEaser") {
-            add(new QuadInOutEaser<T>(duration, mEasers.back()->mEndValue, endValue));
+        EasingCurve curve;
+        if (easingCurveFromName(className, curve)) {
+            add(makeEaser<T>(curve, duration, mEasers.back()->mEndValue, endValue));
         }
     }
 	
@@ -152,17 +531,9 @@ public:
     
     template<typename... Args>
     void add(std::string className, Args... args) {
-        if (className == "LinearEaser") {
-            add(new LinearEaser<T>(args...));
-        }
-        else if (className == "QuadInEaser") {
-            add(new QuadInEaser<T>(args...));
-        }
-        else if (className == "QuadOutEaser") {
-            add(new QuadOutEaser<T>(args...));
-        }
-        else if (className == "QuadInOutEaser") {
-            add(new QuadInOutEaser<T>(args...));
+        EasingCurve curve;
+        if (easingCurveFromName(className, curve)) {
+            add(makeEaser<T>(curve, args...));
         }
     }
 	
@@ -224,4 +595,412 @@ protected:
 };
 
 
+
+/// start + range * EasingShape<C>::apply(t), for withEasingCurve
+template <EasingCurve C>
+struct EaseOp {
+	template <typename T>
+	T operator()(float t, T start, T range) const {
+		return range * EasingShape<C>::apply(t) + start;
+	}
+};
+
+/// start + range * curve(t) for t in [0, 1], the same sums as the easers so the values match
+/// them exactly. QUAD_IN_OUT wants t in [0, 2] (time over half the duration) like QuadInOutEaser
+template <typename T>
+inline T ease(EasingCurve curve, float t, T start, T range) {
+	switch (curve) {
+		case EasingCurve::LINEAR: return range * t + start;
+		case EasingCurve::QUAD_IN: return range * t * t + start;
+		case EasingCurve::QUAD_OUT: return -range * t * (t - 2) + start;
+		case EasingCurve::QUAD_IN_OUT:
+			if (t < 1) {
+				return range / 2 * t * t + start;
+			}
+			--t;
+			return -range / 2 * (t * (t-2) - 1) + start;
+		case EasingCurve::HOLD: return start + range;
+		default:
+			return withEasingCurve<EaseOp>(curve, t, start, range);
+	}
+}
+
+
+/// A value-type replacement for EasingChain: keyframes in one flat vector instead of a
+/// deque of heap allocated, virtual easers, giving the same values.
+/// Keyframe 0 is the start, every following keyframe ends a segment eased from the one before
+/// with its curve. Segments that don't start where the last one ended get a HOLD keyframe in
+/// between, with the value EasingChain gives in the gap. (A segment starting before the last
+/// one ends is moved to start at its end.)
+/// valueAt() is a binary search, update() keeps a cursor so playing forwards costs O(1).
+template <typename T>
+class KeyframeTrack {
+public:
+
+	struct Keyframe {
+		float time;
+		T value;
+		EasingCurve curve;
+		float duration; // as given, (time - previous time) can be an ulp off
+	};
+
+	KeyframeTrack(): mCursor(1), mCurrentValue() {}
+
+	/// a track starting at value, extend() from there
+	KeyframeTrack(T value, float startTime=0): KeyframeTrack() {
+		mKeyframes.push_back({ startTime, value, EasingCurve::HOLD, 0 });
+	}
+
+	template <class EasingClass>
+	void extend(float duration, T endValue) {
+		extend(EasingCurveOf<EasingClass>::value, duration, endValue);
+	}
+
+	void extend(std::string className, float duration, T endValue) {
+		EasingCurve curve;
+		if (easingCurveFromName(className, curve)) {
+			extend(curve, duration, endValue);
+		}
+	}
+
+	/// from the end of the track, or from endValue at 0 if it's empty
+	void extend(EasingCurve curve, float duration, T endValue) {
+		add(curve, 0, duration, mKeyframes.empty() ? endValue : mKeyframes.back().value, endValue);
+	}
+
+	/// like EasingChain::add(), a segment starting at 0 goes on the end of the track
+	void add(EasingCurve curve, float startTime, float endTime, T start, T end) {
+
+		const float duration = endTime - startTime;
+
+		if (mKeyframes.empty()) {
+			mKeyframes.push_back({ startTime, start, EasingCurve::HOLD, 0 });
+		}
+		else {
+			const Keyframe last = mKeyframes.back();
+			if (startTime == 0) {
+				startTime = last.time;
+				endTime+= last.time;
+			}
+			startTime = std::max(startTime, last.time);
+			if (startTime != last.time || !(start == last.value)) {
+				mKeyframes.push_back({ startTime, start, EasingCurve::HOLD, startTime - last.time });
+			}
+		}
+
+		mKeyframes.push_back({ endTime, end, curve, duration });
+		mCursor = 1;
+	}
+
+	void add(EasingCurve curve, float duration, T start, T end) {
+		add(curve, 0, duration, start, end);
+	}
+
+	/// a copy of an easer, eg. add(QuadInEaser<float>(1, 0, 10))
+	template <class EasingClass, typename std::enable_if<std::is_base_of<Easer<T>, EasingClass>::value, int>::type=0>
+	void add(const EasingClass &easer) {
+		add(EasingCurveOf<EasingClass>::value, easer.mStartTime, easer.mStartTime + easer.mTimeRange,
+			easer.mStartValue, easer.mEndValue);
+		mKeyframes.back().duration = easer.mTimeRange;
+	}
+
+	template<typename... Args>
+	void add(std::string className, Args... args) {
+		EasingCurve curve;
+		if (easingCurveFromName(className, curve)) {
+			add(curve, args...);
+		}
+	}
+
+	T valueAt(float time) const {
+
+		if (mKeyframes.empty()) return T();
+		if (time >= mKeyframes.back().time) return mKeyframes.back().value;
+
+		// the first keyframe after time ends the segment time is in
+		auto it = std::upper_bound(mKeyframes.begin() + 1, mKeyframes.end(), time,
+								   [](float t, const Keyframe &k) { return t < k.time; });
+		return valueAt(time, it - mKeyframes.begin());
+	}
+
+	/// valueAt() but starting from where the last update() was, so O(1) for increasing times
+	T update(float time) {
+
+		const size_t N = mKeyframes.size();
+		if (N == 0) return mCurrentValue = T();
+
+		if (mCursor >= N || (mCursor > 1 && time < mKeyframes[mCursor - 1].time)) {
+			mCurrentValue = valueAt(time);
+			auto it = std::upper_bound(mKeyframes.begin() + 1, mKeyframes.end(), time,
+									   [](float t, const Keyframe &k) { return t < k.time; });
+			mCursor = it - mKeyframes.begin();
+			return mCurrentValue;
+		}
+
+		while (mCursor < N && time >= mKeyframes[mCursor].time) {
+			mCursor++;
+		}
+		mCurrentValue = mCursor < N ? valueAt(time, mCursor) : mKeyframes.back().value;
+		return mCurrentValue;
+	}
+
+	T getValue() const { return mCurrentValue; }
+
+	float getStartTime() const { return mKeyframes.empty() ? 0 : mKeyframes.front().time; }
+	float getEndTime() const { return mKeyframes.empty() ? 0 : mKeyframes.back().time; }
+	bool getHasEnded(float time) const { return time > getEndTime(); }
+
+	const std::vector<Keyframe>& getKeyframes() const { return mKeyframes; }
+
+	void reserve(size_t numSegments) { mKeyframes.reserve(numSegments + 1); }
+
+	/// keyframes as getKeyframes() gives them, eg. read from a file
+	void assign(const Keyframe *keyframes, size_t N) {
+		mKeyframes.assign(keyframes, keyframes + N);
+		mCursor = 1;
+	}
+
+	void clear() {
+		mKeyframes.clear();
+		mCursor = 1;
+	}
+
+	bool empty() const { return mKeyframes.size() < 2; }
+
+	/// number of segments, including any HOLDs filling gaps
+	size_t size() const { return mKeyframes.empty() ? 0 : mKeyframes.size() - 1; }
+
+protected:
+	std::vector<Keyframe> mKeyframes;
+	size_t mCursor; // the keyframe ending the segment of the last update()
+	T mCurrentValue;
+
+	/// in the segment ended by keyframe i
+	T valueAt(float time, size_t i) const {
+		const Keyframe &from = mKeyframes[i - 1], &to = mKeyframes[i];
+		if (to.curve == EasingCurve::HOLD) {
+			return to.value;
+		}
+		float t = to.curve == EasingCurve::QUAD_IN_OUT ?
+			clamp((time - from.time) / (to.duration / 2), 0.0f, 2.0f) :
+			clamp((time - from.time) / to.duration);
+		return ease(to.curve, t, from.value, to.value - from.value);
+	}
+};
+
+
+/// Thousands of float channels (pixels, DMX) each easing between two values, all evaluated
+/// in one update() instead of a virtual Easer::update() each.
+/// Channels are kept in one group per curve, each group's start times, 1 / durations, start
+/// values and ranges in their own arrays, so a group is evaluated four channels at a time
+/// with its curve's kernel and no branches. Values go to a buffer in channel order, four at a
+/// time where a group's channels are consecutive (sortChannels() helps after many changes).
+/// Values match the easers to float rounding, not bit for bit.
+class BatchEaser {
+public:
+
+	BatchEaser(size_t numChannels=0) {
+		mGroups.resize(numEasingCurves);
+		resize(numChannels);
+	}
+
+	/// new channels hold 0
+	void resize(size_t numChannels) {
+		while (mSlots.size() > numChannels) {
+			remove(mSlots.size() - 1);
+			mSlots.pop_back();
+		}
+		while (mSlots.size() < numChannels) {
+			mSlots.push_back({ EasingCurve::HOLD, 0 });
+			insert(mSlots.size() - 1, EasingCurve::HOLD);
+		}
+		mValues.resize(numChannels);
+	}
+
+	size_t size() const { return mSlots.size(); }
+
+	/// number of channels using curve
+	size_t size(EasingCurve curve) const { return mGroups[static_cast<size_t>(curve)].channels.size(); }
+
+	/// channel eases from start to end between startTime and endTime
+	void set(size_t channel, EasingCurve curve, float startTime, float endTime, float start, float end) {
+
+		if (mSlots[channel].curve != curve) {
+			remove(channel);
+			insert(channel, curve);
+		}
+
+		Group &group = mGroups[static_cast<size_t>(curve)];
+		const size_t i = mSlots[channel].index;
+		group.startTimes[i] = startTime;
+		group.inverseDurations[i] = 1.0f / std::max(endTime - startTime, 1e-9f);
+		group.startValues[i] = start;
+		group.ranges[i] = end - start;
+	}
+
+	void setValue(size_t channel, float value) {
+		set(channel, EasingCurve::HOLD, 0, 0, value, value);
+	}
+
+	/// from wherever channel is at time to end over duration
+	void retarget(size_t channel, EasingCurve curve, float time, float duration, float end) {
+		set(channel, curve, time, time + duration, valueAt(channel, time), end);
+	}
+
+	float valueAt(size_t channel, float time) const {
+		const Slot &slot = mSlots[channel];
+		const Group &group = mGroups[static_cast<size_t>(slot.curve)];
+		return withEasingCurve<ValueAtOp>(slot.curve, group, slot.index, time);
+	}
+
+	/// every channel's value at time into output, size() floats
+	void update(float time, float *output) const {
+		for (size_t c = 0; c < numEasingCurves; c++) {
+			if (mGroups[c].channels.empty()) continue;
+			withEasingCurve<UpdateOp>(static_cast<EasingCurve>(c), *this, time, output);
+		}
+	}
+
+	/// into getValues()
+	const float* update(float time) {
+		update(time, mValues.data());
+		return mValues.data();
+	}
+
+	const AlignedVector<float>& getValues() const { return mValues; }
+
+	/// puts each group's channels back in order, so they're written four at a time again
+	void sortChannels() {
+		for (auto &group : mGroups) {
+			const size_t N = group.channels.size();
+			std::vector<uint32_t> order(N);
+			for (size_t i = 0; i < N; i++) order[i] = static_cast<uint32_t>(i);
+			std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return group.channels[a] < group.channels[b]; });
+
+			Group sorted;
+			sorted.reserve(N);
+			for (uint32_t i : order) sorted.push(group, i);
+			group = std::move(sorted);
+			for (size_t i = 0; i < N; i++) mSlots[group.channels[i]].index = static_cast<uint32_t>(i);
+		}
+	}
+
+	/// values in [0, 1] to 0 - 255, eg. for DMX
+	static void toBytes(const float *values, uint8_t *bytes, size_t N) {
+		for (size_t i = 0; i < N; i++) {
+			bytes[i] = static_cast<uint8_t>(clamp(values[i]) * 255.0f + 0.5f);
+		}
+	}
+
+protected:
+
+	struct Group {
+		AlignedVector<float> startTimes, inverseDurations, startValues, ranges;
+		std::vector<uint32_t> channels;
+
+		void reserve(size_t N) {
+			startTimes.reserve(N);
+			inverseDurations.reserve(N);
+			startValues.reserve(N);
+			ranges.reserve(N);
+			channels.reserve(N);
+		}
+
+		void push(const Group &other, size_t i) {
+			startTimes.push_back(other.startTimes[i]);
+			inverseDurations.push_back(other.inverseDurations[i]);
+			startValues.push_back(other.startValues[i]);
+			ranges.push_back(other.ranges[i]);
+			channels.push_back(other.channels[i]);
+		}
+	};
+
+	struct Slot {
+		EasingCurve curve;
+		uint32_t index; // in its curve's group
+	};
+
+	std::vector<Group> mGroups;
+	std::vector<Slot> mSlots;
+	AlignedVector<float> mValues;
+
+	/// adds channel to the end of curve's group, holding 0
+	void insert(size_t channel, EasingCurve curve) {
+		Group &group = mGroups[static_cast<size_t>(curve)];
+		mSlots[channel] = { curve, static_cast<uint32_t>(group.channels.size()) };
+		group.startTimes.push_back(0);
+		group.inverseDurations.push_back(1);
+		group.startValues.push_back(0);
+		group.ranges.push_back(0);
+		group.channels.push_back(static_cast<uint32_t>(channel));
+	}
+
+	/// the last channel of the group takes its place
+	void remove(size_t channel) {
+		Group &group = mGroups[static_cast<size_t>(mSlots[channel].curve)];
+		const size_t i = mSlots[channel].index, last = group.channels.size() - 1;
+		if (i != last) {
+			group.startTimes[i] = group.startTimes[last];
+			group.inverseDurations[i] = group.inverseDurations[last];
+			group.startValues[i] = group.startValues[last];
+			group.ranges[i] = group.ranges[last];
+			group.channels[i] = group.channels[last];
+			mSlots[group.channels[i]].index = static_cast<uint32_t>(i);
+		}
+		group.startTimes.pop_back();
+		group.inverseDurations.pop_back();
+		group.startValues.pop_back();
+		group.ranges.pop_back();
+		group.channels.pop_back();
+	}
+
+	template <EasingCurve C>
+	static float valueAt(const Group &group, size_t i, float time) {
+		float t = clamp((time - group.startTimes[i]) * group.inverseDurations[i]);
+		return group.startValues[i] + group.ranges[i] * EasingShape<C>::apply(t);
+	}
+
+	template <EasingCurve C>
+	void update(float time, float *output) const {
+
+		using simd::float4;
+		const Group &group = mGroups[static_cast<size_t>(C)];
+		const size_t N = group.channels.size();
+		const uint32_t *channels = group.channels.data();
+		const float4 now(time), zero(0.0f), one(1.0f);
+
+		size_t i = 0;
+		for (; i + 4 <= N; i+= 4) {
+			float4 t = (now - float4::load(&group.startTimes[i])) * float4::load(&group.inverseDurations[i]);
+			t = min(max(t, zero), one);
+			float4 value = float4::load(&group.startValues[i]) + float4::load(&group.ranges[i]) * EasingShape<C>::apply(t);
+
+			const uint32_t first = channels[i];
+			if (channels[i + 1] == first + 1 && channels[i + 2] == first + 2 && channels[i + 3] == first + 3) {
+				value.store(output + first);
+			}
+			else {
+				float values[4];
+				value.store(values);
+				for (size_t j = 0; j < 4; j++) output[channels[i + j]] = values[j];
+			}
+		}
+		for (; i < N; i++) {
+			output[channels[i]] = valueAt<C>(group, i, time);
+		}
+	}
+
+	// valueAt<C> and update<C> for withEasingCurve
+	template <EasingCurve C>
+	struct ValueAtOp {
+		float operator()(const Group &group, size_t i, float time) const { return valueAt<C>(group, i, time); }
+	};
+
+	template <EasingCurve C>
+	struct UpdateOp {
+		void operator()(const BatchEaser &easer, float time, float *output) const { easer.update<C>(time, output); }
+	};
+};
+
+
 } // namespace whg
\ No newline at end of file
@@ -0,0 +1,221 @@
+#pragma once
+
+#include "whelpersg/wav.h"
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <cmath>
+#include <algorithm>
+
+#ifndef PI
+#define PI 3.141592653589793238462
+#endif
+
+namespace whg {
+
+/// audio with the times (in seconds) of the events in it
+struct TestSignal {
+	std::vector<float> audio;
+	std::vector<double> onsets;
+	float sampleRate;
+	double bpm, endBpm; // 0 if there's no tempo
+};
+
+
+/// decaying noise burst clicks with the tempo moving linearly from bpm to endBpm, plus
+/// background noise and gaussian jitter (in seconds) on the click times
+inline TestSignal clickTrack(float sampleRate, double seconds, double bpm, double endBpm,
+							 float noiseLevel=0.01f, double jitter=0, unsigned seed=0) {
+
+	std::mt19937 rng(seed);
+	std::normal_distribution<float> noise(0, 1);
+	std::normal_distribution<double> timing(0, jitter > 0 ? jitter : 1);
+
+	TestSignal signal;
+	signal.sampleRate = sampleRate;
+	signal.bpm = bpm;
+	signal.endBpm = endBpm;
+	signal.audio.resize(static_cast<size_t>(seconds * sampleRate));
+	for (auto &v : signal.audio) v = noiseLevel * noise(rng);
+
+	const size_t clickLength = static_cast<size_t>(0.045 * sampleRate);
+	const float decay = 0.007f * sampleRate;
+
+	double t = 0.5;
+	while (t < seconds - 0.1) {
+
+		double onset = std::max(t + (jitter > 0 ? timing(rng) : 0.0), 0.0);
+		signal.onsets.push_back(onset);
+
+		size_t start = static_cast<size_t>(onset * sampleRate);
+		for (size_t i = 0; i < clickLength && start + i < signal.audio.size(); i++) {
+			signal.audio[start + i]+= 0.8f * noise(rng) * std::exp(-static_cast<float>(i) / decay);
+		}
+
+		double tempo = bpm + (endBpm - bpm) * t / seconds;
+		t+= 60.0 / tempo;
+	}
+
+	return signal;
+}
+
+/// white noise and nothing to find in it
+inline TestSignal noiseSignal(float sampleRate, double seconds, float level=0.1f, unsigned seed=0) {
+
+	std::mt19937 rng(seed);
+	std::normal_distribution<float> noise(0, level);
+
+	TestSignal signal;
+	signal.sampleRate = sampleRate;
+	signal.bpm = signal.endBpm = 0;
+	signal.audio.resize(static_cast<size_t>(seconds * sampleRate));
+	for (auto &v : signal.audio) v = noise(rng);
+	return signal;
+}
+
+
+struct EventMatches {
+	size_t hits = 0, detections = 0, annotations = 0;
+	double meanOffset = 0; // detection - annotation over hits, in seconds
+
+	double precision() const { return detections ? static_cast<double>(hits) / detections : 0; }
+	double recall() const { return annotations ? static_cast<double>(hits) / annotations : 0; }
+	double fMeasure() const {
+		double p = precision(), r = recall();
+		return p + r > 0 ? 2 * p * r / (p + r) : 0;
+	}
+};
+
+/// one to one matching of sorted detection and annotation times within tolerance, only
+/// counting events between from and to (eg. after a warm up)
+inline EventMatches matchEvents(const std::vector<double> &detections, const std::vector<double> &annotations,
+								double tolerance=0.05, double from=0,
+								double to=std::numeric_limits<double>::infinity()) {
+
+	EventMatches m;
+	size_t d = 0, a = 0;
+
+	auto inRange = [&](double t) { return t >= from && t < to; };
+
+	while (d < detections.size() && a < annotations.size()) {
+
+		double difference = detections[d] - annotations[a];
+
+		if (std::abs(difference) <= tolerance) {
+			if (inRange(annotations[a])) {
+				m.hits++;
+				m.detections++;
+				m.annotations++;
+				m.meanOffset+= difference;
+			}
+			d++;
+			a++;
+		}
+		else if (difference < 0) {
+			if (inRange(detections[d])) m.detections++;
+			d++;
+		}
+		else {
+			if (inRange(annotations[a])) m.annotations++;
+			a++;
+		}
+	}
+	for (; d < detections.size(); d++) {
+		if (inRange(detections[d])) m.detections++;
+	}
+	for (; a < annotations.size(); a++) {
+		if (inRange(annotations[a])) m.annotations++;
+	}
+
+	if (m.hits) m.meanOffset/= m.hits;
+	return m;
+}
+
+/// relative error, optionally forgiving double / half / triple / third tempo
+inline double tempoError(double estimate, double truth, bool allowOctaves=false) {
+
+	double error = std::abs(estimate - truth) / truth;
+	if (allowOctaves) {
+		for (double factor : { 2.0, 0.5, 3.0, 1.0 / 3.0 }) {
+			error = std::min(error, std::abs(estimate - truth * factor) / (truth * factor));
+		}
+	}
+	return error;
+}
+
+
+/// durations of repeated calls, for means and percentiles
+class LatencyRecorder {
+public:
+
+	using clock = std::chrono::steady_clock;
+
+	void start() { mStart = clock::now(); }
+
+	void stop() {
+		mNanoseconds.push_back(std::chrono::duration<double, std::nano>(clock::now() - mStart).count());
+		mIsSorted = false;
+	}
+
+	void add(double nanoseconds) {
+		mNanoseconds.push_back(nanoseconds);
+		mIsSorted = false;
+	}
+
+	void clear() { mNanoseconds.clear(); }
+
+	size_t size() const { return mNanoseconds.size(); }
+
+	double total() const {
+		double sum = 0;
+		for (double ns : mNanoseconds) sum+= ns;
+		return sum;
+	}
+
+	double mean() const { return mNanoseconds.empty() ? 0 : total() / mNanoseconds.size(); }
+
+	/// p from 0 to 100, nearest rank
+	double percentile(double p) {
+		if (mNanoseconds.empty()) return 0;
+		if (!mIsSorted) {
+			std::sort(mNanoseconds.begin(), mNanoseconds.end());
+			mIsSorted = true;
+		}
+		size_t rank = static_cast<size_t>(std::ceil(p / 100.0 * mNanoseconds.size()));
+		return mNanoseconds[std::min(std::max<size_t>(rank, 1), mNanoseconds.size()) - 1];
+	}
+
+protected:
+	clock::time_point mStart;
+	std::vector<double> mNanoseconds;
+	bool mIsSorted = false;
+};
+
+
+/// times in seconds from the first column of a text file (eg. sonic visualiser or
+/// mirex style annotations), skipping blank lines and lines starting with #
+inline std::vector<double> loadAnnotations(const std::string &path) {
+
+	std::vector<double> times;
+	std::ifstream file(path);
+	std::string line;
+
+	while (std::getline(file, line)) {
+		if (line.empty() || line[0] == '#') continue;
+		std::replace(line.begin(), line.end(), ',', ' ');
+		std::istringstream stream(line);
+		double t;
+		if (stream >> t) times.push_back(t);
+	}
+
+	std::sort(times.begin(), times.end());
+	return times;
+}
+
+
+} // namespace whg
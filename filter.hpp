@@ -0,0 +1,395 @@
+#pragma once
+
+#include "whelpersg/simd.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#ifndef PI
+#define PI 3.141592653589793238462
+#endif
+
+namespace dsp {
+
+/// normalised biquad coefficients (a0 == 1), designs from Robert Bristow-Johnson's cookbook
+struct BiquadCoefficients {
+	float b0, b1, b2, a1, a2;
+
+	static BiquadCoefficients passthrough() { return { 1, 0, 0, 0, 0 }; }
+
+	static BiquadCoefficients lowpass(double sampleRate, double frequency, double q=0.70710678118654752) {
+		Intermediates i(sampleRate, frequency, q);
+		return normalise((1 - i.cosw0) / 2, 1 - i.cosw0, (1 - i.cosw0) / 2, 1 + i.alpha, -2 * i.cosw0, 1 - i.alpha);
+	}
+
+	static BiquadCoefficients highpass(double sampleRate, double frequency, double q=0.70710678118654752) {
+		Intermediates i(sampleRate, frequency, q);
+		return normalise((1 + i.cosw0) / 2, -(1 + i.cosw0), (1 + i.cosw0) / 2, 1 + i.alpha, -2 * i.cosw0, 1 - i.alpha);
+	}
+
+	/// constant 0dB peak gain
+	static BiquadCoefficients bandpass(double sampleRate, double frequency, double q) {
+		Intermediates i(sampleRate, frequency, q);
+		return normalise(i.alpha, 0, -i.alpha, 1 + i.alpha, -2 * i.cosw0, 1 - i.alpha);
+	}
+
+	static BiquadCoefficients notch(double sampleRate, double frequency, double q) {
+		Intermediates i(sampleRate, frequency, q);
+		return normalise(1, -2 * i.cosw0, 1, 1 + i.alpha, -2 * i.cosw0, 1 - i.alpha);
+	}
+
+	static BiquadCoefficients allpass(double sampleRate, double frequency, double q) {
+		Intermediates i(sampleRate, frequency, q);
+		return normalise(1 - i.alpha, -2 * i.cosw0, 1 + i.alpha, 1 + i.alpha, -2 * i.cosw0, 1 - i.alpha);
+	}
+
+	static BiquadCoefficients peaking(double sampleRate, double frequency, double q, double gainDb) {
+		Intermediates i(sampleRate, frequency, q);
+		double A = std::pow(10.0, gainDb / 40.0);
+		return normalise(1 + i.alpha * A, -2 * i.cosw0, 1 - i.alpha * A, 1 + i.alpha / A, -2 * i.cosw0, 1 - i.alpha / A);
+	}
+
+	static BiquadCoefficients lowShelf(double sampleRate, double frequency, double q, double gainDb) {
+		Intermediates i(sampleRate, frequency, q);
+		double A = std::pow(10.0, gainDb / 40.0), s = 2 * std::sqrt(A) * i.alpha;
+		return normalise(A * ((A + 1) - (A - 1) * i.cosw0 + s),
+						 2 * A * ((A - 1) - (A + 1) * i.cosw0),
+						 A * ((A + 1) - (A - 1) * i.cosw0 - s),
+						 (A + 1) + (A - 1) * i.cosw0 + s,
+						 -2 * ((A - 1) + (A + 1) * i.cosw0),
+						 (A + 1) + (A - 1) * i.cosw0 - s);
+	}
+
+	static BiquadCoefficients highShelf(double sampleRate, double frequency, double q, double gainDb) {
+		Intermediates i(sampleRate, frequency, q);
+		double A = std::pow(10.0, gainDb / 40.0), s = 2 * std::sqrt(A) * i.alpha;
+		return normalise(A * ((A + 1) + (A - 1) * i.cosw0 + s),
+						 -2 * A * ((A - 1) + (A + 1) * i.cosw0),
+						 A * ((A + 1) + (A - 1) * i.cosw0 - s),
+						 (A + 1) - (A - 1) * i.cosw0 + s,
+						 2 * ((A - 1) - (A + 1) * i.cosw0),
+						 (A + 1) - (A - 1) * i.cosw0 - s);
+	}
+
+	/// first order sections (b2 = a2 = 0) via the bilinear transform, for odd order cascades
+	static BiquadCoefficients firstOrderLowpass(double sampleRate, double frequency) {
+		double K = std::tan(PI * frequency / sampleRate);
+		return normalise(K, K, 0, K + 1, K - 1, 0);
+	}
+
+	static BiquadCoefficients firstOrderHighpass(double sampleRate, double frequency) {
+		double K = std::tan(PI * frequency / sampleRate);
+		return normalise(1, -1, 0, K + 1, K - 1, 0);
+	}
+
+protected:
+
+	struct Intermediates {
+		double cosw0, alpha;
+		Intermediates(double sampleRate, double frequency, double q) {
+			double w0 = 2 * PI * frequency / sampleRate;
+			cosw0 = std::cos(w0);
+			alpha = std::sin(w0) / (2 * q);
+		}
+	};
+
+	static BiquadCoefficients normalise(double b0, double b1, double b2, double a0, double a1, double a2) {
+		return {
+			static_cast<float>(b0 / a0),
+			static_cast<float>(b1 / a0),
+			static_cast<float>(b2 / a0),
+			static_cast<float>(a1 / a0),
+			static_cast<float>(a2 / a0)
+		};
+	}
+};
+
+
+/// Butterworth cascades of order sections, as biquads plus a first order section when order is odd
+inline std::vector<BiquadCoefficients> butterworthLowpass(uint order, double sampleRate, double frequency) {
+	std::vector<BiquadCoefficients> sections;
+	for (uint k = 0; k < order / 2; k++) {
+		double q = 1.0 / (2.0 * std::sin(PI * (2 * k + 1) / (2.0 * order)));
+		sections.push_back(BiquadCoefficients::lowpass(sampleRate, frequency, q));
+	}
+	if (order % 2) {
+		sections.push_back(BiquadCoefficients::firstOrderLowpass(sampleRate, frequency));
+	}
+	return sections;
+}
+
+inline std::vector<BiquadCoefficients> butterworthHighpass(uint order, double sampleRate, double frequency) {
+	std::vector<BiquadCoefficients> sections;
+	for (uint k = 0; k < order / 2; k++) {
+		double q = 1.0 / (2.0 * std::sin(PI * (2 * k + 1) / (2.0 * order)));
+		sections.push_back(BiquadCoefficients::highpass(sampleRate, frequency, q));
+	}
+	if (order % 2) {
+		sections.push_back(BiquadCoefficients::firstOrderHighpass(sampleRate, frequency));
+	}
+	return sections;
+}
+
+/// Linkwitz-Riley is a Butterworth of half the order twice, low and high sum flat
+inline std::vector<BiquadCoefficients> linkwitzRileyLowpass(uint order, double sampleRate, double frequency) {
+	auto sections = butterworthLowpass(order / 2, sampleRate, frequency);
+	auto copy = sections;
+	sections.insert(sections.end(), copy.begin(), copy.end());
+	return sections;
+}
+
+inline std::vector<BiquadCoefficients> linkwitzRileyHighpass(uint order, double sampleRate, double frequency) {
+	auto sections = butterworthHighpass(order / 2, sampleRate, frequency);
+	auto copy = sections;
+	sections.insert(sections.end(), copy.begin(), copy.end());
+	return sections;
+}
+
+
+/// a single transposed direct form II biquad, for one-offs
+struct Biquad {
+	BiquadCoefficients c;
+	float z1, z2;
+
+	Biquad(): c(BiquadCoefficients::passthrough()), z1(0), z2(0) {}
+	Biquad(BiquadCoefficients c): c(c), z1(0), z2(0) {}
+
+	float process(float x) {
+		float y = c.b0 * x + z1;
+		z1 = c.b1 * x - c.a1 * y + z2;
+		z2 = c.b2 * x - c.a2 * y;
+		return y;
+	}
+
+	void reset() { z1 = z2 = 0; }
+};
+
+
+/// Many biquad cascades run side by side, one per lane (a band, a channel or both).
+/// Coefficients and state are stored structure-of-arrays, stage major, so four lanes
+/// are filtered at once in a float4. Frames are moved through an interleaved scratch
+/// block of BLOCK_SIZE frames, up to four stages at a time run over the whole block with
+/// their state in registers. Lanes with shorter cascades are padded with passthrough stages.
+class BiquadBank {
+
+	enum { BLOCK_SIZE = 64 };
+
+public:
+
+	BiquadBank(size_t numLanes=0, size_t numStages=1) {
+		resize(numLanes, numStages);
+	}
+
+	void resize(size_t numLanes, size_t numStages) {
+
+		mNumLanes = numLanes;
+		mNumStages = numStages;
+		mPaddedLanes = (numLanes + 3) & ~static_cast<size_t>(3);
+
+		const size_t N = mPaddedLanes * mNumStages;
+		auto pass = BiquadCoefficients::passthrough();
+		mB0.assign(N, pass.b0);
+		mB1.assign(N, pass.b1);
+		mB2.assign(N, pass.b2);
+		mA1.assign(N, pass.a1);
+		mA2.assign(N, pass.a2);
+		mZ1.assign(N, 0);
+		mZ2.assign(N, 0);
+
+		mScratch.assign(BLOCK_SIZE * mPaddedLanes, 0);
+	}
+
+	void setCoefficients(size_t lane, size_t stage, const BiquadCoefficients &c) {
+		size_t i = stage * mPaddedLanes + lane;
+		mB0[i] = c.b0;
+		mB1[i] = c.b1;
+		mB2[i] = c.b2;
+		mA1[i] = c.a1;
+		mA2[i] = c.a2;
+	}
+
+	/// sets all the stages for a lane, the bank grows if the cascade is longer than getNumStages()
+	void setCascade(size_t lane, const std::vector<BiquadCoefficients> &sections) {
+
+		if (sections.size() > mNumStages) {
+			grow(sections.size());
+		}
+
+		for (size_t stage = 0; stage < mNumStages; stage++) {
+			setCoefficients(lane, stage, stage < sections.size() ? sections[stage] : BiquadCoefficients::passthrough());
+		}
+	}
+
+	/// crossovers.size() + 1 Linkwitz-Riley bands, lowest first
+	void setBands(double sampleRate, const std::vector<double> &crossovers, uint order=4) {
+
+		const size_t numBands = crossovers.size() + 1;
+		resize(numBands, 1);
+
+		for (size_t band = 0; band < numBands; band++) {
+			std::vector<BiquadCoefficients> sections;
+			if (band > 0) {
+				auto hp = linkwitzRileyHighpass(order, sampleRate, crossovers[band-1]);
+				sections.insert(sections.end(), hp.begin(), hp.end());
+			}
+			if (band < crossovers.size()) {
+				auto lp = linkwitzRileyLowpass(order, sampleRate, crossovers[band]);
+				sections.insert(sections.end(), lp.begin(), lp.end());
+			}
+			setCascade(band, sections);
+		}
+	}
+
+	void reset() {
+		std::fill(mZ1.begin(), mZ1.end(), 0.0f);
+		std::fill(mZ2.begin(), mZ2.end(), 0.0f);
+	}
+
+	size_t getNumLanes() const { return mNumLanes; }
+	size_t getNumStages() const { return mNumStages; }
+
+	/// every lane filters the same input, eg. splitting a signal into bands
+	void process(const float *input, float *const *outputs, size_t numFrames) {
+		run(numFrames, [&](size_t offset, size_t N) {
+			for (size_t n = 0; n < N; n++) {
+				whg::simd::float4 x(input[offset + n]);
+				for (size_t lane = 0; lane < mPaddedLanes; lane+= 4) {
+					x.store(&mScratch[n * mPaddedLanes + lane]);
+				}
+			}
+		}, [&](size_t offset, size_t N) {
+			drain(outputs, offset, N);
+		});
+	}
+
+	/// each lane has its own input
+	void process(const float *const *inputs, float *const *outputs, size_t numFrames) {
+		run(numFrames, [&](size_t offset, size_t N) {
+			for (size_t lane = 0; lane < mNumLanes; lane++) {
+				const float *in = inputs[lane] + offset;
+				for (size_t n = 0; n < N; n++) {
+					mScratch[n * mPaddedLanes + lane] = in[n];
+				}
+			}
+		}, [&](size_t offset, size_t N) {
+			drain(outputs, offset, N);
+		});
+	}
+
+	/// getNumLanes() values per frame, input and output may be the same buffer
+	void processInterleaved(const float *input, float *output, size_t numFrames) {
+		run(numFrames, [&](size_t offset, size_t N) {
+			for (size_t n = 0; n < N; n++) {
+				std::copy(input + (offset + n) * mNumLanes, input + (offset + n + 1) * mNumLanes, &mScratch[n * mPaddedLanes]);
+			}
+		}, [&](size_t offset, size_t N) {
+			for (size_t n = 0; n < N; n++) {
+				std::copy(&mScratch[n * mPaddedLanes], &mScratch[n * mPaddedLanes] + mNumLanes, output + (offset + n) * mNumLanes);
+			}
+		});
+	}
+
+protected:
+	size_t mNumLanes, mNumStages, mPaddedLanes;
+
+	// [stage][lane], stage major
+	whg::AlignedVector<float> mB0, mB1, mB2, mA1, mA2, mZ1, mZ2;
+
+	// [frame][lane] for up to BLOCK_SIZE frames
+	whg::AlignedVector<float> mScratch;
+
+	void grow(size_t numStages) {
+
+		BiquadBank bigger(mNumLanes, numStages);
+		const size_t N = mPaddedLanes * mNumStages;
+		std::copy(mB0.begin(), mB0.begin() + N, bigger.mB0.begin());
+		std::copy(mB1.begin(), mB1.begin() + N, bigger.mB1.begin());
+		std::copy(mB2.begin(), mB2.begin() + N, bigger.mB2.begin());
+		std::copy(mA1.begin(), mA1.begin() + N, bigger.mA1.begin());
+		std::copy(mA2.begin(), mA2.begin() + N, bigger.mA2.begin());
+		std::copy(mZ1.begin(), mZ1.begin() + N, bigger.mZ1.begin());
+		std::copy(mZ2.begin(), mZ2.begin() + N, bigger.mZ2.begin());
+		*this = std::move(bigger);
+	}
+
+	void drain(float *const *outputs, size_t offset, size_t N) {
+		for (size_t lane = 0; lane < mNumLanes; lane++) {
+			float *out = outputs[lane] + offset;
+			for (size_t n = 0; n < N; n++) {
+				out[n] = mScratch[n * mPaddedLanes + lane];
+			}
+		}
+	}
+
+	template <int NumStages>
+	void runStages(size_t firstStage, size_t lane, size_t N) {
+
+		using whg::simd::float4;
+		float4 b0[NumStages], b1[NumStages], b2[NumStages], a1[NumStages], a2[NumStages];
+		float4 z1[NumStages], z2[NumStages];
+
+		for (int s = 0; s < NumStages; s++) {
+			const size_t i = (firstStage + s) * mPaddedLanes + lane;
+			b0[s] = float4::load(&mB0[i]);
+			b1[s] = float4::load(&mB1[i]);
+			b2[s] = float4::load(&mB2[i]);
+			a1[s] = float4::load(&mA1[i]);
+			a2[s] = float4::load(&mA2[i]);
+			z1[s] = float4::load(&mZ1[i]);
+			z2[s] = float4::load(&mZ2[i]);
+		}
+
+		float *frame = &mScratch[lane];
+		for (size_t n = 0; n < N; n++, frame+= mPaddedLanes) {
+			float4 x = float4::load(frame);
+			for (int s = 0; s < NumStages; s++) {
+				float4 y = b0[s] * x + z1[s];
+				z1[s] = b1[s] * x - a1[s] * y + z2[s];
+				z2[s] = b2[s] * x - a2[s] * y;
+				x = y;
+			}
+			x.store(frame);
+		}
+
+		for (int s = 0; s < NumStages; s++) {
+			const size_t i = (firstStage + s) * mPaddedLanes + lane;
+			z1[s].store(&mZ1[i]);
+			z2[s].store(&mZ2[i]);
+		}
+	}
+
+	template <class Fill, class Drain>
+	void run(size_t numFrames, Fill fill, Drain drain) {
+
+		whg::simd::ScopedNoDenormals noDenormals;
+
+		for (size_t offset = 0; offset < numFrames; offset+= BLOCK_SIZE) {
+
+			const size_t N = std::min<size_t>(BLOCK_SIZE, numFrames - offset);
+			fill(offset, N);
+
+			// up to four stages per pass, so consecutive stages overlap in the pipeline
+			for (size_t stage = 0; stage < mNumStages; stage+= 4) {
+				for (size_t lane = 0; lane < mPaddedLanes; lane+= 4) {
+					switch (std::min<size_t>(4, mNumStages - stage)) {
+						case 1: runStages<1>(stage, lane, N); break;
+						case 2: runStages<2>(stage, lane, N); break;
+						case 3: runStages<3>(stage, lane, N); break;
+						default: runStages<4>(stage, lane, N); break;
+					}
+				}
+			}
+
+			drain(offset, N);
+		}
+
+		// in case the FPU doesn't flush, decaying state shouldn't go denormal between calls
+		for (size_t i = 0; i < mZ1.size(); i++) {
+			if (std::abs(mZ1[i]) < 1e-15f) mZ1[i] = 0;
+			if (std::abs(mZ2[i]) < 1e-15f) mZ2[i] = 0;
+		}
+	}
+};
+
+} // namespace dsp
@@ -0,0 +1,217 @@
+#pragma once
+
+#include "whelpersg/simd.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+#ifndef PI
+#define PI 3.141592653589793238462
+#endif
+
+namespace dsp {
+
+/// Tracks a handful of frequencies over a sliding window of windowLength samples,
+/// updating every bin in O(1) per sample instead of running an FFT every hop.
+/// Each bin is the DFT of the window referenced to the newest sample:
+///     Y(n) = r e^jw Y(n-1) + x(n) - r^N e^jwN x(n-N)
+/// which works for any frequency, not just FFT bins. The damping r < 1 makes rounding
+/// errors die away instead of accumulating forever. Bins are laid out structure-of-arrays
+/// so four are updated at once.
+class SlidingDFTBank {
+public:
+
+	SlidingDFTBank(size_t windowLength, double sampleRate, const std::vector<double> &frequencies, double damping=0.99999) {
+		setup(windowLength, sampleRate, frequencies, damping);
+	}
+
+	void setup(size_t windowLength, double sampleRate, const std::vector<double> &frequencies, double damping=0.99999) {
+
+		mWindowLength = windowLength;
+		mNumBins = frequencies.size();
+		mFrequencies = frequencies;
+
+		const size_t padded = (mNumBins + 3) & ~static_cast<size_t>(3);
+		mRotateReal.assign(padded, 0);
+		mRotateImag.assign(padded, 0);
+		mCombReal.assign(padded, 0);
+		mCombImag.assign(padded, 0);
+
+		const double rN = std::pow(damping, static_cast<double>(windowLength));
+		// sum of the damped window, so damping doesn't change the magnitudes
+		mGain = damping < 1.0 ? (1.0 - damping) / (1.0 - rN) : 1.0 / windowLength;
+
+		for (size_t bin = 0; bin < mNumBins; bin++) {
+			double w = 2.0 * PI * frequencies[bin] / sampleRate;
+			mRotateReal[bin] = damping * std::cos(w);
+			mRotateImag[bin] = damping * std::sin(w);
+			mCombReal[bin] = rN * std::cos(w * windowLength);
+			mCombImag[bin] = rN * std::sin(w * windowLength);
+		}
+
+		mDelay.assign(windowLength, 0);
+		mDelayIndex = 0;
+		mReal.assign(padded, 0);
+		mImag.assign(padded, 0);
+	}
+
+	void reset() {
+		std::fill(mDelay.begin(), mDelay.end(), 0.0f);
+		std::fill(mReal.begin(), mReal.end(), 0.0f);
+		std::fill(mImag.begin(), mImag.end(), 0.0f);
+		mDelayIndex = 0;
+	}
+
+	void process(const float *input, size_t N) {
+
+		using whg::simd::float4;
+		const size_t padded = mReal.size();
+
+		for (size_t n = 0; n < N; n++) {
+
+			const float4 x(input[n]);
+			const float4 oldest(mDelay[mDelayIndex]);
+			mDelay[mDelayIndex] = input[n];
+			mDelayIndex = mDelayIndex + 1 == mWindowLength ? 0 : mDelayIndex + 1;
+
+			for (size_t bin = 0; bin < padded; bin+= 4) {
+				float4 cr = float4::load(&mRotateReal[bin]), ci = float4::load(&mRotateImag[bin]);
+				float4 yr = float4::load(&mReal[bin]), yi = float4::load(&mImag[bin]);
+
+				float4 real = cr * yr - ci * yi + x - float4::load(&mCombReal[bin]) * oldest;
+				float4 imag = cr * yi + ci * yr - float4::load(&mCombImag[bin]) * oldest;
+
+				real.store(&mReal[bin]);
+				imag.store(&mImag[bin]);
+			}
+		}
+	}
+
+	void process(const std::vector<float> &input) {
+		process(&input[0], input.size());
+	}
+
+	/// a sinusoid of amplitude A at a tracked frequency reads as A / 2
+	float getMagnitude(size_t bin) const {
+		return std::sqrt(mReal[bin] * mReal[bin] + mImag[bin] * mImag[bin]) * mGain;
+	}
+
+	void getMagnitudes(float *output) const {
+		for (size_t bin = 0; bin < mNumBins; bin++) {
+			output[bin] = getMagnitude(bin);
+		}
+	}
+
+	std::vector<float> getMagnitudes() const {
+		std::vector<float> output(mNumBins);
+		getMagnitudes(&output[0]);
+		return output;
+	}
+
+	size_t getNumBins() const { return mNumBins; }
+	size_t getWindowLength() const { return mWindowLength; }
+	const std::vector<double>& getFrequencies() const { return mFrequencies; }
+
+protected:
+	size_t mWindowLength, mNumBins, mDelayIndex;
+	float mGain;
+	std::vector<double> mFrequencies;
+	std::vector<float> mDelay;
+
+	whg::AlignedVector<float> mRotateReal, mRotateImag, mCombReal, mCombImag;
+	whg::AlignedVector<float> mReal, mImag;
+};
+
+
+/// Block Goertzel filters, the cheapest way to get the power at a few frequencies once per
+/// blockLength samples (no overlap). Bins are structure-of-arrays, four at a time.
+class GoertzelBank {
+public:
+
+	GoertzelBank(size_t blockLength, double sampleRate, const std::vector<double> &frequencies) {
+		setup(blockLength, sampleRate, frequencies);
+	}
+
+	void setup(size_t blockLength, double sampleRate, const std::vector<double> &frequencies) {
+
+		mBlockLength = blockLength;
+		mNumBins = frequencies.size();
+
+		const size_t padded = (mNumBins + 3) & ~static_cast<size_t>(3);
+		mCoefficients.assign(padded, 0);
+		for (size_t bin = 0; bin < mNumBins; bin++) {
+			mCoefficients[bin] = 2.0 * std::cos(2.0 * PI * frequencies[bin] / sampleRate);
+		}
+
+		mS1.assign(padded, 0);
+		mS2.assign(padded, 0);
+		mMagnitudes.assign(mNumBins, 0);
+		mCount = 0;
+		mHasNewOutput = false;
+	}
+
+	void reset() {
+		std::fill(mS1.begin(), mS1.end(), 0.0f);
+		std::fill(mS2.begin(), mS2.end(), 0.0f);
+		mCount = 0;
+	}
+
+	/// returns true if at least one block completed, see getMagnitudes()
+	bool process(const float *input, size_t N) {
+
+		using whg::simd::float4;
+		const size_t padded = mS1.size();
+		mHasNewOutput = false;
+
+		size_t n = 0;
+		while (n < N) {
+
+			const size_t todo = std::min(N - n, mBlockLength - mCount);
+
+			for (size_t bin = 0; bin < padded; bin+= 4) {
+				const float4 c = float4::load(&mCoefficients[bin]);
+				float4 s1 = float4::load(&mS1[bin]), s2 = float4::load(&mS2[bin]);
+				for (size_t i = n; i < n + todo; i++) {
+					float4 s = float4(input[i]) + c * s1 - s2;
+					s2 = s1;
+					s1 = s;
+				}
+				s1.store(&mS1[bin]);
+				s2.store(&mS2[bin]);
+			}
+
+			n+= todo;
+			mCount+= todo;
+
+			if (mCount == mBlockLength) {
+				for (size_t bin = 0; bin < mNumBins; bin++) {
+					// in double, at low frequencies the terms nearly cancel
+					double s1 = mS1[bin], s2 = mS2[bin];
+					double power = s1 * s1 + s2 * s2 - mCoefficients[bin] * s1 * s2;
+					mMagnitudes[bin] = static_cast<float>(std::sqrt(std::max(power, 0.0)) / mBlockLength);
+				}
+				reset();
+				mHasNewOutput = true;
+			}
+		}
+
+		return mHasNewOutput;
+	}
+
+	/// a sinusoid of amplitude A at a tracked frequency reads as A / 2
+	const std::vector<float>& getMagnitudes() const { return mMagnitudes; }
+
+	bool hasNewOutput() const { return mHasNewOutput; }
+	size_t getNumBins() const { return mNumBins; }
+	size_t getBlockLength() const { return mBlockLength; }
+
+protected:
+	size_t mBlockLength, mNumBins, mCount;
+	bool mHasNewOutput;
+
+	whg::AlignedVector<float> mCoefficients, mS1, mS2;
+	std::vector<float> mMagnitudes;
+};
+
+} // namespace dsp
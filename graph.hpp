@@ -0,0 +1,539 @@
+#pragma once
+
+#include "whelpersg/dsp.h"
+#include "whelpersg/simd.h"
+#include "whelpersg/onset.h"
+#include "whelpersg/mfcc.h"
+#include "whelpersg/parallel.h"
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <complex>
+#include <cstring>
+#include <functional>
+#include <stdexcept>
+#include <algorithm>
+
+namespace whg {
+
+/// One step of a FeatureGraph, turning the outputs of its inputs into getSize() floats per frame.
+/// A node is only ever processed by one thread at a time, so it can keep state between frames.
+class FeatureNode {
+public:
+
+	virtual ~FeatureNode() {}
+
+	virtual std::string getName() const = 0;
+
+	/// number of floats process() writes
+	virtual size_t getSize() const = 0;
+
+	/// inputs holds one pointer per input given to FeatureGraph::add(), in that order
+	virtual void process(const float * const *inputs, float *output) = 0;
+
+	virtual void reset() {}
+};
+
+
+/// Per frame dataflow between feature extractors. Nodes are added after their inputs so
+/// the graph is always in order and acyclic, node 0 is the audio frame itself.
+/// Shared intermediates (window + FFT, magnitudes) are computed once per frame however many
+/// nodes use them.
+///
+/// Nodes are grouped in levels by their distance from the input, nodes in the same level are
+/// independent and run on worker threads if setNumThreads() > 1. Outputs live in a pool of
+/// buffers: an intermediate's buffer is reused once the last level reading it is done, so
+/// only outputs (setOutput(), or nodes nothing reads from) are readable after process().
+/// Every node's time is recorded, see getTimings().
+class FeatureGraph {
+public:
+
+	struct NodeTiming {
+		std::string name;
+		size_t calls;
+		double seconds;
+
+		double getMeanMicroseconds() const { return calls ? 1e6 * seconds / calls : 0; }
+	};
+
+	FeatureGraph(size_t frameSize): mIsPrepared(false), mFrame(nullptr) {
+		mNodes.emplace_back();
+		mNodes[0].size = frameSize;
+		mNodes[0].name = "input";
+	}
+
+	/// the frame passed to process()
+	size_t getInput() const { return 0; }
+
+	/// takes ownership of node, inputs have to be already in the graph, returns the node's id
+	size_t add(std::unique_ptr<FeatureNode> node, const std::vector<size_t> &inputs) {
+
+		for (size_t input : inputs) {
+			if (input >= mNodes.size()) {
+				throw std::out_of_range("FeatureGraph: input " + std::to_string(input) + " isn't in the graph");
+			}
+		}
+
+		mNodes.emplace_back();
+		Entry &entry = mNodes.back();
+		entry.name = node->getName();
+		entry.size = node->getSize();
+		entry.node = std::move(node);
+		entry.inputs = inputs;
+		entry.inputPointers.resize(inputs.size());
+		mIsPrepared = false;
+		return mNodes.size() - 1;
+	}
+
+	/// eg. add<MelNode>({ power }, settings)
+	template <class NodeType, class... Args>
+	size_t add(const std::vector<size_t> &inputs, Args&&... args) {
+		return add(std::unique_ptr<FeatureNode>(new NodeType(std::forward<Args>(args)...)), inputs);
+	}
+
+	/// outputs keep their own buffer, nodes nothing reads from are always outputs
+	void setOutput(size_t id, bool isOutput=true) {
+		mNodes.at(id).isOutput = isOutput;
+		mIsPrepared = false;
+	}
+
+	/// 0 or 1 runs everything on the calling thread
+	void setNumThreads(size_t numThreads) {
+		mPool.reset(numThreads > 1 ? new ThreadPool(numThreads) : nullptr);
+	}
+
+	size_t getNumThreads() const { return mPool ? mPool->size() : 1; }
+
+	/// frame has the frameSize given to the constructor, it's read but not copied
+	void process(const float *frame) {
+
+		if (!mIsPrepared) prepare();
+		mFrame = frame;
+
+		for (const auto &level : mLevels) {
+
+			if (!mPool || level.size() == 1) {
+				for (size_t id : level) run(id);
+				continue;
+			}
+
+			mResults.clear();
+			for (size_t i = 1; i < level.size(); i++) {
+				size_t id = level[i];
+				mResults.push_back(mPool->submit([this, id]() { run(id); }));
+			}
+			run(level[0]);
+			for (auto &result : mResults) result.get();
+		}
+	}
+
+	/// only valid for outputs, until the next process()
+	const float* getOutput(size_t id) const {
+		if (id == 0) return mFrame;
+		return mNodes.at(id).buffer < mBuffers.size() ? &mBuffers[mNodes[id].buffer][0] : nullptr;
+	}
+
+	size_t getSize(size_t id) const { return mNodes.at(id).size; }
+	size_t getNumNodes() const { return mNodes.size(); }
+
+	/// the node itself, to change its settings
+	template <class NodeType=FeatureNode>
+	NodeType* getNode(size_t id) { return dynamic_cast<NodeType*>(mNodes.at(id).node.get()); }
+
+	/// number of floats in the buffer pool, against the sum of getSize() without pooling
+	size_t getBufferSize() const {
+		size_t total = 0;
+		for (const auto &buffer : mBuffers) total+= buffer.size();
+		return total;
+	}
+
+	/// resets the state of every node, not the timings
+	void reset() {
+		for (auto &entry : mNodes) {
+			if (entry.node) entry.node->reset();
+		}
+	}
+
+	/// in the order the nodes were added, without the input
+	std::vector<NodeTiming> getTimings() const {
+		std::vector<NodeTiming> timings;
+		for (size_t id = 1; id < mNodes.size(); id++) {
+			timings.push_back({ mNodes[id].name, mNodes[id].calls, mNodes[id].seconds });
+		}
+		return timings;
+	}
+
+	void resetTimings() {
+		for (auto &entry : mNodes) {
+			entry.calls = 0;
+			entry.seconds = 0;
+		}
+	}
+
+protected:
+
+	struct Entry {
+		std::string name;
+		std::unique_ptr<FeatureNode> node;
+		std::vector<size_t> inputs;
+		std::vector<const float*> inputPointers;
+		size_t size = 0;
+		size_t level = 0;
+		size_t lastLevel = 0; // last level reading the output
+		size_t buffer = 0;
+		bool isOutput = false;
+		bool hasReaders = false;
+		size_t calls = 0;
+		double seconds = 0;
+	};
+
+	std::vector<Entry> mNodes;
+	std::vector<std::vector<size_t>> mLevels;
+	std::vector<AlignedVector<float>> mBuffers;
+	std::unique_ptr<ThreadPool> mPool;
+	std::vector<std::future<void>> mResults;
+	bool mIsPrepared;
+	const float *mFrame;
+
+	void run(size_t id) {
+
+		Entry &entry = mNodes[id];
+		for (size_t i = 0; i < entry.inputs.size(); i++) {
+			entry.inputPointers[i] = getOutput(entry.inputs[i]);
+		}
+
+		auto start = std::chrono::steady_clock::now();
+		entry.node->process(entry.inputPointers.data(), &mBuffers[entry.buffer][0]);
+		entry.seconds+= std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		entry.calls++;
+	}
+
+	/// levels, then buffers handed out level by level from those released by earlier levels
+	void prepare() {
+
+		for (auto &entry : mNodes) {
+			entry.level = 0;
+			entry.lastLevel = 0;
+			entry.hasReaders = false;
+		}
+
+		size_t numLevels = 1;
+		for (size_t id = 1; id < mNodes.size(); id++) {
+			Entry &entry = mNodes[id];
+			for (size_t input : entry.inputs) {
+				entry.level = std::max(entry.level, mNodes[input].level + 1);
+			}
+			entry.level = std::max<size_t>(entry.level, 1);
+			numLevels = std::max(numLevels, entry.level + 1);
+			for (size_t input : entry.inputs) {
+				mNodes[input].lastLevel = std::max(mNodes[input].lastLevel, entry.level);
+				mNodes[input].hasReaders = true;
+			}
+		}
+
+		mLevels.assign(numLevels - 1, {});
+		for (size_t id = 1; id < mNodes.size(); id++) {
+			mLevels[mNodes[id].level - 1].push_back(id);
+		}
+
+		std::vector<size_t> capacities, free;
+		for (size_t level = 1; level < numLevels; level++) {
+
+			// outputs only read by earlier levels are free again
+			for (size_t id = 1; id < mNodes.size(); id++) {
+				const Entry &entry = mNodes[id];
+				if (entry.hasReaders && !entry.isOutput && entry.lastLevel == level - 1) {
+					free.push_back(entry.buffer);
+				}
+			}
+
+			for (size_t id : mLevels[level - 1]) {
+				Entry &entry = mNodes[id];
+
+				// smallest free buffer that fits, otherwise grow the biggest
+				auto best = free.end();
+				for (auto it = free.begin(); it != free.end(); ++it) {
+					bool fits = capacities[*it] >= entry.size;
+					if (best == free.end()) { best = it; continue; }
+					bool bestFits = capacities[*best] >= entry.size;
+					if (fits ? (!bestFits || capacities[*it] < capacities[*best]) : (!bestFits && capacities[*it] > capacities[*best])) {
+						best = it;
+					}
+				}
+
+				if (best != free.end()) {
+					entry.buffer = *best;
+					free.erase(best);
+				}
+				else {
+					entry.buffer = capacities.size();
+					capacities.push_back(0);
+				}
+				capacities[entry.buffer] = std::max(capacities[entry.buffer], entry.size);
+			}
+		}
+
+		mBuffers.resize(capacities.size());
+		for (size_t i = 0; i < capacities.size(); i++) {
+			mBuffers[i].assign(std::max<size_t>(capacities[i], 1), 0.0f);
+		}
+		mNodes[0].buffer = mBuffers.size();
+		mIsPrepared = true;
+	}
+};
+
+
+#ifdef USE_FFTW
+
+/// windowed FFT of the frame, output is fftSize / 2 + 1 interleaved real and imaginary parts
+class StftNode : public FeatureNode {
+public:
+
+	StftNode(size_t fftSize, dsp::window<float>::Type window=dsp::window<float>::Type::HANN): mFFT(fftSize) {
+		mFFT.setWindow(window);
+	}
+
+	std::string getName() const override { return "stft"; }
+	size_t getSize() const override { return 2 * (mFFT.getSize() / 2 + 1); }
+
+	void process(const float * const *inputs, float *output) override {
+		mFFT.forward(inputs[0]);
+		std::memcpy(output, mFFT.getOutput().data(), getSize() * sizeof(float));
+	}
+
+protected:
+	dsp::RealFFT mFFT;
+};
+
+#endif
+
+/// magnitude (like RealFFT::getPower()) or squared magnitude of an StftNode
+class PowerNode : public FeatureNode {
+public:
+
+	PowerNode(size_t fftSize, bool squared=false): mNumBins(fftSize / 2 + 1), mIsSquared(squared) {}
+
+	std::string getName() const override { return mIsSquared ? "power" : "magnitude"; }
+	size_t getSize() const override { return mNumBins; }
+
+	void process(const float * const *inputs, float *output) override {
+		const float *spectrum = inputs[0];
+		for (size_t k = 0; k < mNumBins; k++) {
+			float re = spectrum[2 * k], im = spectrum[2 * k + 1];
+			float power = re * re + im * im;
+			output[k] = mIsSquared ? power : std::sqrt(power);
+		}
+	}
+
+protected:
+	size_t mNumBins;
+	bool mIsSquared;
+};
+
+
+/// a SparseFilterbank over a PowerNode, optionally log(energy + logOffset)
+class FilterbankNode : public FeatureNode {
+public:
+
+	FilterbankNode(dsp::SparseFilterbank<float> filterbank, bool log=false, float logOffset=1e-6f):
+	mFilterbank(std::move(filterbank)), mIsLog(log), mLogOffset(logOffset) {}
+
+	std::string getName() const override { return "filterbank"; }
+	size_t getSize() const override { return mFilterbank.getNumBands(); }
+
+	void process(const float * const *inputs, float *output) override {
+		mFilterbank.apply(inputs[0], output);
+		if (mIsLog) simd::log(output, output, getSize(), mLogOffset);
+	}
+
+protected:
+	dsp::SparseFilterbank<float> mFilterbank;
+	bool mIsLog;
+	float mLogOffset;
+};
+
+
+/// log mel energies
+class MelNode : public FilterbankNode {
+public:
+
+	MelNode(dsp::MelFilterSettings s, bool log=true):
+	FilterbankNode(dsp::SparseFilterbank<float>(dsp::melFilterbank<float>(s)), log) {}
+
+	std::string getName() const override { return "mel"; }
+};
+
+
+/// chroma energies normalised to add up to 1
+class ChromaNode : public FilterbankNode {
+public:
+
+	ChromaNode(dsp::ChromaFilterSettings s):
+	FilterbankNode(dsp::SparseFilterbank<float>(dsp::chromaFilterbank<float>(s), 1e-4f)) {}
+
+	std::string getName() const override { return "chroma"; }
+
+	void process(const float * const *inputs, float *output) override {
+		FilterbankNode::process(inputs, output);
+		float total = 1e-9f;
+		for (size_t c = 0; c < getSize(); c++) total+= output[c];
+		for (size_t c = 0; c < getSize(); c++) output[c]/= total;
+	}
+};
+
+
+/// one value, the half wave rectified increase of log(1 + compression * magnitude) over
+/// all bins of a PowerNode, summed
+class FluxNode : public FeatureNode {
+public:
+
+	FluxNode(size_t fftSize, float compression=1000.0f): mNumBins(fftSize / 2 + 1), mCompression(compression) {
+		mCurrent.assign(mNumBins, 0.0f);
+		mPrevious.assign(mNumBins, 0.0f);
+		reset();
+	}
+
+	std::string getName() const override { return "flux"; }
+	size_t getSize() const override { return 1; }
+
+	void reset() override { mHasPrevious = false; }
+
+	void process(const float * const *inputs, float *output) override {
+
+		// log(1 + c x) = log(x + 1 / c) + log(c)
+		simd::log(inputs[0], &mCurrent[0], mNumBins, 1.0f / mCompression);
+
+		float flux = 0;
+		if (mHasPrevious) {
+			using simd::float4;
+			const float4 zero(0.0f);
+			float4 sum(0.0f);
+			size_t k = 0;
+			for (; k + 4 <= mNumBins; k+= 4) {
+				sum+= max(float4::load(&mCurrent[k]) - float4::load(&mPrevious[k]), zero);
+			}
+			flux = sum.sum();
+			for (; k < mNumBins; k++) flux+= std::max(mCurrent[k] - mPrevious[k], 0.0f);
+		}
+		std::swap(mCurrent, mPrevious);
+		mHasPrevious = true;
+		output[0] = flux / mNumBins;
+	}
+
+protected:
+	size_t mNumBins;
+	float mCompression;
+	AlignedVector<float> mCurrent, mPrevious;
+	bool mHasPrevious;
+};
+
+
+/// SpectralFluxOnsetDetector over a PowerNode, the flux of each band then 1 or 0 for an
+/// onset in each band
+class OnsetNode : public FeatureNode {
+public:
+
+	OnsetNode(size_t fftSize, float sampleRate=44100,
+			  const std::vector<SpectralFluxOnsetDetector::Band> &bands={ { 30, 150 }, { 150, 2500 }, { 5000, 16000 } }):
+	mDetector(fftSize, sampleRate, bands) {}
+
+	std::string getName() const override { return "onset"; }
+	size_t getSize() const override { return 2 * mDetector.getNumBands(); }
+
+	void reset() override { mDetector.reset(); }
+
+	void process(const float * const *inputs, float *output) override {
+		mDetector.process(inputs[0]);
+		const size_t B = mDetector.getNumBands();
+		for (size_t b = 0; b < B; b++) {
+			output[b] = mDetector.getFlux(b);
+			output[B + b] = mDetector.isOnset(b) ? 1.0f : 0.0f;
+		}
+	}
+
+	SpectralFluxOnsetDetector& getDetector() { return mDetector; }
+
+protected:
+	SpectralFluxOnsetDetector mDetector;
+};
+
+
+#ifdef USE_FFTW
+
+/// BPM from TempoEstimator, the onset strength being the sum of the first numValues of
+/// the input (eg. a FluxNode, or the band fluxes of an OnsetNode)
+class TempoNode : public FeatureNode {
+public:
+
+	TempoNode(size_t hopSize, float sampleRate=44100, size_t numValues=1, size_t windowLength=512):
+	mEstimator(windowLength), mNumValues(numValues) {
+		mEstimator.setHopSize(hopSize);
+		mEstimator.setSampleRate(sampleRate);
+		mEstimator.setIncremental(true);
+	}
+
+	std::string getName() const override { return "tempo"; }
+	size_t getSize() const override { return 1; }
+
+	void reset() override { mEstimator.reset(); }
+
+	void process(const float * const *inputs, float *output) override {
+		float strength = 0;
+		for (size_t i = 0; i < mNumValues; i++) strength+= inputs[0][i];
+		output[0] = mEstimator.update(strength);
+	}
+
+	TempoEstimator<float>& getEstimator() { return mEstimator; }
+
+protected:
+	TempoEstimator<float> mEstimator;
+	size_t mNumValues;
+};
+
+#endif
+
+/// dsp::MFCC over a PowerNode
+class MfccNode : public FeatureNode {
+public:
+
+	MfccNode(dsp::MelFilterSettings s, uint numCoefficients=13): mMFCC(s, numCoefficients) {}
+
+	std::string getName() const override { return "mfcc"; }
+	size_t getSize() const override { return mMFCC.getNumFeatures(); }
+
+	void reset() override { mMFCC.reset(); }
+
+	void process(const float * const *inputs, float *output) override {
+		mMFCC.process(inputs[0], output);
+	}
+
+	/// setDeltas() changes getSize(), so only before the node is added
+	dsp::MFCC& getMFCC() { return mMFCC; }
+
+protected:
+	dsp::MFCC mMFCC;
+};
+
+
+/// anything else, f(inputs, output) writes size floats
+class FunctionNode : public FeatureNode {
+public:
+
+	using Function = std::function<void(const float * const *inputs, float *output)>;
+
+	FunctionNode(const std::string &name, size_t size, Function f): mName(name), mSize(size), mFunction(f) {}
+
+	std::string getName() const override { return mName; }
+	size_t getSize() const override { return mSize; }
+
+	void process(const float * const *inputs, float *output) override { mFunction(inputs, output); }
+
+protected:
+	std::string mName;
+	size_t mSize;
+	Function mFunction;
+};
+
+} // namespace whg
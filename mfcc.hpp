@@ -0,0 +1,195 @@
+#pragma once
+
+#include "whelpersg/dsp.h"
+#include "whelpersg/simd.h"
+
+#include <vector>
+#include <cmath>
+#include <algorithm>
+
+namespace dsp {
+
+/// Mel frequency cepstral coefficients from magnitude spectra (e.g. RealFFT::getPower()).
+/// mel energies come from a sparse copy of melFilterbank(), then a vectorised log
+/// and an orthonormal DCT-II held as a precomputed matrix.
+/// Deltas (and delta-deltas) are regressions over a ring of past frames, which delays
+/// the output by getLatency() frames so all of a feature vector refers to the same frame.
+/// Nothing is allocated per frame, the batch process() only grows its scratch if needed.
+class MFCC {
+public:
+
+	MFCC(MelFilterSettings s, uint numCoefficients=13):
+	mNumCoefficients(numCoefficients), mDeltaWidth(2),
+	mUseDeltas(false), mUseDeltaDeltas(false), mLogFloor(1e-6f), mNumFramesSeen(0) {
+
+		mFilterbank = SparseFilterbank<float>(melFilterbank<float>(s));
+		mNumBands = s.numBands;
+
+		// orthonormal DCT-II, one row per coefficient
+		mDCT.resize(mNumCoefficients * mNumBands);
+		const double N = mNumBands;
+		for (uint k = 0; k < mNumCoefficients; k++) {
+			double scale = std::sqrt((k == 0 ? 1.0 : 2.0) / N);
+			for (uint n = 0; n < mNumBands; n++) {
+				mDCT[k * mNumBands + n] = scale * std::cos(PI / N * (n + 0.5) * k);
+			}
+		}
+
+		mMel.resize(mNumBands);
+		reset();
+	}
+
+	/// width is the number of frames either side used for the regression
+	void setDeltas(bool deltas, bool deltaDeltas=false, uint width=2) {
+		mUseDeltas = deltas || deltaDeltas;
+		mUseDeltaDeltas = deltaDeltas;
+		mDeltaWidth = std::max(1u, width);
+		reset();
+	}
+
+	/// added to the mel energies before the log so silence doesn't go to -inf
+	void setLogFloor(float f) { mLogFloor = f; }
+
+	void reset() {
+		const size_t ringSize = 4 * mDeltaWidth + 1;
+		mCepstra.assign(ringSize * mNumCoefficients, 0);
+		mDeltas.assign((2 * mDeltaWidth + 1) * mNumCoefficients, 0);
+		mNumFramesSeen = 0;
+
+		mDeltaNorm = 0;
+		for (uint n = 1; n <= mDeltaWidth; n++) {
+			mDeltaNorm+= 2.0f * n * n;
+		}
+	}
+
+	size_t getNumBins() const { return mFilterbank.getNumBins(); }
+	size_t getNumCoefficients() const { return mNumCoefficients; }
+
+	size_t getNumFeatures() const {
+		return mNumCoefficients * (1 + mUseDeltas + mUseDeltaDeltas);
+	}
+
+	/// in frames
+	size_t getLatency() const {
+		return mDeltaWidth * (mUseDeltas + mUseDeltaDeltas);
+	}
+
+	/// spectrum holds getNumBins() values, features getNumFeatures():
+	/// the coefficients, then the deltas and delta-deltas if they're on
+	void process(const float *spectrum, float *features) {
+		mFilterbank.apply(spectrum, &mMel[0]);
+		whg::simd::log(&mMel[0], &mMel[0], mNumBands, mLogFloor);
+		processLogMel(&mMel[0], features);
+	}
+
+	void process(const std::vector<float> &spectrum, std::vector<float> &features) {
+		features.resize(getNumFeatures());
+		process(&spectrum[0], &features[0]);
+	}
+
+	/// numFrames spectra back to back in, numFrames feature vectors back to back out.
+	/// each stage runs over the whole batch before the next so its tables stay in cache
+	void process(const float *spectra, size_t numFrames, float *features) {
+
+		const size_t nbins = getNumBins();
+		if (mBatchMel.size() < numFrames * mNumBands) {
+			mBatchMel.resize(numFrames * mNumBands);
+		}
+
+		for (size_t f = 0; f < numFrames; f++) {
+			mFilterbank.apply(spectra + f * nbins, &mBatchMel[f * mNumBands]);
+		}
+
+		whg::simd::log(&mBatchMel[0], &mBatchMel[0], numFrames * mNumBands, mLogFloor);
+
+		const size_t numFeatures = getNumFeatures();
+		for (size_t f = 0; f < numFrames; f++) {
+			processLogMel(&mBatchMel[f * mNumBands], features + f * numFeatures);
+		}
+	}
+
+protected:
+	uint mNumCoefficients, mNumBands, mDeltaWidth;
+	bool mUseDeltas, mUseDeltaDeltas;
+	float mLogFloor, mDeltaNorm;
+	size_t mNumFramesSeen;
+
+	SparseFilterbank<float> mFilterbank;
+	whg::AlignedVector<float> mDCT;
+	std::vector<float> mMel, mBatchMel;
+
+	// rings of frames, newest at frame index mNumFramesSeen
+	std::vector<float> mCepstra, mDeltas;
+
+	float* ringFrame(std::vector<float> &ring, long frame) {
+		long ringSize = static_cast<long>(ring.size() / mNumCoefficients);
+		long index = ((frame % ringSize) + ringSize) % ringSize;
+		return &ring[index * mNumCoefficients];
+	}
+
+	void processLogMel(const float *logMel, float *features) {
+
+		const long frame = static_cast<long>(mNumFramesSeen);
+		float *cepstrum = ringFrame(mCepstra, frame);
+
+		for (uint k = 0; k < mNumCoefficients; k++) {
+			cepstrum[k] = whg::simd::dot(&mDCT[k * mNumBands], logMel, mNumBands);
+		}
+
+		if (mNumFramesSeen == 0) {
+			// pad the history with the first frame rather than zeros
+			const size_t ringSize = mCepstra.size() / mNumCoefficients;
+			for (size_t i = 1; i < ringSize; i++) {
+				std::copy(cepstrum, cepstrum + mNumCoefficients, ringFrame(mCepstra, frame - i));
+			}
+		}
+		mNumFramesSeen++;
+
+		if (!mUseDeltas) {
+			std::copy(cepstrum, cepstrum + mNumCoefficients, features);
+			return;
+		}
+
+		const long W = mDeltaWidth;
+
+		// deltas for the frame W back, now that W frames after it have arrived
+		float *delta = ringFrame(mDeltas, frame - W);
+		regression(mCepstra, frame - W, delta);
+
+		if (mNumFramesSeen == 1) {
+			for (long i = 1; i <= 2 * W; i++) {
+				std::copy(delta, delta + mNumCoefficients, ringFrame(mDeltas, frame - W - i));
+			}
+		}
+
+		const long outputFrame = frame - static_cast<long>(getLatency());
+		const float *c = ringFrame(mCepstra, outputFrame);
+		std::copy(c, c + mNumCoefficients, features);
+
+		const float *d = ringFrame(mDeltas, outputFrame);
+		std::copy(d, d + mNumCoefficients, features + mNumCoefficients);
+
+		if (mUseDeltaDeltas) {
+			regression(mDeltas, outputFrame, features + 2 * mNumCoefficients);
+		}
+	}
+
+	void regression(std::vector<float> &ring, long centre, float *output) {
+
+		std::fill(output, output + mNumCoefficients, 0.0f);
+
+		for (long n = 1; n <= static_cast<long>(mDeltaWidth); n++) {
+			const float *ahead = ringFrame(ring, centre + n);
+			const float *behind = ringFrame(ring, centre - n);
+			for (uint k = 0; k < mNumCoefficients; k++) {
+				output[k]+= n * (ahead[k] - behind[k]);
+			}
+		}
+
+		for (uint k = 0; k < mNumCoefficients; k++) {
+			output[k]/= mDeltaNorm;
+		}
+	}
+};
+
+} // namespace dsp
@@ -81,16 +81,18 @@ void ofxFlexibleVideoPlayer::load(string framesFolder, string audioFile, float f
 
 	ofxFlexibleSilentVideoPlayer::load(framesFolder, frameRate);
 	
-	//    mSoundtrackSample.load(audioFile);
-	//
-	//    mAudioData.resize(mSoundtrackSample.length);
-	//    for (int i = 0; i < mAudioData.size(); i++) {
-	//        mAudioData[i] = mSoundtrackSample.temp[i] / 32767.0f;
-	//    }}
-	
-	//    mSoundtrackSample.getLength();
-	//    auto audiolength = mSoundtrackSample.length;
+	// mixed down to mono, audioOut() copies it to every output channel
+	whg::WavReader soundtrack(ofToDataPath(audioFile));
+	if (!soundtrack.isOpen()) {
+		ofLogError("ofxFlexibleVideoPlayer") << "couldn't load soundtrack " << audioFile;
+		return;
+	}
 	
+	audioMutex.lock();
+	mAudioData.resize(soundtrack.getNumFrames());
+	soundtrack.readMono(0, soundtrack.getNumFrames(), mAudioData.data());
+	mAudioPlayhead = mLastAudioPlayhead = 0;
+	audioMutex.unlock();
 }
 
 void ofxFlexibleSilentVideoPlayer::update() {
@@ -179,27 +181,22 @@ void ofxFlexibleVideoPlayer::audioOut(ofSoundBuffer& buffer) {
     ofScopedLock lock(audioMutex);
     
     auto &data = buffer.getBuffer();
-    auto mainDataLength = mAudioData.size();
-
     int nChannels = buffer.getNumChannels();
     auto l = buffer.size() / nChannels;
-    auto it = mAudioData.begin() + mAudioPlayhead;
-    // TODO: fix for variable channels
-    for (int i = 0; i < l; i++) {
-        float pos = (mAudioPlayhead + mAudioStep * i);
-        if (pos < 0) pos+= mainDataLength;
-        float a = mAudioData[int(floor(pos)) % mainDataLength];
-        float b = mAudioData[int(ceil(pos)) % mainDataLength];
-        float blend = pos - floor(pos);
-        data[i*2] = data[i*2+1] = a * (1.f - blend) + b * blend;
-    }
     
-    mAudioPlayhead+= l * mAudioStep;
-    if (mAudioPlayhead >= mainDataLength) {
-        mAudioPlayhead-= mainDataLength;
+    if (mAudioData.empty()) {
+        std::fill(data.begin(), data.end(), 0.0f);
+        return;
     }
-    else if (mAudioPlayhead < mainDataLength) {
-        mAudioPlayhead+= mainDataLength;
+    
+    // band limited varispeed, reads backwards for negative speeds and wraps around the soundtrack
+    mResampled.resize(l);
+    mResampler.read(&mAudioData[0], mAudioData.size(), mAudioPlayhead, mAudioStep, &mResampled[0], l);
+    
+    for (int i = 0; i < l; i++) {
+        for (int c = 0; c < nChannels; c++) {
+            data[i*nChannels+c] = mResampled[i];
+        }
     }
 }
 
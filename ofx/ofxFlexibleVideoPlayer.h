@@ -10,6 +10,8 @@
 
 #include "ofMain.h"
 //#include "ofxMaxim.h"
+#include "whelpersg/resample.h"
+#include "whelpersg/wav.h"
 
 class ofxFlexibleSilentVideoPlayer {
 public:
@@ -83,9 +85,12 @@ public:
 protected:
 //	ofxMaxiSample mSoundtrackSample;
 	vector<float> mAudioData;
-	unsigned long mAudioPlayhead, mLastAudioPlayhead;
+	double mAudioPlayhead, mLastAudioPlayhead; // in samples
 	float mAudioStep;
 	
+	dsp::Resampler mResampler;
+	vector<float> mResampled;
+	
 	ofMutex audioMutex;
 
 };
\ No newline at end of file
@@ -5,8 +5,12 @@
 #include "whelpersg/math.h"
 #include "whelpersg/util.h"
 #include "whelpersg/data.h"
+#include "whelpersg/simd.h"
 
 #include <algorithm>
+#include <complex>
+#include <vector>
+#include <utility>
 
 namespace whg {
 
@@ -60,88 +64,376 @@ protected:
 };
 
 
+/// Onsets per frequency band (eg. kick / snare / hats) from consecutive magnitude spectra.
+/// Each band's flux is the half wave rectified increase in (optionally log compressed)
+/// magnitude, averaged over the band's bins. A band fires when its flux goes over
+/// mean + deviations * mean absolute deviation + minimum, both running averages of the
+/// band's own flux, and then sleeps for a few frames. Band state is structure-of-arrays so
+/// four bands update at once.
+class SpectralFluxOnsetDetector {
+public:
+
+	using Band = std::pair<float, float>; // low and high edge in Hz
+
+	SpectralFluxOnsetDetector(size_t fftSize, float sampleRate=44100,
+							  const std::vector<Band> &bands={ { 30, 150 }, { 150, 2500 }, { 5000, 16000 } }):
+	mAdaptation(0.05f), mCompression(1000.0f), mSleepFrames(4) {
+		setBands(fftSize, sampleRate, bands);
+	}
+
+	void setBands(size_t fftSize, float sampleRate, const std::vector<Band> &bands) {
+
+		mNumBins = fftSize / 2 + 1;
+		mNumBands = bands.size();
+		const size_t padded = (mNumBands + 3) & ~static_cast<size_t>(3);
+
+		mStarts.clear();
+		mEnds.clear();
+		for (const auto &band : bands) {
+			size_t start = static_cast<size_t>(std::ceil(band.first * fftSize / sampleRate));
+			size_t end = static_cast<size_t>(std::floor(band.second * fftSize / sampleRate)) + 1;
+			start = std::min(start, mNumBins - 1);
+			mStarts.push_back(start);
+			mEnds.push_back(std::max(std::min(end, mNumBins), start + 1));
+		}
+
+		mDeviations.assign(padded, 1.5f);
+		mMinimums.assign(padded, 0.1f);
+		mFlux.assign(padded, 0.0f);
+		mStrengths.assign(padded, 0.0f);
+		mMeans.assign(padded, 0.0f);
+		mMeanDeviations.assign(padded, 0.0f);
+		mSleep.assign(padded, 0.0f);
+		mOnsets.assign(mNumBands, 0);
+
+		mCurrent.assign(mNumBins, 0.0f);
+		mPrevious.assign(mNumBins, 0.0f);
+		mDifference.assign(mNumBins, 0.0f);
+		mHasPrevious = false;
+	}
+
+	void reset() {
+		std::fill(mMeans.begin(), mMeans.end(), 0.0f);
+		std::fill(mMeanDeviations.begin(), mMeanDeviations.end(), 0.0f);
+		std::fill(mSleep.begin(), mSleep.end(), 0.0f);
+		std::fill(mOnsets.begin(), mOnsets.end(), 0);
+		mHasPrevious = false;
+	}
+
+	/// getNumBins() magnitudes, returns true if any band has an onset this frame
+	bool process(const float *magnitudes) {
+
+		using whg::simd::float4;
+
+		if (mCompression > 0) {
+			// log(1 + c |X|)
+			for (size_t k = 0; k < mNumBins; k++) {
+				mCurrent[k] = magnitudes[k] * mCompression;
+			}
+			whg::simd::log(&mCurrent[0], &mCurrent[0], mNumBins, 1.0f);
+		}
+		else {
+			std::copy(magnitudes, magnitudes + mNumBins, mCurrent.begin());
+		}
+
+		if (!mHasPrevious) {
+			mHasPrevious = true;
+			std::swap(mCurrent, mPrevious);
+			return false;
+		}
+
+		// half wave rectified difference
+		size_t k = 0;
+		for (; k + 4 <= mNumBins; k+= 4) {
+			max(float4::load(&mCurrent[k]) - float4::load(&mPrevious[k]), float4(0.0f)).store(&mDifference[k]);
+		}
+		for (; k < mNumBins; k++) {
+			mDifference[k] = std::max(mCurrent[k] - mPrevious[k], 0.0f);
+		}
+		std::swap(mCurrent, mPrevious);
+
+		for (size_t band = 0; band < mNumBands; band++) {
+			const size_t start = mStarts[band], length = mEnds[band] - mStarts[band];
+			float sum = 0;
+			size_t i = 0;
+			float4 sums(0.0f);
+			for (; i + 4 <= length; i+= 4) {
+				sums+= float4::load(&mDifference[start + i]);
+			}
+			sum = sums.sum();
+			for (; i < length; i++) {
+				sum+= mDifference[start + i];
+			}
+			mFlux[band] = sum / length;
+		}
+
+		// thresholds from the history before this frame, then fold this frame in
+		const float4 a(mAdaptation), one(1.0f), zero(0.0f);
+		for (size_t band = 0; band < mFlux.size(); band+= 4) {
+			float4 flux = float4::load(&mFlux[band]);
+			float4 mean = float4::load(&mMeans[band]);
+			float4 deviation = float4::load(&mMeanDeviations[band]);
+
+			float4 threshold = mean + float4::load(&mDeviations[band]) * deviation + float4::load(&mMinimums[band]);
+			max(flux - threshold, zero).store(&mStrengths[band]);
+
+			float4 diff = flux - mean;
+			float4 absDiff = max(diff, zero - diff);
+			(mean + a * diff).store(&mMeans[band]);
+			(deviation + a * (absDiff - deviation)).store(&mMeanDeviations[band]);
+			(float4::load(&mSleep[band]) - one).store(&mSleep[band]);
+		}
+
+		bool any = false;
+		for (size_t band = 0; band < mNumBands; band++) {
+			mOnsets[band] = mStrengths[band] > 0 && mSleep[band] <= 0;
+			if (mOnsets[band]) {
+				// counted down before the test, so + 1 for mSleepFrames whole frames of quiet
+				mSleep[band] = static_cast<float>(mSleepFrames + 1);
+				any = true;
+			}
+		}
+
+		return any;
+	}
+
+	/// straight from a RealFFT
+	bool process(const std::vector<std::complex<float>> &spectrum) {
+		mMagnitudes.resize(spectrum.size());
+		for (size_t k = 0; k < spectrum.size(); k++) {
+			mMagnitudes[k] = std::abs(spectrum[k]);
+		}
+		return process(&mMagnitudes[0]);
+	}
+
+	bool isOnset(size_t band) const { return mOnsets[band] != 0; }
+
+	/// how far over its threshold each band is this frame, 0 if it isn't
+	float getStrength(size_t band) const { return mStrengths[band]; }
+
+	float getFlux(size_t band) const { return mFlux[band]; }
+
+	size_t getNumBands() const { return mNumBands; }
+	size_t getNumBins() const { return mNumBins; }
+
+	/// standard deviations (well, mean absolute deviations) over the running mean to fire
+	void setDeviations(size_t band, float deviations) { mDeviations[band] = deviations; }
+	void setDeviations(float deviations) { std::fill(mDeviations.begin(), mDeviations.end(), deviations); }
+
+	/// flux always has to be at least this much over the running mean
+	void setMinimum(size_t band, float minimum) { mMinimums[band] = minimum; }
+	void setMinimum(float minimum) { std::fill(mMinimums.begin(), mMinimums.end(), minimum); }
+
+	/// frames a band stays quiet after an onset
+	void setSleepFrames(long frames) { mSleepFrames = frames; }
+
+	/// how quickly the running averages follow the flux, 0 to 1 per frame
+	void setAdaptation(float a) { mAdaptation = a; }
+
+	/// c in log(1 + c |X|), 0 for plain magnitudes
+	void setCompression(float c) { mCompression = c; }
+
+protected:
+	size_t mNumBins, mNumBands;
+	std::vector<size_t> mStarts, mEnds;
+
+	float mAdaptation, mCompression;
+	long mSleepFrames;
+
+	// by band, padded to a multiple of 4
+	whg::AlignedVector<float> mDeviations, mMinimums;
+	whg::AlignedVector<float> mFlux, mStrengths, mMeans, mMeanDeviations, mSleep;
+	std::vector<char> mOnsets;
+
+	// by bin
+	whg::AlignedVector<float> mCurrent, mPrevious, mDifference;
+	std::vector<float> mMagnitudes;
+	bool mHasPrevious;
+};
+
+
+/// Tempo from the autocorrelation of an onset strength signal (one value per hop of audio).
+/// Lags are only searched between the BPM limits. The autocorrelation is either
+///  - recomputed with a zero padded FFT of the window every getUpdateInterval() pushes, or
+///  - incremental: kept up to date for the searched lags on every push, O(lags) instead of
+///    an FFT, which is cheaper while the lag range is small compared to the window.
+/// Both give the same (linear) autocorrelation.
 template<typename T, int sampleRate=44100>
 class TempoEstimator {
 public:
 
 	using bpmType = float;
 	
-	TempoEstimator(): mHopSize(512), mCurrentBpm(120), mFFTPower(512, 0) {
-		mFFT = std::unique_ptr<dsp::RealFFT>(new dsp::RealFFT(512));
+	TempoEstimator(size_t windowLength=512): mHopSize(512), mSampleRate(sampleRate), mMinBpm(69), mMaxBpm(180),
+	mUpdateInterval(1), mIsIncremental(false), mCurrentBpm(120), mFoundValue(0) {
 		
-		mHistory.setCapacity(512);
 		mIntervalCounter.setCapacity(32);
+		setWindowLength(windowLength);
 	}
 	
 	float update(T value) {
 		
-		mHistory.push(value);
-		
-		if (mHistory.data().size() != 512) return 0;
-		
-		// autocorrelation via FFT
-		mFFT->forward(mHistory.data().begin(), mHistory.data().end());
-		mFFT->getPower(mFFTPower);
-		mFFT->inverse(mFFTPower);
-		const auto &ac = mFFT->getInput();
+		const size_t W = mWindowLength;
 
-		// + 1 as we never will want the DC component
-		auto sorted = whg::argsort(ac.begin()+1, ac.end());
-        for (size_t i = sorted.size(); --i > sorted.size() - 6; ) {
-			auto rbpm = (binToBpm(sorted[i]+1));
-			if (rbpm > 69 && rbpm < 180) {
-				
-				mIntervalCounter.increment(smoothBpm(rbpm));
-                mFoundValue = ac[sorted[i]+1];
-                break;
+		// written twice so the window is always contiguous at mRing[mWrite]
+		const float dropped = mRing[mWrite];
+		mRing[mWrite] = mRing[mWrite + W] = static_cast<float>(value);
+		mWrite = mWrite + 1 == W ? 0 : mWrite + 1;
+		const float *window = &mRing[mWrite];
+
+		if (mIsIncremental) {
+			// gains the pair (newest, newest - lag), loses (dropped + lag, dropped)
+			const double newest = value;
+			for (size_t lag = mMinLag; lag <= mMaxLag; lag++) {
+				mAutocorrelation[lag]+= newest * window[W - 1 - lag] - static_cast<double>(window[lag - 1]) * dropped;
 			}
 		}
 
-//        auto localmaxes = whg::localmax(ac.begin(), ac.end());
-//		auto sorted = whg::argsort(ac.begin(), ac.end());
-//        for (size_t i = sorted.size(); --i > 0; ) {
-//            size_t index = sorted[i];
-//            if (localmaxes[index]) {
-//                std::vector<float> mults = { 1.0f / 3.0f, 0.5f, 1.0f, 2.0f, 3.0f };
-//                float maxval = 0.0f;
-//                size_t maxbin = 0;
-//                for (auto mult : mults) {
-//                    size_t bin = static_cast<size_t>(index * mult);
-//                    if (bin < 511) {
-//                        if (ac[bin] > maxval) {
-//                            maxbin = bin;
-//                            maxval = ac[bin];
-//                        }
-//                    }
-//                }
-//                auto bpm = binToBpm(maxbin);
-//                if (bpm > 69 && bpm < 180) {
-//                    mIntervalCounter.increment(smoothBpm(bpm));
-//                }
-//            }
-//        }
+		if (mNumPushed < W) {
+			mNumPushed++;
+			if (mNumPushed < W) return 0;
+		}
 
+		if (++mPushCount < mUpdateInterval) return mCurrentBpm;
+		mPushCount = 0;
+
+		if (!mIsIncremental) {
+			autocorrelate(window);
+		}
+
+		size_t best = mMinLag;
+		for (size_t lag = mMinLag + 1; lag <= mMaxLag; lag++) {
+			if (mAutocorrelation[lag] > mAutocorrelation[best]) best = lag;
+		}
+
+		mIntervalCounter.increment(smoothBpm(binToBpm(best)));
+		mFoundValue = static_cast<float>(mAutocorrelation[best]);
 		mCurrentBpm = mIntervalCounter.getMaxKey();
 		
 		return mCurrentBpm;
 	}
 	
-	void setHopSize(size_t hs) { mHopSize = hs; }
+	/// how many onset values the autocorrelation covers, resets the estimator
+	void setWindowLength(size_t length) {
+		mWindowLength = length;
+		mFFT = std::unique_ptr<dsp::RealFFT>(new dsp::RealFFT(length * 2));
+		mFFT->setNormalisesOutput(false);
+		mPadded.assign(length * 2, 0.0f);
+		mFFTPower.assign(length + 1, 0.0f);
+		reset();
+	}
+	
+	size_t getWindowLength() const { return mWindowLength; }
+	
+	void reset() {
+		mRing.assign(mWindowLength * 2, 0.0f);
+		mAutocorrelation.assign(mWindowLength, 0.0);
+		mWrite = 0;
+		mNumPushed = 0;
+		mPushCount = 0;
+		updateLagRange();
+	}
+	
+	/// audio samples per onset value
+	void setHopSize(size_t hs) {
+		mHopSize = hs;
+		updateLagRange();
+	}
 	
 	size_t getHopSize() { return mHopSize; }
 	
+	void setSampleRate(float sr) {
+		mSampleRate = sr;
+		updateLagRange();
+	}
+	
+	float getSampleRate() const { return mSampleRate; }
+	
+	/// tempos are searched strictly between these
+	void setBpmRange(bpmType minBpm, bpmType maxBpm) {
+		mMinBpm = minBpm;
+		mMaxBpm = maxBpm;
+		updateLagRange();
+	}
+	
+	bpmType getMinBpm() const { return mMinBpm; }
+	bpmType getMaxBpm() const { return mMaxBpm; }
+	
+	/// only estimate every n pushes, the window still moves on every push.
+	/// the interval counter then covers n times as long
+	void setUpdateInterval(size_t n) { mUpdateInterval = std::max<size_t>(n, 1); }
+	
+	size_t getUpdateInterval() const { return mUpdateInterval; }
+	
+	void setIncremental(bool incremental) {
+		if (incremental && !mIsIncremental) {
+			mIsIncremental = true;
+			autocorrelate(&mRing[mWrite]);
+		}
+		mIsIncremental = incremental;
+	}
+	
+	bool isIncremental() const { return mIsIncremental; }
+	
+	bpmType getBpm() const { return mCurrentBpm; }
+	
 protected:
-	size_t mHopSize;
+	size_t mHopSize, mWindowLength;
+	float mSampleRate;
+	bpmType mMinBpm, mMaxBpm;
+	size_t mMinLag, mMaxLag;
+	
+	size_t mUpdateInterval, mPushCount, mNumPushed;
+	bool mIsIncremental;
+	
 	std::unique_ptr<dsp::RealFFT> mFFT;
-	whg::HistoryQueue<T> mHistory;
+	dsp::RealFFT::inputType mPadded;
+	dsp::RealFFT::outputType mFFTPower;
+	
+	std::vector<float> mRing;
+	size_t mWrite;
+	
+	// by lag, double so the incremental sums don't drift
+	std::vector<double> mAutocorrelation;
+	
 	whg::IntervalCounter<float> mIntervalCounter;
-	std::vector<float> mFFTPower;
 	
 	bpmType mCurrentBpm;
 	
 	bpmType binToBpm(size_t binNum) const {
 
-		return 60.0f / (mHopSize / static_cast<float>(sampleRate) * binNum);
+		return 60.0f / (mHopSize / mSampleRate * binNum);
+	}
+	
+	void updateLagRange() {
+		// strictly inside the BPM limits
+		const double lagsPerMinute = 60.0 * mSampleRate / mHopSize;
+		mMinLag = std::max<size_t>(1, static_cast<size_t>(std::floor(lagsPerMinute / mMaxBpm)) + 1);
+		mMaxLag = std::min<size_t>(mWindowLength - 1, static_cast<size_t>(std::max(std::ceil(lagsPerMinute / mMinBpm) - 1.0, 1.0)));
+		mMaxLag = std::max(mMaxLag, mMinLag);
+		
+		if (mIsIncremental) {
+			autocorrelate(&mRing[mWrite]);
+		}
+	}
+	
+	/// linear autocorrelation of the window for the searched lags, via the FFT
+	void autocorrelate(const float *window) {
+		
+		std::copy(window, window + mWindowLength, mPadded.begin());
+		mFFT->forward(&mPadded[0]);
+		
+		const auto &spectrum = mFFT->getOutput();
+		for (size_t k = 0; k < mFFTPower.size(); k++) {
+			mFFTPower[k] = std::norm(spectrum[k]);
+		}
+		mFFT->inverse(mFFTPower);
+		
+		const auto &ac = mFFT->getInput();
+		std::fill(mAutocorrelation.begin(), mAutocorrelation.end(), 0.0);
+		for (size_t lag = mMinLag; lag <= mMaxLag; lag++) {
+			mAutocorrelation[lag] = ac[lag];
+		}
 	}
 	
 	bpmType smoothBpm(bpmType bpm) {
@@ -158,4 +450,175 @@ public:
 	
 };
 
+
+/// Causal beat tracking as a phase locked loop, for firing cues ahead of the beat.
+/// The beat period follows the tempo estimate, peaks in the onset strength near a predicted
+/// beat pull the phase (and slightly the period) towards them. Time is counted in onset
+/// values, one per hop of audio, from the first update(). Beats can only fire on an update,
+/// use getNextBeatTime() for anything that needs better than a hop.
+template<typename T>
+class BeatTracker {
+public:
+
+	using bpmType = float;
+
+	BeatTracker(size_t hopSize=512, float sampleRate=44100): mHopSize(hopSize), mSampleRate(sampleRate),
+	mPhaseGain(0.2), mPeriodGain(0.02), mWindow(0.2), mThreshold(1.0), mLatency(0) {
+		reset();
+	}
+
+	void reset() {
+		mFrame = 0;
+		mBeats = 0;
+		mPeriod = 60.0 / (120.0 * getHopSeconds());
+		mTempoPeriod = 0;
+		mLastFired = 0;
+		mMean = 0;
+		mVariance = 0;
+		mPrevious = mBeforePrevious = 0;
+		mHasTempo = mIsLocked = false;
+		mHits = mMisses = 0;
+	}
+
+	/// one onset strength value per hop and the current tempo estimate (0 if there isn't one yet).
+	/// returns true if a beat should be fired now, getLatencyCompensation() ahead of it
+	bool update(T strength, bpmType bpm) {
+
+		mFrame++;
+
+		if (bpm > 0) {
+			double target = 60.0 / (bpm * getHopSeconds());
+			if (mIsLocked && (isNear(target, mTempoPeriod * 2.0) || isNear(target, mTempoPeriod * 0.5))) {
+				// the estimate jumped an octave, keep following the one we're locked to
+			}
+			else {
+				if (!mHasTempo || !isNear(target, mTempoPeriod)) {
+					// a new tempo, take it as is and find the phase again
+					mPeriod = target;
+					mHasTempo = true;
+					mIsLocked = false;
+					mHits = mMisses = 0;
+				}
+				mTempoPeriod = target;
+			}
+		}
+
+		mBeats+= 1.0 / mPeriod;
+
+		// the previous value was a peak standing out from the recent average
+		const double value = strength;
+		const double deviation = std::sqrt(mVariance);
+		if (mPrevious > mBeforePrevious && mPrevious >= value && mPrevious > mMean + mThreshold * deviation && mHasTempo) {
+
+			// where the peak was relative to the nearest predicted beat, in beats
+			double position = mBeats - 1.0 / mPeriod;
+			double error = position - std::round(position);
+			double weight = std::min((mPrevious - mMean) / (4.0 * deviation + 1e-12), 1.0);
+
+			if (!mIsLocked) {
+				// acquiring, every peak counts until a few in a row land near the prediction
+				mBeats-= 0.5 * weight * error;
+				mHits = std::abs(error) < mWindow ? mHits + 1 : 0;
+				mIsLocked = mHits >= 4;
+			}
+			else if (std::abs(error) < mWindow) {
+				mBeats-= mPhaseGain * weight * error;
+				mPeriod*= 1.0 + mPeriodGain * weight * error;
+				mMisses = 0;
+			}
+			else if (++mMisses >= 8) {
+				// lost it
+				mIsLocked = false;
+				mHits = mMisses = 0;
+			}
+
+			// only drift a little from the tempo estimate
+			mPeriod = std::min(std::max(mPeriod, 0.95 * mTempoPeriod), 1.05 * mTempoPeriod);
+		}
+
+		// running statistics of the onset strength, for the peak threshold
+		const double alpha = 0.02;
+		double diff = value - mMean;
+		mMean+= alpha * diff;
+		mVariance = (1.0 - alpha) * (mVariance + alpha * diff * diff);
+
+		mBeforePrevious = mPrevious;
+		mPrevious = value;
+
+		if (!mHasTempo) return false;
+
+		// fire once per beat, as soon as the beat is within the latency
+		long ahead = static_cast<long>(std::floor(mBeats + mLatency / getBeatSeconds()));
+		if (ahead > mLastFired) {
+			mLastFired = ahead;
+			return true;
+		}
+		return false;
+	}
+
+	/// where we are in the current beat, 0 to 1
+	double getPhase() const { return mBeats - std::floor(mBeats); }
+
+	/// in seconds since the first update(), same clock as getTime()
+	double getNextBeatTime() const {
+		return getTime() + (1.0 - getPhase()) * getBeatSeconds();
+	}
+
+	/// of the latest onset value, each is taken to be at the centre of its hop
+	double getTime() const { return (mFrame - 0.5) * getHopSeconds(); }
+
+	double getBeatSeconds() const { return mPeriod * getHopSeconds(); }
+
+	bpmType getBpm() const { return static_cast<bpmType>(60.0 / getBeatSeconds()); }
+
+	bool hasTempo() const { return mHasTempo; }
+
+	/// whether recent peaks agree with the predicted beats
+	bool isLocked() const { return mIsLocked; }
+
+	/// fire beats this many seconds early, eg. the response time of a light
+	void setLatencyCompensation(double seconds) { mLatency = seconds; }
+	double getLatencyCompensation() const { return mLatency; }
+
+	/// how much of the phase error is corrected on each peak (0 to 1) and how much the
+	/// period moves per beat of error
+	void setGains(double phase, double period) {
+		mPhaseGain = phase;
+		mPeriodGain = period;
+	}
+
+	/// peaks further than this from a predicted beat (in beats) are ignored
+	void setWindow(double beats) { mWindow = beats; }
+
+	/// peaks have to be this many standard deviations over the running mean
+	void setThreshold(double deviations) { mThreshold = deviations; }
+
+	void setHopSize(size_t hs) { mHopSize = hs; }
+	size_t getHopSize() const { return mHopSize; }
+
+	void setSampleRate(float sr) { mSampleRate = sr; }
+	float getSampleRate() const { return mSampleRate; }
+
+protected:
+	size_t mHopSize;
+	float mSampleRate;
+
+	double mPhaseGain, mPeriodGain, mWindow, mThreshold, mLatency;
+
+	size_t mFrame;
+	double mBeats; // beats since the start, the phase is the fractional part
+	double mPeriod, mTempoPeriod; // in onset values per beat
+	long mLastFired;
+
+	double mMean, mVariance, mPrevious, mBeforePrevious;
+	bool mHasTempo, mIsLocked;
+	size_t mHits, mMisses;
+
+	double getHopSeconds() const { return mHopSize / static_cast<double>(mSampleRate); }
+
+	static bool isNear(double period, double reference) {
+		return std::abs(period - reference) <= 0.04 * reference;
+	}
+};
+
 }
\ No newline at end of file
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <future>
+#include <functional>
+#include <memory>
+#include <algorithm>
+
+namespace whg {
+
+/// A fixed set of worker threads taking tasks from one queue.
+/// The destructor finishes everything already submitted before joining.
+class ThreadPool {
+public:
+
+	ThreadPool(size_t numThreads=0): mIsAlive(true) {
+		if (numThreads == 0) {
+			numThreads = std::max(1u, std::thread::hardware_concurrency());
+		}
+		for (size_t i = 0; i < numThreads; i++) {
+			mThreads.emplace_back(&ThreadPool::work, this);
+		}
+	}
+
+	~ThreadPool() {
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mIsAlive = false;
+		}
+		mCondition.notify_all();
+		for (auto &thread : mThreads) {
+			thread.join();
+		}
+	}
+
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/// runs f() on a worker, the future has its result (or exception)
+	template <class F>
+	auto submit(F f) -> std::future<decltype(f())> {
+
+		using result_type = decltype(f());
+		auto task = std::make_shared<std::packaged_task<result_type()>>(std::move(f));
+		std::future<result_type> result = task->get_future();
+
+		{
+			std::lock_guard<std::mutex> lock(mMutex);
+			mTasks.emplace_back([task]() { (*task)(); });
+		}
+		mCondition.notify_one();
+		return result;
+	}
+
+	size_t size() const { return mThreads.size(); }
+
+protected:
+	std::vector<std::thread> mThreads;
+	std::deque<std::function<void()>> mTasks;
+	std::mutex mMutex;
+	std::condition_variable mCondition;
+	bool mIsAlive;
+
+	void work() {
+		while (true) {
+			std::function<void()> task;
+			{
+				std::unique_lock<std::mutex> lock(mMutex);
+				mCondition.wait(lock, [this]() { return !mIsAlive || !mTasks.empty(); });
+				if (mTasks.empty()) return;
+				task = std::move(mTasks.front());
+				mTasks.pop_front();
+			}
+			task();
+		}
+	}
+};
+
+
+/// f(i) for every i in [begin, end) as separate tasks, returns when all are done and
+/// rethrows the first exception
+template <class F>
+inline void parallelFor(ThreadPool &pool, size_t begin, size_t end, F f) {
+
+	std::vector<std::future<void>> results;
+	results.reserve(end - begin);
+	for (size_t i = begin; i < end; i++) {
+		results.push_back(pool.submit([&f, i]() { f(i); }));
+	}
+	for (auto &result : results) {
+		result.get();
+	}
+}
+
+} // namespace whg
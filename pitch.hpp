@@ -0,0 +1,271 @@
+#pragma once
+
+#include "whelpersg/dsp.h"
+
+#include <vector>
+#include <complex>
+#include <memory>
+#include <cmath>
+#include <algorithm>
+
+namespace dsp {
+
+#ifdef USE_FFTW
+
+struct PitchSettings {
+
+	enum class Method { YIN, MCLEOD };
+
+	Method method = Method::YIN;
+	uint sampleRate = 44100;
+	uint frameSize = 2048;
+	uint hopSize = 256;
+	float minFrequency = 60; // also limited by the frame, lags only go up to frameSize / 2
+	float maxFrequency = 1500;
+	float yinThreshold = 0.15f; // first dip of the normalised difference under this
+	float mcleodCutoff = 0.9f; // first NSDF peak at least this fraction of the highest
+};
+
+
+/// Monophonic pitch from frames of frameSize every hopSize samples, either YIN (cumulative
+/// mean normalised difference) or McLeod (normalised square difference). Both come from one
+/// autocorrelation per frame, a zero padded RealFFT of twice the frame that is planned once.
+class PitchDetector {
+public:
+
+	using Method = PitchSettings::Method;
+
+	PitchDetector(PitchSettings s=PitchSettings()) {
+		setup(s);
+	}
+
+	void setup(PitchSettings s) {
+
+		mSettings = s;
+		const size_t W = s.frameSize;
+
+		mFFT = std::unique_ptr<RealFFT>(new RealFFT(W * 2));
+		mFFT->setNormalisesOutput(false);
+
+		mPadded.assign(W * 2, 0.0f);
+		mPower.assign(W + 1, 0.0f);
+		mRing.assign(W * 2, 0.0f);
+		mDifference.resize(W / 2 + 2);
+		mNormalised.resize(W / 2 + 2);
+
+		mMinLag = std::max<size_t>(2, static_cast<size_t>(std::floor(s.sampleRate / s.maxFrequency)));
+		mMaxLag = std::min<size_t>(W / 2, static_cast<size_t>(std::ceil(s.sampleRate / s.minFrequency)));
+
+		reset();
+	}
+
+	void reset() {
+		std::fill(mRing.begin(), mRing.end(), 0.0f);
+		mWrite = 0;
+		mHopCount = 0;
+		mFrequency = 0;
+		mConfidence = 0;
+	}
+
+	/// streams samples in, returns true if at least one new estimate was made
+	bool process(const float *input, size_t N) {
+
+		const size_t W = mSettings.frameSize;
+		bool updated = false;
+
+		for (size_t i = 0; i < N; i++) {
+
+			// written twice so the latest frame is always contiguous at mRing[mWrite]
+			mRing[mWrite] = mRing[mWrite + W] = input[i];
+			mWrite = mWrite + 1 == W ? 0 : mWrite + 1;
+
+			if (++mHopCount == mSettings.hopSize) {
+				mHopCount = 0;
+				analyse(&mRing[mWrite]);
+				updated = true;
+			}
+		}
+
+		return updated;
+	}
+
+	bool process(const std::vector<float> &input) {
+		return process(&input[0], input.size());
+	}
+
+	/// estimate from a single frame of frameSize samples
+	void analyse(const float *frame) {
+
+		autocorrelate(frame);
+
+		if (mSettings.method == Method::YIN) {
+			yin();
+		}
+		else {
+			mcleod();
+		}
+	}
+
+	/// in Hz, the best guess even when unvoiced so check getConfidence()
+	float getFrequency() const { return mFrequency; }
+
+	/// 0 to 1, 1 - the normalised difference for YIN, the NSDF peak (clarity) for McLeod
+	float getConfidence() const { return mConfidence; }
+
+	/// in samples, from the newest sample to the centre of the analysed frame
+	size_t getLatency() const { return mSettings.frameSize / 2; }
+
+	const PitchSettings& getSettings() const { return mSettings; }
+
+protected:
+	PitchSettings mSettings;
+	std::unique_ptr<RealFFT> mFFT;
+	RealFFT::inputType mPadded;
+	RealFFT::outputType mPower;
+
+	std::vector<float> mRing;
+	size_t mWrite, mHopCount;
+	size_t mMinLag, mMaxLag;
+
+	// indexed by lag, up to mMaxLag + 1
+	std::vector<double> mDifference, mNormalised;
+	std::vector<size_t> mKeyMaxima;
+
+	float mFrequency, mConfidence;
+
+	/// fills mDifference with the squared difference and mNormalised with the NSDF
+	void autocorrelate(const float *frame) {
+
+		const size_t W = mSettings.frameSize;
+
+		// linear (not circular) autocorrelation thanks to the padding
+		std::copy(frame, frame + W, mPadded.begin());
+		mFFT->forward(&mPadded[0]);
+
+		const auto &spectrum = mFFT->getOutput();
+		for (size_t k = 0; k < mPower.size(); k++) {
+			mPower[k] = std::norm(spectrum[k]);
+		}
+		mFFT->inverse(mPower);
+		const auto &r = mFFT->getInput();
+
+		// m(lag) = sum of x[j]^2 + x[j+lag]^2 over the overlap, shrinking by one sample at each end
+		double m = 0;
+		for (size_t j = 0; j < W; j++) {
+			m+= 2.0 * frame[j] * frame[j];
+		}
+
+		for (size_t lag = 0; lag <= mMaxLag + 1; lag++) {
+			if (lag > 0) {
+				m-= static_cast<double>(frame[lag-1]) * frame[lag-1] + static_cast<double>(frame[W-lag]) * frame[W-lag];
+			}
+			mDifference[lag] = std::max(m - 2.0 * r[lag], 0.0);
+			mNormalised[lag] = m > 1e-12 ? 2.0 * r[lag] / m : 0.0;
+		}
+	}
+
+	void yin() {
+
+		// cumulative mean normalised difference, reusing mNormalised
+		auto &cmndf = mNormalised;
+		cmndf[0] = 1;
+		double sum = 0;
+		for (size_t lag = 1; lag <= mMaxLag + 1; lag++) {
+			sum+= mDifference[lag];
+			cmndf[lag] = sum > 0 ? mDifference[lag] * lag / sum : 1.0;
+		}
+
+		size_t best = 0;
+		for (size_t lag = mMinLag; lag <= mMaxLag; lag++) {
+			if (cmndf[lag] < mSettings.yinThreshold) {
+				// follow the dip down to its minimum
+				while (lag + 1 <= mMaxLag && cmndf[lag+1] < cmndf[lag]) lag++;
+				best = lag;
+				break;
+			}
+		}
+
+		if (best == 0) {
+			// nothing under the threshold, fall back to the deepest dip
+			best = mMinLag;
+			for (size_t lag = mMinLag; lag <= mMaxLag; lag++) {
+				if (cmndf[lag] < cmndf[best]) best = lag;
+			}
+		}
+
+		double value;
+		double lag = interpolate(cmndf, best, value);
+		mFrequency = static_cast<float>(mSettings.sampleRate / lag);
+		mConfidence = static_cast<float>(std::min(std::max(1.0 - value, 0.0), 1.0));
+	}
+
+	void mcleod() {
+
+		const auto &nsdf = mNormalised;
+
+		// key maxima: the highest point of each positive region after the first negative one
+		mKeyMaxima.clear();
+		size_t lag = 1;
+		while (lag <= mMaxLag && nsdf[lag] > 0) lag++;
+
+		double highest = 0;
+		while (lag <= mMaxLag) {
+
+			while (lag <= mMaxLag && nsdf[lag] <= 0) lag++;
+
+			size_t peak = lag;
+			while (lag <= mMaxLag && nsdf[lag] > 0) {
+				if (nsdf[lag] > nsdf[peak]) peak = lag;
+				lag++;
+			}
+
+			if (peak <= mMaxLag && peak >= mMinLag) {
+				mKeyMaxima.push_back(peak);
+				highest = std::max(highest, nsdf[peak]);
+			}
+		}
+
+		if (mKeyMaxima.empty()) {
+			mFrequency = 0;
+			mConfidence = 0;
+			return;
+		}
+
+		size_t best = mKeyMaxima.front();
+		for (size_t peak : mKeyMaxima) {
+			if (nsdf[peak] >= mSettings.mcleodCutoff * highest) {
+				best = peak;
+				break;
+			}
+		}
+
+		double value;
+		double interpolated = interpolate(nsdf, best, value);
+		mFrequency = static_cast<float>(mSettings.sampleRate / interpolated);
+		mConfidence = static_cast<float>(std::min(std::max(value, 0.0), 1.0));
+	}
+
+	/// parabola through lag and its neighbours, returns the fractional lag and sets the value there
+	static double interpolate(const std::vector<double> &y, size_t lag, double &value) {
+
+		if (lag == 0 || lag + 1 >= y.size()) {
+			value = y[lag];
+			return lag;
+		}
+
+		double a = y[lag-1], b = y[lag], c = y[lag+1];
+		double denominator = a - 2.0 * b + c;
+		if (std::abs(denominator) < 1e-12) {
+			value = b;
+			return lag;
+		}
+
+		double offset = std::min(std::max(0.5 * (a - c) / denominator, -0.5), 0.5);
+		value = b - 0.25 * (a - c) * offset;
+		return lag + offset;
+	}
+};
+
+#endif // end USE_FFTW
+
+} // namespace dsp
@@ -0,0 +1,432 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <deque>
+#include <limits>
+
+#include "whelpersg/buffer.h"
+#include "whelpersg/stats.h"
+
+#if defined(USE_TSC) && (defined(__x86_64__) || defined(__i386__))
+#include <x86intrin.h>
+#define WHG_PROFILE_TSC 1
+#elif defined(USE_TSC) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define WHG_PROFILE_TSC 1
+#endif
+
+/// Profiling zones, for code as hot as audio callbacks:
+///   void process() {
+///       WHG_PROFILE_ZONE("process");
+///       ...
+///   }
+/// A zone takes two timestamps and pushes one event onto its thread's lock-free queue. A
+/// background thread (Profiler::start()) drains the queues every so often and keeps count,
+/// min, mean, max and percentiles for each zone, Profiler::print() shows them.
+/// Timestamps are steady_clock nanoseconds, or with USE_TSC on x86 the time stamp counter
+/// (cheaper to read, converted to nanoseconds against steady_clock). Zones are named by string
+/// literals and compile to nothing with NO_PROFILE.
+/// With setTraceLength() the Profiler also keeps the last few seconds of events, which
+/// saveTrace() writes as Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev) to see
+/// how threads interleave around a glitch after it's happened.
+namespace whg {
+namespace profile {
+
+/// where a zone is, one static per WHG_PROFILE_ZONE()
+struct Zone {
+	const char *name;
+	const char *file;
+	int line;
+};
+
+struct Event {
+	const Zone *zone;
+	uint64_t start, end; // ticks, see now()
+	uint32_t depth; // how many zones it's in on its thread
+};
+
+inline uint64_t now() {
+#ifdef WHG_PROFILE_TSC
+	return __rdtsc();
+#else
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// one thread's events, written by the thread and read by the Profiler
+struct ThreadBuffer {
+	AtomicSingleQueue<Event> events;
+	uint32_t index; // in the order threads first recorded a zone
+	uint32_t depth;
+	std::atomic<uint64_t> numDropped;
+	std::atomic<bool> hasExited;
+
+	ThreadBuffer(size_t capacity, uint32_t index): events(capacity), index(index), depth(0), numDropped(0), hasExited(false) {}
+
+	void push(const Event &event) {
+		if (!events.push(Event(event))) {
+			numDropped.store(numDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+		}
+	}
+};
+
+/// an event kept for tracing, times in nanoseconds since the Profiler started
+struct TraceEvent {
+	const Zone *zone;
+	double start, duration;
+	uint32_t thread, depth;
+};
+
+struct ZoneStats {
+	const Zone *zone;
+	uint64_t count;
+	double min, mean, max, p50, p99, p999; // nanoseconds
+};
+
+
+/// Gathers every thread's zones. Recording works whether or not start() has been called,
+/// without it collect() has to be called often enough that the queues don't fill up
+/// (events are dropped then, and counted).
+class Profiler {
+public:
+
+	static Profiler& get() {
+		static Profiler profiler;
+		return profiler;
+	}
+
+	~Profiler() {
+		stop();
+	}
+
+	/// the calling thread's buffer, made the first time
+	static ThreadBuffer& getThreadBuffer() {
+		static thread_local ThreadBuffer *buffer = nullptr;
+		if (!buffer) buffer = get().addThread();
+		return *buffer;
+	}
+
+	/// collect() every period on a background thread
+	void start(std::chrono::milliseconds period=std::chrono::milliseconds(50)) {
+		stop();
+		mIsRunning = true;
+		mThread = std::thread([this, period]() {
+			std::unique_lock<std::mutex> lock(mRunMutex);
+			while (mIsRunning) {
+				mRunCondition.wait_for(lock, period);
+				collect();
+			}
+		});
+	}
+
+	void stop() {
+		if (mThread.joinable()) {
+			{
+				std::lock_guard<std::mutex> lock(mRunMutex);
+				mIsRunning = false;
+			}
+			mRunCondition.notify_all();
+			mThread.join();
+		}
+	}
+
+	/// drains every thread's events into the stats
+	void collect() {
+
+		std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+		{
+			std::lock_guard<std::mutex> lock(mThreadsMutex);
+			buffers = mThreads;
+		}
+
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		const double nsPerTick = calibrate();
+		Event event;
+		for (const auto &buffer : buffers) {
+			while (buffer->events.pop(event)) {
+				add(event, *buffer, nsPerTick);
+			}
+		}
+		pruneTrace();
+
+		// threads that have gone, once they're drained
+		std::lock_guard<std::mutex> threadsLock(mThreadsMutex);
+		for (auto it = mThreads.begin(); it != mThreads.end();) {
+			if ((*it)->hasExited.load() && (*it)->events.empty()) {
+				mNumDroppedByExited+= (*it)->numDropped.load();
+				it = mThreads.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+	}
+
+	/// every zone recorded since the last reset(), slowest total first
+	std::vector<ZoneStats> getStats() const {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		std::vector<ZoneStats> output;
+		for (const auto &entry : mZones) {
+			const HistogramSummary s = entry.second.getSummary();
+			output.push_back({ entry.first, s.count, s.min, s.mean, s.max, s.p50, s.p99, s.p999 });
+		}
+		std::sort(output.begin(), output.end(), [](const ZoneStats &a, const ZoneStats &b) {
+			return a.mean * a.count > b.mean * b.count;
+		});
+		return output;
+	}
+
+	/// events lost to full queues
+	uint64_t getNumDropped() const {
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		uint64_t total = mNumDroppedByExited;
+		for (const auto &buffer : mThreads) total+= buffer->numDropped.load();
+		return total;
+	}
+
+	void reset() {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mZones.clear();
+		mTrace.clear();
+		mNewestTraceEnd = 0;
+	}
+
+	/// a table of getStats() in microseconds
+	void print(std::ostream &os=std::cout) const {
+		os << std::setw(32) << "zone" << std::setw(12) << "count" << std::setw(12) << "min us" << std::setw(12) << "mean us"
+		<< std::setw(12) << "p50 us" << std::setw(12) << "p99 us" << std::setw(12) << "p99.9 us" << std::setw(12) << "max us" << std::endl;
+		for (const auto &s : getStats()) {
+			os << std::setw(32) << s.zone->name << std::setw(12) << s.count << std::setw(12) << s.min / 1e3
+			<< std::setw(12) << s.mean / 1e3 << std::setw(12) << s.p50 / 1e3 << std::setw(12) << s.p99 / 1e3 << std::setw(12) << s.p999 / 1e3
+			<< std::setw(12) << s.max / 1e3 << std::endl;
+		}
+		if (uint64_t dropped = getNumDropped()) os << dropped << " events dropped" << std::endl;
+	}
+
+	/// events each thread can hold between collect()s, for threads that start recording after
+	void setQueueSize(size_t numEvents) { mQueueSize = numEvents; }
+
+	/// names the calling thread in traces, otherwise it's "thread <index>"
+	static void setThreadName(const std::string &name) {
+		ThreadBuffer &buffer = getThreadBuffer();
+		Profiler &profiler = get();
+		std::lock_guard<std::mutex> lock(profiler.mThreadsMutex);
+		profiler.mThreadNames[buffer.index] = name;
+	}
+
+	/// keeps the last seconds of events (as of the newest collected) for saveTrace(), at most
+	/// maxEvents of them, 0 seconds stops tracing
+	void setTraceLength(double seconds, size_t maxEvents=1 << 20) {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		mTraceLength = seconds * 1e9;
+		mMaxTraceEvents = maxEvents;
+		if (seconds <= 0) mTrace.clear();
+		pruneTrace();
+	}
+
+	size_t getNumTraceEvents() const {
+		std::lock_guard<std::mutex> lock(mStatsMutex);
+		return mTrace.size();
+	}
+
+	/// collects then writes the last seconds of the trace as Chrome trace_event JSON, one
+	/// track per thread with zones nested on it
+	void writeTrace(std::ostream &os, double seconds=std::numeric_limits<double>::infinity()) {
+		collect();
+
+		std::vector<TraceEvent> events;
+		{
+			std::lock_guard<std::mutex> lock(mStatsMutex);
+			const double from = mNewestTraceEnd - seconds * 1e9;
+			for (const auto &event : mTrace) {
+				if (event.start + event.duration >= from) events.push_back(event);
+			}
+		}
+		std::sort(events.begin(), events.end(), [](const TraceEvent &a, const TraceEvent &b) {
+			return a.start < b.start || (a.start == b.start && a.depth < b.depth);
+		});
+		std::unordered_map<uint32_t, std::string> names;
+		uint32_t numThreads;
+		{
+			std::lock_guard<std::mutex> lock(mThreadsMutex);
+			names = mThreadNames;
+			numThreads = mNumThreads;
+		}
+
+		const auto flags = os.flags();
+		const auto precision = os.precision();
+		os << std::fixed << std::setprecision(3) << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+		for (uint32_t t = 0; t < numThreads; t++) {
+			auto name = names.find(t);
+			os << (t ? ",\n" : "\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << t << ",\"args\":{\"name\":";
+			writeJsonString(os, name != names.end() ? name->second.c_str() : ("thread " + std::to_string(t)).c_str());
+			os << "}}";
+		}
+		for (const auto &event : events) {
+			os << ",\n{\"name\":";
+			writeJsonString(os, event.zone->name);
+			os << ",\"cat\":\"zone\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread << ",\"ts\":" << event.start / 1e3
+			<< ",\"dur\":" << event.duration / 1e3 << ",\"args\":{\"depth\":" << event.depth << ",\"file\":";
+			writeJsonString(os, event.zone->file);
+			os << ",\"line\":" << event.zone->line << "}}";
+		}
+		os << "\n]}\n";
+		os.flags(flags);
+		os.precision(precision);
+	}
+
+	/// writeTrace() to a file
+	bool saveTrace(const std::string &path, double seconds=std::numeric_limits<double>::infinity()) {
+		std::ofstream file(path);
+		if (!file) return false;
+		writeTrace(file, seconds);
+		return static_cast<bool>(file);
+	}
+
+protected:
+
+	/// keeps the thread's buffer until the thread exits, then lets the Profiler drop it
+	struct ThreadHandle {
+		std::shared_ptr<ThreadBuffer> buffer;
+		~ThreadHandle() {
+			if (buffer) buffer->hasExited.store(true);
+		}
+	};
+
+	std::vector<std::shared_ptr<ThreadBuffer>> mThreads;
+	std::unordered_map<uint32_t, std::string> mThreadNames;
+	mutable std::mutex mThreadsMutex;
+	uint32_t mNumThreads;
+	uint64_t mNumDroppedByExited;
+	size_t mQueueSize;
+
+	std::unordered_map<const Zone*, Histogram> mZones;
+	mutable std::mutex mStatsMutex;
+
+	// oldest first, roughly, as each collect() appends a thread at a time
+	std::deque<TraceEvent> mTrace;
+	double mTraceLength, mNewestTraceEnd;
+	size_t mMaxTraceEvents;
+
+	std::thread mThread;
+	std::mutex mRunMutex;
+	std::condition_variable mRunCondition;
+	bool mIsRunning;
+
+	// the first tick and steady_clock time, to turn ticks into nanoseconds
+	uint64_t mStartTicks;
+	std::chrono::steady_clock::time_point mStartTime;
+	double mNsPerTick;
+
+	Profiler(): mNumThreads(0), mNumDroppedByExited(0), mQueueSize(1 << 16), mTraceLength(0), mNewestTraceEnd(0), mMaxTraceEvents(0),
+		mIsRunning(false), mNsPerTick(1) {
+		mStartTicks = now();
+		mStartTime = std::chrono::steady_clock::now();
+#ifdef WHG_PROFILE_TSC
+		// a first estimate, calibrate() gets better as time goes on
+		while (std::chrono::steady_clock::now() - mStartTime < std::chrono::milliseconds(2)) {}
+		calibrate();
+#endif
+	}
+
+	ThreadBuffer* addThread() {
+		static thread_local ThreadHandle handle;
+		std::lock_guard<std::mutex> lock(mThreadsMutex);
+		handle.buffer = std::make_shared<ThreadBuffer>(mQueueSize, mNumThreads++);
+		mThreads.push_back(handle.buffer);
+		return handle.buffer.get();
+	}
+
+	double calibrate() {
+#ifdef WHG_PROFILE_TSC
+		const uint64_t ticks = now();
+		const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - mStartTime).count();
+		if (ticks > mStartTicks) mNsPerTick = ns / (ticks - mStartTicks);
+#endif
+		return mNsPerTick;
+	}
+
+	/// with mStatsMutex held
+	void add(const Event &event, const ThreadBuffer &buffer, double nsPerTick) {
+		const double ns = (event.end - event.start) * nsPerTick;
+		if (mTraceLength > 0) {
+			const double start = static_cast<int64_t>(event.start - mStartTicks) * nsPerTick;
+			mTrace.push_back({ event.zone, start, ns, buffer.index, event.depth });
+			mNewestTraceEnd = std::max(mNewestTraceEnd, start + ns);
+		}
+		mZones[event.zone].record(static_cast<uint64_t>(ns + 0.5));
+	}
+
+	/// with mStatsMutex held
+	void pruneTrace() {
+		const double from = mNewestTraceEnd - mTraceLength;
+		while (!mTrace.empty() && (mTrace.size() > mMaxTraceEvents || mTrace.front().start + mTrace.front().duration < from)) {
+			mTrace.pop_front();
+		}
+	}
+
+	static void writeJsonString(std::ostream &os, const char *text) {
+		os << '"';
+		for (const char *c = text; *c; c++) {
+			if (*c == '"' || *c == '\\') os << '\\' << *c;
+			else if (static_cast<unsigned char>(*c) < 0x20) os << "\\u00" << "0123456789abcdef"[*c >> 4] << "0123456789abcdef"[*c & 15];
+			else os << *c;
+		}
+		os << '"';
+	}
+};
+
+/// times its scope as zone
+class ScopedZone {
+public:
+
+	ScopedZone(const Zone &zone): mZone(&zone), mBuffer(Profiler::getThreadBuffer()) {
+		mBuffer.depth++;
+		mStart = now();
+	}
+
+	~ScopedZone() {
+		const uint64_t end = now();
+		mBuffer.depth--;
+		mBuffer.push({ mZone, mStart, end, mBuffer.depth });
+	}
+
+	ScopedZone(const ScopedZone&) = delete;
+	ScopedZone& operator=(const ScopedZone&) = delete;
+
+protected:
+	const Zone *mZone;
+	ThreadBuffer &mBuffer;
+	uint64_t mStart;
+};
+
+} // namespace profile
+} // namespace whg
+
+#define WHG_PROFILE_CONCAT_(a, b) a##b
+#define WHG_PROFILE_CONCAT(a, b) WHG_PROFILE_CONCAT_(a, b)
+
+#ifdef NO_PROFILE
+#define WHG_PROFILE_ZONE(name)
+#else
+/// times the rest of the scope, name must be a string literal
+#define WHG_PROFILE_ZONE(name) \
+	static const whg::profile::Zone WHG_PROFILE_CONCAT(whgProfileZone, __LINE__) = { name, __FILE__, __LINE__ }; \
+	whg::profile::ScopedZone WHG_PROFILE_CONCAT(whgProfileScope, __LINE__)(WHG_PROFILE_CONCAT(whgProfileZone, __LINE__))
+#endif
+
+#define WHG_PROFILE_FUNCTION() WHG_PROFILE_ZONE(__func__)
@@ -0,0 +1,329 @@
+#pragma once
+
+#include "whelpersg/simd.h"
+
+#include <vector>
+#include <cmath>
+#include <memory>
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <algorithm>
+
+#ifndef PI
+#define PI 3.141592653589793238462
+#endif
+
+namespace dsp {
+
+/// Kaiser windowed sinc, tabulated as numPhases + 1 rows of numTaps coefficients.
+/// row p holds the filter for a read position p / numPhases of a sample past an input sample,
+/// the last row is there so arbitrary positions can interpolate between neighbouring rows.
+/// Tables are shared, see get().
+struct ResamplerTable {
+
+	size_t numTaps, numPhases;
+	double cutoff; // as a fraction of the input Nyquist
+	whg::AlignedVector<float> coefficients;
+
+	static std::shared_ptr<const ResamplerTable> get(size_t numTaps, size_t numPhases, double cutoff) {
+
+		static std::mutex mutex;
+		static std::map<std::tuple<size_t, size_t, double>, std::shared_ptr<const ResamplerTable>> registry;
+
+		auto key = std::make_tuple(numTaps, numPhases, cutoff);
+
+		std::lock_guard<std::mutex> lock(mutex);
+		auto it = registry.find(key);
+		if (it != registry.end()) {
+			return it->second;
+		}
+
+		std::shared_ptr<const ResamplerTable> table = std::make_shared<const ResamplerTable>(numTaps, numPhases, cutoff);
+		registry.emplace(key, table);
+		return table;
+	}
+
+	ResamplerTable(size_t numTaps, size_t numPhases, double cutoff):
+	numTaps(numTaps), numPhases(numPhases), cutoff(cutoff) {
+
+		// ~80dB stopband
+		const double beta = 8.0;
+		const double halfLength = numTaps / 2.0;
+		const double i0beta = besselI0(beta);
+
+		coefficients.resize((numPhases + 1) * numTaps);
+
+		for (size_t p = 0; p <= numPhases; p++) {
+
+			const double phase = static_cast<double>(p) / numPhases;
+			float *row = &coefficients[p * numTaps];
+			double sum = 0;
+
+			for (size_t k = 0; k < numTaps; k++) {
+				// tap k reads input sample floor(position) - numTaps / 2 + 1 + k
+				double t = static_cast<double>(k) - (halfLength - 1.0) - phase;
+				double x = cutoff * t;
+				double sinc = std::abs(x) < 1e-9 ? 1.0 : std::sin(PI * x) / (PI * x);
+				double r = t / halfLength;
+				double window = std::abs(r) >= 1.0 ? 0.0 : besselI0(beta * std::sqrt(1.0 - r * r)) / i0beta;
+				row[k] = static_cast<float>(cutoff * sinc * window);
+				sum+= row[k];
+			}
+
+			// unity gain at DC for every phase
+			for (size_t k = 0; k < numTaps; k++) {
+				row[k]/= sum;
+			}
+		}
+	}
+
+	const float* row(size_t phase) const { return &coefficients[phase * numTaps]; }
+
+	static double besselI0(double x) {
+		double sum = 1, term = 1, halfX = x / 2;
+		for (int k = 1; k < 50; k++) {
+			term*= halfX / k;
+			sum+= term * term;
+			if (term * term < sum * 1e-17) break;
+		}
+		return sum;
+	}
+};
+
+
+/// Windowed sinc polyphase resampling, either
+///  - fixed ratio: input and output rates reduce to L / M with L small enough to keep L phases
+///    (44.1k <-> 48k is 160 / 147), every output uses an exact table row
+///  - arbitrary ratio: the read step (input samples per output sample) can change at any time,
+///    outputs interpolate between two of 256 table rows. Steps above 1 (downsampling, fast
+///    varispeed) lower the cutoff and lengthen the filter so there's no aliasing.
+/// Inner products are float4 dot products, tables are shared between instances.
+class Resampler {
+
+	enum { NUM_PHASES = 256, MAX_RATIONAL_PHASES = 1024 };
+
+public:
+
+	/// arbitrary ratio, numTaps per output at a step of 1 (rounded up to a multiple of 4)
+	Resampler(size_t numTaps=32): mNumTaps((numTaps + 3) & ~static_cast<size_t>(3)), mRolloff(0.95),
+	mIsRational(false), mInterpolation(1), mDecimation(1), mPhase(0), mCutoffIndex(-1) {
+		setStep(1.0);
+		reset();
+	}
+
+	/// fixed conversion between two rates, falls back to arbitrary if the ratio isn't simple
+	Resampler(double inputRate, double outputRate, size_t numTaps=32): Resampler(numTaps) {
+		setRates(inputRate, outputRate);
+	}
+
+	void setRates(double inputRate, double outputRate) {
+
+		long in = std::lround(inputRate), out = std::lround(outputRate);
+		long divisor = gcd(in, out);
+
+		if (in == inputRate && out == outputRate && out / divisor <= MAX_RATIONAL_PHASES) {
+			mIsRational = true;
+			mInterpolation = out / divisor;
+			mDecimation = in / divisor;
+			mStep = static_cast<double>(mDecimation) / mInterpolation;
+
+			double cutoff = mRolloff * std::min(1.0, 1.0 / mStep);
+			mTaps = roundTaps(mNumTaps / std::min(1.0, 1.0 / mStep));
+			mTable = ResamplerTable::get(mTaps, mInterpolation, cutoff);
+			mCutoffIndex = -1; // so setStep() swaps the table back
+		}
+		else {
+			mIsRational = false;
+			mCutoffIndex = -1;
+			setStep(inputRate / outputRate);
+		}
+		reset();
+	}
+
+	/// input samples per output sample, eg. the playback speed for varispeed.
+	/// negative steps read backwards in read(), process() uses the magnitude
+	void setStep(double step) {
+
+		if (mIsRational) {
+			mPosition = mIndex + static_cast<double>(mPhase) / mInterpolation;
+			mIsRational = false;
+		}
+		mStep = step;
+
+		double speed = std::max(1.0, std::abs(step));
+
+		// tables in twelfth of an octave steps, rounding the cutoff down so we never alias
+		int index = static_cast<int>(std::ceil(std::log2(speed) * 12.0 - 1e-9));
+		if (index != mCutoffIndex) {
+			mCutoffIndex = index;
+			double scale = std::pow(2.0, index / 12.0);
+			mTaps = roundTaps(mNumTaps * std::min(scale, 4.0));
+			mTable = ResamplerTable::get(mTaps, NUM_PHASES, mRolloff / scale);
+		}
+	}
+
+	double getStep() const { return mStep; }
+
+	/// in input samples
+	size_t getLatency() const { return mTaps / 2; }
+
+	void reset() {
+		// history of zeros so the first output lines up with the first input
+		mBuffer.assign(mTaps / 2 - 1, 0.0f);
+		mPosition = mTaps / 2 - 1;
+		mIndex = mTaps / 2 - 1;
+		mPhase = 0;
+	}
+
+	/// streaming conversion: takes all numInput samples, writes at most maxOutput
+	/// and returns how many were written. Unread input is kept for the next call, so
+	/// maxOutput should be enough for numInput / step samples.
+	size_t process(const float *input, size_t numInput, float *output, size_t maxOutput) {
+
+		mBuffer.insert(mBuffer.end(), input, input + numInput);
+
+		const size_t half = mTaps / 2;
+		if (!mIsRational && mPosition < half - 1) {
+			// the filter got longer since the last call, make room for its history
+			size_t extra = static_cast<size_t>(std::ceil(half - 1 - mPosition));
+			mBuffer.insert(mBuffer.begin(), extra, 0.0f);
+			mPosition+= extra;
+		}
+		size_t numOutput = 0;
+
+		if (mIsRational) {
+			while (numOutput < maxOutput && mIndex + half < mBuffer.size()) {
+				output[numOutput++] = whg::simd::dot(mTable->row(mPhase), &mBuffer[mIndex + 1 - half], mTaps);
+				mPhase+= mDecimation;
+				mIndex+= mPhase / mInterpolation;
+				mPhase%= mInterpolation;
+			}
+			discard(mIndex + 1 - half);
+		}
+		else {
+			const double step = std::abs(mStep);
+			while (numOutput < maxOutput) {
+				size_t index = static_cast<size_t>(mPosition);
+				if (index + half >= mBuffer.size()) break;
+				output[numOutput++] = interpolate(&mBuffer[index + 1 - half], mPosition - index);
+				mPosition+= step;
+			}
+			size_t first = static_cast<size_t>(mPosition) + 1 - half;
+			discard(std::min(first, mBuffer.size()));
+		}
+
+		return numOutput;
+	}
+
+	/// random access reading from a whole buffer, eg. varispeed playback of a file in memory.
+	/// position (in samples) moves by step per output and wraps around the buffer if looping,
+	/// otherwise samples outside the buffer read as silence.
+	void read(const float *data, size_t size, double &position, double step, float *output, size_t N, bool loop=true) {
+
+		setStep(step);
+
+		const long half = static_cast<long>(mTaps / 2);
+		const long length = static_cast<long>(size);
+
+		for (size_t i = 0; i < N; i++) {
+
+			if (loop) {
+				position = std::fmod(position, static_cast<double>(size));
+				if (position < 0) position+= size;
+			}
+
+			double floorPosition = std::floor(position);
+			long index = static_cast<long>(floorPosition);
+			long first = index + 1 - half;
+
+			if (first >= 0 && first + static_cast<long>(mTaps) <= length) {
+				output[i] = interpolate(data + first, position - floorPosition);
+			}
+			else {
+				// straddling an edge, gather what we need
+				mEdge.resize(mTaps);
+				for (long k = 0; k < static_cast<long>(mTaps); k++) {
+					long j = first + k;
+					if (loop) {
+						j = ((j % length) + length) % length;
+						mEdge[k] = data[j];
+					}
+					else {
+						mEdge[k] = j >= 0 && j < length ? data[j] : 0.0f;
+					}
+				}
+				output[i] = interpolate(&mEdge[0], position - floorPosition);
+			}
+
+			position+= step;
+		}
+	}
+
+protected:
+	size_t mNumTaps, mTaps;
+	double mRolloff, mStep;
+
+	bool mIsRational;
+	size_t mInterpolation, mDecimation, mPhase, mIndex;
+
+	double mPosition;
+	int mCutoffIndex;
+
+	std::shared_ptr<const ResamplerTable> mTable;
+	std::vector<float> mBuffer, mEdge;
+
+	float interpolate(const float *x, double fraction) const {
+		double p = fraction * NUM_PHASES;
+		size_t phase = std::min(static_cast<size_t>(p), static_cast<size_t>(NUM_PHASES - 1));
+		float a = static_cast<float>(p - phase);
+		float lower = whg::simd::dot(mTable->row(phase), x, mTaps);
+		float upper = whg::simd::dot(mTable->row(phase + 1), x, mTaps);
+		return lower + a * (upper - lower);
+	}
+
+	void discard(size_t n) {
+		if (n == 0) return;
+		mBuffer.erase(mBuffer.begin(), mBuffer.begin() + n);
+		if (mIsRational) {
+			mIndex-= n;
+		}
+		else {
+			mPosition-= n;
+		}
+	}
+
+	static size_t roundTaps(double taps) {
+		return (static_cast<size_t>(std::ceil(taps)) + 3) & ~static_cast<size_t>(3);
+	}
+
+	static long gcd(long a, long b) {
+		while (b) {
+			long t = a % b;
+			a = b;
+			b = t;
+		}
+		return a;
+	}
+};
+
+
+/// one-off conversion of a whole signal, eg. before analysis that assumes a sample rate
+inline std::vector<float> resample(const std::vector<float> &input, double inputRate, double outputRate, size_t numTaps=32) {
+
+	Resampler resampler(inputRate, outputRate, numTaps);
+
+	const size_t latency = resampler.getLatency();
+	std::vector<float> padded(input);
+	padded.resize(input.size() + latency * 2, 0.0f);
+
+	const double ratio = outputRate / inputRate;
+	std::vector<float> output(static_cast<size_t>(std::ceil(padded.size() * ratio)) + 1);
+	output.resize(resampler.process(&padded[0], padded.size(), &output[0], output.size()));
+
+	// trim to the length of the input at the new rate
+	output.resize(std::min(output.size(), static_cast<size_t>(std::ceil(input.size() * ratio))));
+	return output;
+}
+
+} // namespace dsp
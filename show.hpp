@@ -0,0 +1,426 @@
+#pragma once
+
+#include "whelpersg/json/json.hpp"
+#include "whelpersg/easing.h"
+#include "whelpersg/timeline.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace whg {
+
+/// The binary show file, little endian:
+///  - Header
+///  - numTracks Tracks
+///  - numKeyframes Keyframes, each track's one after another, laid out like
+///    KeyframeTrack<float>::Keyframe so they can be used straight from the mapped file
+///  - namesSize bytes of track names, not 0 terminated
+/// Curves are stored as their EasingCurve number, so renumbering them needs a new version.
+namespace showfile {
+
+const uint32_t version = 1;
+
+struct Header {
+	char magic[4]; // "WHGS"
+	uint32_t version;
+	uint32_t numTracks;
+	uint32_t keyframeSize;
+	uint64_t numKeyframes;
+	uint64_t namesSize;
+};
+
+struct Track {
+	uint64_t firstKeyframe;
+	uint32_t numKeyframes;
+	uint32_t nameOffset;
+	uint32_t nameLength;
+	uint32_t reserved;
+};
+
+typedef KeyframeTrack<float>::Keyframe Keyframe;
+
+static_assert(sizeof(Header) == 32 && sizeof(Track) == 24, "show file structs aren't packed as expected");
+static_assert(sizeof(Keyframe) == 16 && offsetof(Keyframe, time) == 0 && offsetof(Keyframe, value) == 4 &&
+			  offsetof(Keyframe, curve) == 8 && offsetof(Keyframe, duration) == 12,
+			  "keyframes aren't laid out as in show files");
+
+/// KeyframeTrack binary searches times, so they have to be finite and never go backwards
+inline bool hasPlayableTimes(const Keyframe *keyframes, size_t N) {
+	for (size_t k = 0; k < N; k++) {
+		if (!std::isfinite(keyframes[k].time) || (k && keyframes[k].time < keyframes[k - 1].time)) return false;
+	}
+	return true;
+}
+
+} // namespace showfile
+
+
+/// Reads a binary show file in place: the file is memory mapped and the keyframes are used
+/// from it directly, so opening only checks the header, the track table and the curves.
+class ShowReader {
+public:
+
+	typedef showfile::Keyframe Keyframe;
+
+	ShowReader(): mMapped(nullptr), mMappedSize(0), mBytes(nullptr), mSize(0) {}
+
+	ShowReader(const std::string &path): ShowReader() {
+		open(path);
+	}
+
+	~ShowReader() {
+		close();
+	}
+
+	ShowReader(const ShowReader&) = delete;
+	ShowReader& operator=(const ShowReader&) = delete;
+
+	bool open(const std::string &path) {
+
+		close();
+
+#ifdef _WIN32
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+		mBuffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		const uint8_t *bytes = reinterpret_cast<const uint8_t*>(mBuffer.data());
+		size_t size = mBuffer.size();
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(sizeof(showfile::Header))) {
+			::close(fd);
+			return false;
+		}
+
+		mMappedSize = static_cast<size_t>(info.st_size);
+		mMapped = mmap(nullptr, mMappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (mMapped == MAP_FAILED) {
+			mMapped = nullptr;
+			mMappedSize = 0;
+			return false;
+		}
+
+		const uint8_t *bytes = static_cast<const uint8_t*>(mMapped);
+		size_t size = mMappedSize;
+#endif
+
+		if (!parse(bytes, size)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		mBuffer.clear();
+#else
+		if (mMapped) {
+			munmap(mMapped, mMappedSize);
+		}
+#endif
+		mMapped = nullptr;
+		mMappedSize = 0;
+		mBytes = nullptr;
+		mSize = 0;
+	}
+
+	bool isOpen() const { return mBytes != nullptr; }
+
+	size_t size() const { return isOpen() ? getHeader().numTracks : 0; }
+
+	std::string getName(size_t track) const {
+		const auto &entry = getTracks()[track];
+		return std::string(reinterpret_cast<const char*>(getNames() + entry.nameOffset), entry.nameLength);
+	}
+
+	const Keyframe* getKeyframes(size_t track) const {
+		return reinterpret_cast<const Keyframe*>(mBytes + keyframesOffset()) + getTracks()[track].firstKeyframe;
+	}
+
+	size_t getNumKeyframes(size_t track) const { return getTracks()[track].numKeyframes; }
+
+	/// a copy of the track to play
+	KeyframeTrack<float> getTrack(size_t track) const {
+		KeyframeTrack<float> output;
+		output.assign(getKeyframes(track), getNumKeyframes(track));
+		return output;
+	}
+
+protected:
+	void *mMapped;
+	size_t mMappedSize;
+	std::vector<char> mBuffer;
+	const uint8_t *mBytes;
+	size_t mSize;
+
+	const showfile::Header& getHeader() const { return *reinterpret_cast<const showfile::Header*>(mBytes); }
+
+	const showfile::Track* getTracks() const {
+		return reinterpret_cast<const showfile::Track*>(mBytes + sizeof(showfile::Header));
+	}
+
+	size_t keyframesOffset() const {
+		return sizeof(showfile::Header) + getHeader().numTracks * sizeof(showfile::Track);
+	}
+
+	const uint8_t* getNames() const {
+		return mBytes + keyframesOffset() + getHeader().numKeyframes * sizeof(Keyframe);
+	}
+
+	bool parse(const uint8_t *bytes, size_t size) {
+
+		if (size < sizeof(showfile::Header)) return false;
+		showfile::Header header;
+		std::memcpy(&header, bytes, sizeof(header));
+		if (std::memcmp(header.magic, "WHGS", 4) || header.version != showfile::version ||
+			header.keyframeSize != sizeof(Keyframe)) return false;
+
+		// sizes in 64 bits before comparing, a corrupt count can't wrap around
+		const uint64_t tracksSize = uint64_t(header.numTracks) * sizeof(showfile::Track);
+		if (header.numKeyframes > size || header.namesSize > size || tracksSize > size ||
+			sizeof(header) + tracksSize + header.numKeyframes * sizeof(Keyframe) + header.namesSize != size) return false;
+
+		mBytes = bytes;
+		mSize = size;
+
+		const showfile::Track *tracks = getTracks();
+		const Keyframe *keyframes = reinterpret_cast<const Keyframe*>(mBytes + keyframesOffset());
+		for (size_t k = 0; k < header.numKeyframes; k++) {
+			if (static_cast<size_t>(keyframes[k].curve) >= numEasingCurves) {
+				mBytes = nullptr;
+				return false;
+			}
+		}
+
+		// firstKeyframe is checked on its own first so adding numKeyframes can't wrap around
+		for (size_t t = 0; t < header.numTracks; t++) {
+			if (tracks[t].firstKeyframe > header.numKeyframes ||
+				tracks[t].numKeyframes > header.numKeyframes - tracks[t].firstKeyframe ||
+				uint64_t(tracks[t].nameOffset) + tracks[t].nameLength > header.namesSize ||
+				!showfile::hasPlayableTimes(keyframes + tracks[t].firstKeyframe, tracks[t].numKeyframes)) {
+				mBytes = nullptr;
+				return false;
+			}
+		}
+		return true;
+	}
+};
+
+
+/// Named keyframe tracks, eg. one per light channel, as saved in a show file.
+/// save() and load() use the binary show file, loading is a copy of each track's keyframes
+/// out of the mapped file. The JSON is for editing and exchange:
+///   { "version": 1, "tracks": [ { "name": "dimmer 1", "keyframes": [
+///     { "time": 0, "value": 0 }, { "time": 1.5, "value": 1, "curve": "QuadInEaser" }, ... ] } ] }
+/// where curve defaults to "LinearEaser" and a keyframe's duration to the time since the last
+/// one (it's only written where they differ). Both keep the keyframes exactly.
+class Show {
+public:
+
+	/// returns the track's index
+	size_t add(const std::string &name, KeyframeTrack<float> track) {
+		mNames.push_back(name);
+		mTracks.push_back(std::move(track));
+		return mTracks.size() - 1;
+	}
+
+	size_t size() const { return mTracks.size(); }
+	bool empty() const { return mTracks.empty(); }
+
+	void clear() {
+		mNames.clear();
+		mTracks.clear();
+	}
+
+	const std::string& getName(size_t track) const { return mNames[track]; }
+	KeyframeTrack<float>& getTrack(size_t track) { return mTracks[track]; }
+	const KeyframeTrack<float>& getTrack(size_t track) const { return mTracks[track]; }
+
+	/// the index of the track called name, size() if there isn't one
+	size_t find(const std::string &name) const {
+		return std::find(mNames.begin(), mNames.end(), name) - mNames.begin();
+	}
+
+	/// every track onto timeline, their ids in track order
+	std::vector<Timeline<float>::Id> addTo(Timeline<float> &timeline) const {
+		std::vector<Timeline<float>::Id> ids;
+		ids.reserve(mTracks.size());
+		for (const auto &track : mTracks) ids.push_back(timeline.add(track));
+		return ids;
+	}
+
+	bool save(const std::string &path) const {
+
+		showfile::Header header;
+		std::memcpy(header.magic, "WHGS", 4);
+		header.version = showfile::version;
+		header.numTracks = static_cast<uint32_t>(mTracks.size());
+		header.keyframeSize = sizeof(showfile::Keyframe);
+		header.numKeyframes = 0;
+		header.namesSize = 0;
+
+		std::vector<showfile::Track> tracks(mTracks.size());
+		for (size_t t = 0; t < mTracks.size(); t++) {
+			tracks[t] = { header.numKeyframes, static_cast<uint32_t>(mTracks[t].getKeyframes().size()),
+				static_cast<uint32_t>(header.namesSize), static_cast<uint32_t>(mNames[t].size()), 0 };
+			header.numKeyframes+= tracks[t].numKeyframes;
+			header.namesSize+= mNames[t].size();
+		}
+
+		// field by field so the padding is written as 0
+		std::vector<showfile::Keyframe> keyframes;
+		keyframes.reserve(header.numKeyframes);
+		for (const auto &track : mTracks) {
+			for (const auto &k : track.getKeyframes()) {
+				keyframes.emplace_back();
+				std::memset(&keyframes.back(), 0, sizeof(showfile::Keyframe));
+				keyframes.back().time = k.time;
+				keyframes.back().value = k.value;
+				keyframes.back().curve = k.curve;
+				keyframes.back().duration = k.duration;
+			}
+		}
+
+		std::ofstream file(path, std::ios::binary);
+		if (!file) return false;
+		file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+		file.write(reinterpret_cast<const char*>(tracks.data()), tracks.size() * sizeof(showfile::Track));
+		file.write(reinterpret_cast<const char*>(keyframes.data()), keyframes.size() * sizeof(showfile::Keyframe));
+		for (const auto &name : mNames) file.write(name.data(), name.size());
+		return static_cast<bool>(file);
+	}
+
+	/// replaces the tracks, false (and empty) if the file isn't a show file
+	bool load(const std::string &path) {
+		clear();
+		ShowReader reader(path);
+		if (!reader.isOpen()) return false;
+
+		mNames.reserve(reader.size());
+		mTracks.resize(reader.size());
+		for (size_t t = 0; t < reader.size(); t++) {
+			mNames.push_back(reader.getName(t));
+			mTracks[t].assign(reader.getKeyframes(t), reader.getNumKeyframes(t));
+		}
+		return true;
+	}
+
+	nlohmann::json toJson() const {
+
+		nlohmann::json tracks = nlohmann::json::array();
+		for (size_t t = 0; t < mTracks.size(); t++) {
+			const auto &keyframes = mTracks[t].getKeyframes();
+			nlohmann::json output = nlohmann::json::array();
+
+			for (size_t k = 0; k < keyframes.size(); k++) {
+				nlohmann::json keyframe = { { "time", keyframes[k].time }, { "value", keyframes[k].value } };
+				if (k > 0) {
+					keyframe["curve"] = getEasingCurveName(keyframes[k].curve);
+					if (keyframes[k].duration != keyframes[k].time - keyframes[k - 1].time) {
+						keyframe["duration"] = keyframes[k].duration;
+					}
+				}
+				output.push_back(std::move(keyframe));
+			}
+			tracks.push_back({ { "name", mNames[t] }, { "keyframes", std::move(output) } });
+		}
+		return { { "version", showfile::version }, { "tracks", std::move(tracks) } };
+	}
+
+	/// replaces the tracks, false (and empty) if json isn't a show
+	bool fromJson(const nlohmann::json &json) {
+
+		clear();
+		try {
+			if (getOr(json, "version", showfile::version) != showfile::version) return false;
+
+			std::vector<showfile::Keyframe> keyframes;
+			for (const auto &track : json.at("tracks")) {
+				keyframes.clear();
+				for (const auto &keyframe : track.at("keyframes")) {
+					showfile::Keyframe k;
+					k.time = keyframe.at("time").get<float>();
+					k.value = keyframe.at("value").get<float>();
+					k.curve = EasingCurve::HOLD;
+					k.duration = 0;
+
+					if (!keyframes.empty()) {
+						if (!easingCurveFromName(getOr(keyframe, "curve", std::string("LinearEaser")), k.curve)) {
+							clear();
+							return false;
+						}
+						k.duration = getOr(keyframe, "duration", k.time - keyframes.back().time);
+					}
+					keyframes.push_back(k);
+				}
+
+				if (!showfile::hasPlayableTimes(keyframes.data(), keyframes.size())) {
+					clear();
+					return false;
+				}
+				KeyframeTrack<float> output;
+				output.assign(keyframes.data(), keyframes.size());
+				add(getOr(track, "name", std::string()), std::move(output));
+			}
+		}
+		catch (const std::exception&) {
+			clear();
+			return false;
+		}
+		return true;
+	}
+
+	/// indent as nlohmann::json::dump() takes it, -1 for all on one line
+	bool saveJson(const std::string &path, int indent=-1) const {
+		std::ofstream file(path);
+		if (!file) return false;
+		file << toJson().dump(indent);
+		return static_cast<bool>(file);
+	}
+
+	bool loadJson(const std::string &path) {
+		clear();
+		std::ifstream file(path);
+		if (!file) return false;
+		try {
+			return fromJson(nlohmann::json::parse(file));
+		}
+		catch (const std::exception&) {
+			return false;
+		}
+	}
+
+protected:
+	std::vector<std::string> mNames;
+	std::vector<KeyframeTrack<float>> mTracks;
+
+	/// json[key], or fallback if there's no key
+	template <typename V>
+	static V getOr(const nlohmann::json &json, const std::string &key, V fallback) {
+		auto it = json.find(key);
+		return it == json.end() ? fallback : it->get<V>();
+	}
+};
+
+} // namespace whg
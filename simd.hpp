@@ -0,0 +1,559 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <vector>
+#include <limits>
+#include <cmath>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define WHG_SIMD_SSE 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define WHG_SIMD_NEON 1
+#include <arm_neon.h>
+#endif
+
+namespace whg {
+
+/// allocator for SIMD friendly buffers, alignment must be a power of two
+template <typename T, size_t Alignment=32>
+class AlignedAllocator {
+public:
+	typedef T value_type;
+	typedef T* pointer;
+	typedef const T* const_pointer;
+	typedef std::size_t size_type;
+	typedef std::ptrdiff_t difference_type;
+
+	template <typename U>
+	struct rebind { typedef AlignedAllocator<U, Alignment> other; };
+
+	AlignedAllocator() {}
+
+	template <typename U>
+	AlignedAllocator(const AlignedAllocator<U, Alignment>&) {}
+
+	pointer allocate(size_type N) {
+		// over allocate and keep the original pointer just before the aligned block
+		void *raw = std::malloc(N * sizeof(T) + Alignment + sizeof(void*));
+		if (!raw) throw std::bad_alloc();
+		size_t address = reinterpret_cast<size_t>(raw) + sizeof(void*);
+		address = (address + Alignment - 1) & ~(Alignment - 1);
+		reinterpret_cast<void**>(address)[-1] = raw;
+		return reinterpret_cast<pointer>(address);
+	}
+
+	void deallocate(pointer p, size_type) {
+		if (p) std::free(reinterpret_cast<void**>(p)[-1]);
+	}
+
+	size_type max_size() const {
+		return std::numeric_limits<size_type>::max() / sizeof(T);
+	}
+
+	template <typename U>
+	bool operator==(const AlignedAllocator<U, Alignment>&) const { return true; }
+	template <typename U>
+	bool operator!=(const AlignedAllocator<U, Alignment>&) const { return false; }
+};
+
+template <typename T>
+using AlignedVector = std::vector<T, AlignedAllocator<T>>;
+
+
+namespace simd {
+
+/// four packed floats, SSE or NEON when we have them and plain arrays otherwise
+struct float4 {
+
+#if defined(WHG_SIMD_SSE)
+	__m128 v;
+	float4() {}
+	float4(__m128 v): v(v) {}
+	float4(float x): v(_mm_set1_ps(x)) {}
+
+	static float4 load(const float *p) { return _mm_loadu_ps(p); }
+	void store(float *p) const { _mm_storeu_ps(p, v); }
+
+	friend float4 operator+(float4 a, float4 b) { return _mm_add_ps(a.v, b.v); }
+	friend float4 operator-(float4 a, float4 b) { return _mm_sub_ps(a.v, b.v); }
+	friend float4 operator*(float4 a, float4 b) { return _mm_mul_ps(a.v, b.v); }
+	friend float4 operator/(float4 a, float4 b) { return _mm_div_ps(a.v, b.v); }
+	friend float4 min(float4 a, float4 b) { return _mm_min_ps(a.v, b.v); }
+	friend float4 max(float4 a, float4 b) { return _mm_max_ps(a.v, b.v); }
+
+	float sum() const {
+		__m128 shuffled = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+		__m128 sums = _mm_add_ps(v, shuffled);
+		shuffled = _mm_movehl_ps(shuffled, sums);
+		return _mm_cvtss_f32(_mm_add_ss(sums, shuffled));
+	}
+
+#elif defined(WHG_SIMD_NEON)
+	float32x4_t v;
+	float4() {}
+	float4(float32x4_t v): v(v) {}
+	float4(float x): v(vdupq_n_f32(x)) {}
+
+	static float4 load(const float *p) { return vld1q_f32(p); }
+	void store(float *p) const { vst1q_f32(p, v); }
+
+	friend float4 operator+(float4 a, float4 b) { return vaddq_f32(a.v, b.v); }
+	friend float4 operator-(float4 a, float4 b) { return vsubq_f32(a.v, b.v); }
+	friend float4 operator*(float4 a, float4 b) { return vmulq_f32(a.v, b.v); }
+	friend float4 operator/(float4 a, float4 b) {
+		// no divide on armv7, refine the reciprocal estimate twice
+		float32x4_t r = vrecpeq_f32(b.v);
+		r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+		r = vmulq_f32(vrecpsq_f32(b.v, r), r);
+		return vmulq_f32(a.v, r);
+	}
+	friend float4 min(float4 a, float4 b) { return vminq_f32(a.v, b.v); }
+	friend float4 max(float4 a, float4 b) { return vmaxq_f32(a.v, b.v); }
+
+	float sum() const {
+		float32x2_t s = vadd_f32(vget_low_f32(v), vget_high_f32(v));
+		return vget_lane_f32(vpadd_f32(s, s), 0);
+	}
+
+#else
+	float v[4];
+	float4() {}
+	float4(float x) { v[0] = v[1] = v[2] = v[3] = x; }
+
+	static float4 load(const float *p) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = p[i]; return r; }
+	void store(float *p) const { for (int i = 0; i < 4; i++) p[i] = v[i]; }
+
+#define WHG_FLOAT4_OP(name, expr) \
+	friend float4 name(float4 a, float4 b) { float4 r; for (int i = 0; i < 4; i++) r.v[i] = expr; return r; }
+	WHG_FLOAT4_OP(operator+, a.v[i] + b.v[i])
+	WHG_FLOAT4_OP(operator-, a.v[i] - b.v[i])
+	WHG_FLOAT4_OP(operator*, a.v[i] * b.v[i])
+	WHG_FLOAT4_OP(operator/, a.v[i] / b.v[i])
+	WHG_FLOAT4_OP(min, a.v[i] < b.v[i] ? a.v[i] : b.v[i])
+	WHG_FLOAT4_OP(max, a.v[i] > b.v[i] ? a.v[i] : b.v[i])
+#undef WHG_FLOAT4_OP
+
+	float sum() const { return v[0] + v[1] + v[2] + v[3]; }
+#endif
+
+	float4& operator+=(float4 b) { return *this = *this + b; }
+	float4& operator-=(float4 b) { return *this = *this - b; }
+	float4& operator*=(float4 b) { return *this = *this * b; }
+};
+
+
+#if defined(WHG_SIMD_SSE)
+/// splits positive, normal floats into exponent and a mantissa in [1, 2)
+inline float4 exponentMantissa(float4 x, float4 &exponent) {
+	__m128i i = _mm_castps_si128(x.v);
+	exponent = _mm_cvtepi32_ps(_mm_sub_epi32(_mm_srli_epi32(i, 23), _mm_set1_epi32(127)));
+	return _mm_castsi128_ps(_mm_or_si128(_mm_and_si128(i, _mm_set1_epi32(0x007fffff)), _mm_set1_epi32(0x3f800000)));
+}
+#elif defined(WHG_SIMD_NEON)
+inline float4 exponentMantissa(float4 x, float4 &exponent) {
+	int32x4_t i = vreinterpretq_s32_f32(x.v);
+	exponent = vcvtq_f32_s32(vsubq_s32(vshrq_n_s32(i, 23), vdupq_n_s32(127)));
+	return vreinterpretq_f32_s32(vorrq_s32(vandq_s32(i, vdupq_n_s32(0x007fffff)), vdupq_n_s32(0x3f800000)));
+}
+#else
+inline float4 exponentMantissa(float4 x, float4 &exponent) {
+	float4 m;
+	for (int j = 0; j < 4; j++) {
+		int e;
+		m.v[j] = 2.0f * std::frexp(x.v[j], &e);
+		exponent.v[j] = static_cast<float>(e - 1);
+	}
+	return m;
+}
+#endif
+
+/// natural log for positive, normal floats (no checks for 0, inf or nan)
+/// log(m) = 2 atanh((m - 1) / (m + 1)) as a series, max abs error ~1e-7 over the mantissa
+inline float4 log(float4 x) {
+	float4 e;
+	float4 m = exponentMantissa(x, e);
+	float4 y = (m - float4(1.0f)) / (m + float4(1.0f));
+	float4 y2 = y * y;
+	float4 p = float4(1.0f / 11.0f);
+	p = p * y2 + float4(1.0f / 9.0f);
+	p = p * y2 + float4(1.0f / 7.0f);
+	p = p * y2 + float4(1.0f / 5.0f);
+	p = p * y2 + float4(1.0f / 3.0f);
+	p = p * y2 + float4(1.0f);
+	return e * float4(0.69314718056f) + float4(2.0f) * y * p;
+}
+
+/// output[i] = log(input[i] + offset), output may alias input
+inline void log(const float *input, float *output, size_t N, float offset=0) {
+	size_t i = 0;
+	const float4 o(offset);
+	for (; i + 4 <= N; i+= 4) {
+		log(float4::load(input + i) + o).store(output + i);
+	}
+	if (i < N) {
+		float tail[4] = { 1, 1, 1, 1 };
+		for (size_t j = i; j < N; j++) tail[j - i] = input[j] + offset;
+		log(float4::load(tail)).store(tail);
+		for (size_t j = i; j < N; j++) output[j] = tail[j - i];
+	}
+}
+
+#if defined(WHG_SIMD_SSE)
+/// 2^n for whole numbers n in [-126, 127], straight into the exponent bits
+inline float4 exponent2(float4 n) {
+	__m128i e = _mm_add_epi32(_mm_cvtps_epi32(n.v), _mm_set1_epi32(127));
+	return _mm_castsi128_ps(_mm_slli_epi32(e, 23));
+}
+#elif defined(WHG_SIMD_NEON)
+inline float4 exponent2(float4 n) {
+	int32x4_t e = vaddq_s32(vcvtq_s32_f32(n.v), vdupq_n_s32(127));
+	return vreinterpretq_f32_s32(vshlq_n_s32(e, 23));
+}
+#else
+inline float4 exponent2(float4 n) {
+	float4 r;
+	for (int j = 0; j < 4; j++) r.v[j] = std::ldexp(1.0f, static_cast<int>(n.v[j]));
+	return r;
+}
+#endif
+
+/// how many terms exp2() and log2() use. Worst errors over their whole input range, relative
+/// for exp2(), absolute below 1 and relative above for log2():
+///  - LOW: 1e-4 and 9e-5
+///  - MEDIUM: 3.6e-6 and 2e-6
+///  - HIGH: 1.1e-7 and 2.5e-7, about float rounding
+enum class Precision { LOW, MEDIUM, HIGH };
+
+/// (2^f - 1) / f for f in [-0.5, 0.5], so 2^f = 1 + f * exp2Ratio(f) without losing the small
+/// part to the 1. Fitted on chebyshev nodes, degree 2 for LOW (4.8e-4 relative), the
+/// MEDIUM and HIGH ones are exp2()'s polynomials less their constant 1
+template <Precision P=Precision::HIGH>
+inline float4 exp2Ratio(float4 f) {
+	float4 p;
+	if (P == Precision::LOW) {
+		p = float4(0.0557546498f);
+		p = p * f + float4(0.24203533f);
+		p = p * f + float4(0.693147181f);
+	}
+	else if (P == Precision::MEDIUM) {
+		p = float4(0.00966636852f);
+		p = p * f + float4(0.0559219758f);
+		p = p * f + float4(0.24022349f);
+		p = p * f + float4(0.693121045f);
+	}
+	else {
+		p = float4(0.000154614447f);
+		p = p * f + float4(0.00134004282f);
+		p = p * f + float4(0.00961805668f);
+		p = p * f + float4(0.0555032723f);
+		p = p * f + float4(0.240226509f);
+		p = p * f + float4(0.693147207f);
+	}
+	return p;
+}
+
+/// 2^x with x clamped to [-126, 127] so the result is always a normal float.
+/// 2^x = 2^round(x) * 2^f with f in [-0.5, 0.5], the latter a polynomial fitted on
+/// chebyshev nodes (so close to minimax) of degree 3, 4 or 6
+template <Precision P=Precision::HIGH>
+inline float4 exp2(float4 x) {
+	// adding and taking away 1.5 * 2^23 rounds to the nearest whole number
+	const float4 round(12582912.0f);
+	x = min(max(x, float4(-126.0f)), float4(127.0f));
+	float4 n = (x + round) - round;
+	float4 f = x - n;
+
+	float4 p;
+	if (P == Precision::LOW) {
+		p = float4(0.0558382829f);
+		p = p * f + float4(0.242639479f);
+		p = p * f + float4(0.693136734f);
+		p = p * f + float4(0.999924557f);
+	}
+	else {
+		p = exp2Ratio<P>(f) * f + float4(1.0f);
+	}
+	return p * exponent2(n);
+}
+
+/// 2^x - 1 as f * exp2Ratio(f) * 2^n + (2^n - 1), which keeps its relative error near x = 0
+/// where exp2(x) - 1 cancels
+template <Precision P=Precision::HIGH>
+inline float4 exp2m1(float4 x) {
+	const float4 round(12582912.0f), one(1.0f);
+	x = min(max(x, float4(-126.0f)), float4(127.0f));
+	float4 n = (x + round) - round;
+	float4 f = x - n;
+	float4 scale = exponent2(n);
+	return f * exp2Ratio<P>(f) * scale + (scale - one);
+}
+
+/// log2 for positive, normal floats below 2^127 (no checks for 0, inf or nan).
+/// Splitting x * sqrt(2) instead of x puts the mantissa m in [1 / sqrt(2), sqrt(2)), then
+/// log2(m) = 2 / ln(2) atanh((m - 1) / (m + 1)) as a series to y^3, y^5 or y^7 with |y| < 0.172
+template <Precision P=Precision::HIGH>
+inline float4 log2(float4 x) {
+	float4 e;
+	float4 m = exponentMantissa(x * float4(1.41421356f), e) * float4(0.707106781f);
+	float4 y = (m - float4(1.0f)) / (m + float4(1.0f));
+	float4 y2 = y * y;
+
+	float4 p;
+	if (P == Precision::LOW) {
+		p = float4(2.0f / 3.0f);
+	}
+	else if (P == Precision::MEDIUM) {
+		p = float4(2.0f / 5.0f);
+		p = p * y2 + float4(2.0f / 3.0f);
+	}
+	else {
+		p = float4(2.0f / 7.0f);
+		p = p * y2 + float4(2.0f / 5.0f);
+		p = p * y2 + float4(2.0f / 3.0f);
+	}
+	p = p * y2 + float4(2.0f);
+	return e + float4(1.44269504f) * y * p;
+}
+
+#if defined(WHG_SIMD_SSE)
+inline float4 sqrt(float4 x) {
+	return _mm_sqrt_ps(x.v);
+}
+#elif defined(WHG_SIMD_NEON) && defined(__aarch64__)
+inline float4 sqrt(float4 x) {
+	return vsqrtq_f32(x.v);
+}
+#elif defined(WHG_SIMD_NEON)
+/// x / sqrt(x) with the reciprocal square root estimate refined twice, x not below 1e-30
+/// for the estimate so 0 gives 0 rather than 0 * inf
+inline float4 sqrt(float4 x) {
+	float32x4_t clamped = vmaxq_f32(x.v, vdupq_n_f32(1e-30f));
+	float32x4_t r = vrsqrteq_f32(clamped);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(clamped, r), r), r);
+	r = vmulq_f32(vrsqrtsq_f32(vmulq_f32(clamped, r), r), r);
+	return vmulq_f32(x.v, r);
+}
+#else
+inline float4 sqrt(float4 x) {
+	float4 r;
+	for (int j = 0; j < 4; j++) r.v[j] = std::sqrt(x.v[j]);
+	return r;
+}
+#endif
+
+/// sin(r) for r in [-pi / 2, pi / 2] times sign, the series to r^11
+inline float4 sinReduced(float4 r, float4 sign) {
+	float4 r2 = r * r;
+	float4 p = float4(-2.50521084e-8f);
+	p = p * r2 + float4(2.75573192e-6f);
+	p = p * r2 + float4(-1.98412698e-4f);
+	p = p * r2 + float4(8.33333333e-3f);
+	p = p * r2 + float4(-1.66666667e-1f);
+	p = p * r2 + float4(1.0f);
+	return sign * r * p;
+}
+
+/// 0 for even whole numbers k and 1 for odd ones, k - 2 round(k / 2 - 1 / 4)
+inline float4 oddness(float4 k) {
+	const float4 round(12582912.0f);
+	return k - float4(2.0f) * ((k * float4(0.5f) - float4(0.25f) + round) - round);
+}
+
+/// sin for |x| up to about 10^4, within 2.5e-7 of std::sin.
+/// x = k pi + r with r in [-pi / 2, pi / 2] (pi in two parts so k pi is exact), then
+/// sin(x) = (-1)^k sin(r)
+inline float4 sin(float4 x) {
+	const float4 round(12582912.0f);
+	float4 k = (x * float4(0.318309886f) + round) - round;
+	float4 r = (x - k * float4(3.140625f)) - k * float4(9.67653589793e-4f);
+	return sinReduced(r, float4(1.0f) - float4(2.0f) * oddness(k));
+}
+
+/// cos, as accurate as sin(). x = (k + 1 / 2) pi + r, cos(x) = -(-1)^k sin(r)
+inline float4 cos(float4 x) {
+	const float4 round(12582912.0f);
+	float4 k = (x * float4(0.318309886f) - float4(0.5f) + round) - round;
+	float4 half = k + float4(0.5f);
+	float4 r = (x - half * float4(3.140625f)) - half * float4(9.67653589793e-4f);
+	return sinReduced(r, float4(2.0f) * oddness(k) - float4(1.0f));
+}
+
+/// output[i] = f(input[i]) for f taking and returning a float4, output may alias input.
+/// The last partial group of four is padded with input values so f never sees garbage
+template <class F>
+inline void transform(const float *input, float *output, size_t N, F f) {
+	size_t i = 0;
+	for (; i + 4 <= N; i+= 4) {
+		f(float4::load(input + i)).store(output + i);
+	}
+	if (i < N) {
+		float tail[4] = { input[i], input[i], input[i], input[i] };
+		for (size_t j = i; j < N; j++) tail[j - i] = input[j];
+		f(float4::load(tail)).store(tail);
+		for (size_t j = i; j < N; j++) output[j] = tail[j - i];
+	}
+}
+
+/// calls Loop<precision>()(args...), so a runtime choice of precision picks a loop compiled
+/// for it, where Loop is a functor template like Exp2Loop below
+template <template <Precision> class Loop, class... Args>
+inline void withPrecision(Precision precision, Args&&... args) {
+	switch (precision) {
+		case Precision::LOW: Loop<Precision::LOW>()(std::forward<Args>(args)...); break;
+		case Precision::MEDIUM: Loop<Precision::MEDIUM>()(std::forward<Args>(args)...); break;
+		default: Loop<Precision::HIGH>()(std::forward<Args>(args)...); break;
+	}
+}
+
+template <Precision P>
+struct Exp2Loop {
+	void operator()(const float *input, float *output, size_t N) const {
+		transform(input, output, N, [](float4 x) { return exp2<P>(x); });
+	}
+};
+
+template <Precision P>
+struct Log2Loop {
+	void operator()(const float *input, float *output, size_t N) const {
+		transform(input, output, N, [](float4 x) { return log2<P>(x); });
+	}
+};
+
+/// output[i] = 2^input[i], output may alias input
+inline void exp2(const float *input, float *output, size_t N, Precision precision=Precision::HIGH) {
+	withPrecision<Exp2Loop>(precision, input, output, N);
+}
+
+/// output[i] = log2(input[i]), output may alias input
+inline void log2(const float *input, float *output, size_t N, Precision precision=Precision::HIGH) {
+	withPrecision<Log2Loop>(precision, input, output, N);
+}
+
+inline float dot(const float *a, const float *b, size_t N) {
+	size_t i = 0;
+	float4 sum(0.0f);
+	for (; i + 4 <= N; i+= 4) {
+		sum+= float4::load(a + i) * float4::load(b + i);
+	}
+	float output = sum.sum();
+	for (; i < N; i++) {
+		output+= a[i] * b[i];
+	}
+	return output;
+}
+
+/// output[i] = a[i] * b[i], output may alias either input
+inline void multiply(const float *a, const float *b, float *output, size_t N) {
+	size_t i = 0;
+	for (; i + 4 <= N; i+= 4) {
+		(float4::load(a + i) * float4::load(b + i)).store(output + i);
+	}
+	for (; i < N; i++) {
+		output[i] = a[i] * b[i];
+	}
+}
+
+/// little endian 16 bit PCM at any alignment to float, output[i] = input[i] * scale
+inline void pcm16ToFloat(const void *input, float *output, size_t N, float scale=1.0f / 32768.0f) {
+	const uint8_t *bytes = static_cast<const uint8_t*>(input);
+	size_t i = 0;
+#if defined(WHG_SIMD_SSE)
+	const __m128 s = _mm_set1_ps(scale);
+	for (; i + 8 <= N; i+= 8) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 2 * i));
+		// sign extend by putting each sample in the top half and shifting down
+		__m128i lo = _mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16);
+		__m128i hi = _mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16);
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(lo), s));
+		_mm_storeu_ps(output + i + 4, _mm_mul_ps(_mm_cvtepi32_ps(hi), s));
+	}
+#elif defined(WHG_SIMD_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for (; i + 8 <= N; i+= 8) {
+		int16x8_t v = vreinterpretq_s16_u8(vld1q_u8(bytes + 2 * i));
+		vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(v))), s));
+		vst1q_f32(output + i + 4, vmulq_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(v))), s));
+	}
+#endif
+	for (; i < N; i++) {
+		int16_t v;
+		std::memcpy(&v, bytes + 2 * i, 2);
+		output[i] = v * scale;
+	}
+}
+
+/// little endian 32 bit PCM at any alignment to float, output[i] = input[i] * scale
+inline void pcm32ToFloat(const void *input, float *output, size_t N, float scale=1.0f / 2147483648.0f) {
+	const uint8_t *bytes = static_cast<const uint8_t*>(input);
+	size_t i = 0;
+#if defined(WHG_SIMD_SSE)
+	const __m128 s = _mm_set1_ps(scale);
+	for (; i + 4 <= N; i+= 4) {
+		__m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(bytes + 4 * i));
+		_mm_storeu_ps(output + i, _mm_mul_ps(_mm_cvtepi32_ps(v), s));
+	}
+#elif defined(WHG_SIMD_NEON)
+	const float32x4_t s = vdupq_n_f32(scale);
+	for (; i + 4 <= N; i+= 4) {
+		int32x4_t v = vreinterpretq_s32_u8(vld1q_u8(bytes + 4 * i));
+		vst1q_f32(output + i, vmulq_f32(vcvtq_f32_s32(v), s));
+	}
+#endif
+	for (; i < N; i++) {
+		int32_t v;
+		std::memcpy(&v, bytes + 4 * i, 4);
+		output[i] = v * scale;
+	}
+}
+
+/// flushes denormals to zero while alive, recursive filters crawl without it
+class ScopedNoDenormals {
+public:
+#if defined(WHG_SIMD_SSE)
+	ScopedNoDenormals(): mPrevious(_mm_getcsr()) {
+		_mm_setcsr(mPrevious | 0x8040); // flush to zero and denormals are zero
+	}
+	~ScopedNoDenormals() { _mm_setcsr(mPrevious); }
+protected:
+	unsigned int mPrevious;
+#elif defined(WHG_SIMD_NEON) && defined(__aarch64__)
+	ScopedNoDenormals() {
+		asm volatile("mrs %0, fpcr" : "=r"(mPrevious));
+		uint64_t fpcr = mPrevious | (1 << 24);
+		asm volatile("msr fpcr, %0" : : "r"(fpcr));
+	}
+	~ScopedNoDenormals() { asm volatile("msr fpcr, %0" : : "r"(mPrevious)); }
+protected:
+	uint64_t mPrevious;
+#else
+	ScopedNoDenormals() {}
+#endif
+};
+
+/// scalar fallbacks for the types we don't vectorise
+template <typename T>
+inline T dot(const T *a, const T *b, size_t N) {
+	T output = 0;
+	for (size_t i = 0; i < N; i++) {
+		output+= a[i] * b[i];
+	}
+	return output;
+}
+
+template <typename T>
+inline void multiply(const T *a, const T *b, T *output, size_t N) {
+	for (size_t i = 0; i < N; i++) {
+		output[i] = a[i] * b[i];
+	}
+}
+
+} // namespace simd
+
+} // namespace whg
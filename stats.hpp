@@ -1,2 +1,245 @@
 #pragma once
 
+#include <atomic>
+#include <array>
+#include <cstdint>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+/// Latency histograms for hot paths (audio callback durations, serial to OSC latency, DMX
+/// jitter). Values are unsigned integers in whatever unit suits, ns or us, bucketed HDR style:
+/// exact below 64, then 32 buckets per power of two, so percentiles are within about 3%
+/// (reported as the bucket's middle, within 1.6%) right up to 2^64, in a fixed 15kB.
+///   whg::ConcurrentHistogram callbackNs;
+///   callbackNs.record(ns); // from any thread, lock-free
+///   auto summary = callbackNs.getSnapshot().getSummary(); // p50, p99, p99.9, max...
+namespace whg {
+
+/// where values go, shared by the histograms below so they merge
+struct LogBuckets {
+	static const size_t subBits = 5;
+	static const size_t numLinear = 2 << subBits;
+	static const size_t numBuckets = numLinear + (64 - subBits - 1) * (1 << subBits);
+
+	static size_t bucket(uint64_t v) {
+		if (v < numLinear) return static_cast<size_t>(v);
+		const size_t exponent = 63 - countLeadingZeros(v);
+		const size_t sub = static_cast<size_t>(v >> (exponent - subBits)) & ((1 << subBits) - 1);
+		return numLinear + (exponent - subBits - 1) * (1 << subBits) + sub;
+	}
+
+	/// the smallest value in bucket b
+	static uint64_t lowest(size_t b) {
+		if (b < numLinear) return b;
+		const size_t exponent = (b - numLinear) / (1 << subBits) + subBits + 1, sub = (b - numLinear) % (1 << subBits);
+		return (uint64_t((1 << subBits) + sub)) << (exponent - subBits);
+	}
+
+	static uint64_t width(size_t b) {
+		return b < numLinear ? 1 : uint64_t(1) << ((b - numLinear) / (1 << subBits) + 1);
+	}
+
+	static size_t countLeadingZeros(uint64_t v) {
+#if defined(__GNUC__)
+		return static_cast<size_t>(__builtin_clzll(v));
+#else
+		size_t n = 0;
+		for (uint64_t bit = uint64_t(1) << 63; !(v & bit); bit>>= 1) n++;
+		return n;
+#endif
+	}
+};
+
+struct HistogramSummary {
+	uint64_t count;
+	double min, mean, p50, p99, p999, max;
+};
+
+/// a plain histogram, for one thread at a time, or a snapshot of the ones below
+class Histogram {
+public:
+
+	Histogram() { clear(); }
+
+	void record(uint64_t value, uint64_t count=1) {
+		mCounts[LogBuckets::bucket(value)]+= count;
+		mCount+= count;
+		mSum+= static_cast<double>(value) * count;
+		mMin = std::min(mMin, value);
+		mMax = std::max(mMax, value);
+	}
+
+	/// adds other's values to these
+	Histogram& merge(const Histogram &other) {
+		for (size_t b = 0; b < LogBuckets::numBuckets; b++) mCounts[b]+= other.mCounts[b];
+		mCount+= other.mCount;
+		mSum+= other.mSum;
+		mMin = std::min(mMin, other.mMin);
+		mMax = std::max(mMax, other.mMax);
+		return *this;
+	}
+
+	/// the middle of the bucket holding the q'th quantile (0 to 1), kept within min and max
+	double getQuantile(double q) const {
+		if (mCount == 0) return 0;
+		const uint64_t rank = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(q * mCount)), 1);
+		uint64_t seen = 0;
+		for (size_t b = 0; b < LogBuckets::numBuckets; b++) {
+			seen+= mCounts[b];
+			if (seen >= rank) {
+				const double middle = LogBuckets::lowest(b) + 0.5 * (LogBuckets::width(b) - 1);
+				return std::min(std::max(middle, static_cast<double>(mMin)), static_cast<double>(mMax));
+			}
+		}
+		return static_cast<double>(mMax);
+	}
+
+	HistogramSummary getSummary() const {
+		return { mCount, static_cast<double>(getMin()), getMean(), getQuantile(0.5), getQuantile(0.99),
+			getQuantile(0.999), static_cast<double>(getMax()) };
+	}
+
+	uint64_t getCount() const { return mCount; }
+	uint64_t getMin() const { return mCount ? mMin : 0; }
+	uint64_t getMax() const { return mMax; }
+	double getMean() const { return mCount ? mSum / mCount : 0; }
+
+	void clear() {
+		mCounts.fill(0);
+		mCount = 0;
+		mSum = 0;
+		mMin = std::numeric_limits<uint64_t>::max();
+		mMax = 0;
+	}
+
+protected:
+	friend class AtomicHistogram;
+
+	std::array<uint64_t, LogBuckets::numBuckets> mCounts;
+	uint64_t mCount;
+	double mSum;
+	uint64_t mMin, mMax;
+};
+
+/// recorded into by one thread and read from any, without locks or read-modify-writes;
+/// snapshots taken while it's recording may be a value or two behind
+class AtomicHistogram {
+public:
+
+	AtomicHistogram() { clear(); }
+
+	/// from its one writer thread only
+	void record(uint64_t value) {
+		increment(mCounts[LogBuckets::bucket(value)]);
+		mSum.store(mSum.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+		if (value < mMin.load(std::memory_order_relaxed)) mMin.store(value, std::memory_order_relaxed);
+		if (value > mMax.load(std::memory_order_relaxed)) mMax.store(value, std::memory_order_relaxed);
+	}
+
+	/// adds what's been recorded so far to output
+	void addTo(Histogram &output) const {
+		uint64_t count = 0;
+		for (size_t b = 0; b < LogBuckets::numBuckets; b++) {
+			const uint64_t n = mCounts[b].load(std::memory_order_relaxed);
+			output.mCounts[b]+= n;
+			count+= n;
+		}
+		if (!count) return;
+		output.mCount+= count;
+		output.mSum+= static_cast<double>(mSum.load(std::memory_order_relaxed));
+		output.mMin = std::min(output.mMin, mMin.load(std::memory_order_relaxed));
+		output.mMax = std::max(output.mMax, mMax.load(std::memory_order_relaxed));
+	}
+
+	Histogram getSnapshot() const {
+		Histogram output;
+		addTo(output);
+		return output;
+	}
+
+	/// only while nothing's recording
+	void clear() {
+		for (auto &count : mCounts) count.store(0, std::memory_order_relaxed);
+		mSum.store(0, std::memory_order_relaxed);
+		mMin.store(std::numeric_limits<uint64_t>::max(), std::memory_order_relaxed);
+		mMax.store(0, std::memory_order_relaxed);
+	}
+
+protected:
+	std::array<std::atomic<uint64_t>, LogBuckets::numBuckets> mCounts;
+	std::atomic<uint64_t> mSum, mMin, mMax;
+
+	static void increment(std::atomic<uint64_t> &count) {
+		count.store(count.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+	}
+};
+
+/// recorded into by any number of threads, each into its own AtomicHistogram, which
+/// getSnapshot() merges. A thread's recorder is looked up once and cached
+class ConcurrentHistogram {
+public:
+
+	ConcurrentHistogram(): mId(nextId()) {}
+
+	ConcurrentHistogram(const ConcurrentHistogram&) = delete;
+	ConcurrentHistogram& operator=(const ConcurrentHistogram&) = delete;
+
+	void record(uint64_t value) {
+		getRecorder().record(value);
+	}
+
+	/// the calling thread's AtomicHistogram, to keep hold of in the hottest loops
+	AtomicHistogram& getRecorder() {
+		static thread_local std::array<CacheEntry, 8> cache = {};
+		CacheEntry &entry = cache[mId % cache.size()];
+		if (entry.id != mId) entry = { mId, &addRecorder() };
+		return *entry.recorder;
+	}
+
+	/// every thread's values so far
+	Histogram getSnapshot() const {
+		Histogram output;
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (const auto &recorder : mRecorders) recorder.second->addTo(output);
+		return output;
+	}
+
+	/// only while nothing's recording
+	void clear() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		for (auto &recorder : mRecorders) recorder.second->clear();
+	}
+
+protected:
+
+	struct CacheEntry {
+		uint64_t id;
+		AtomicHistogram *recorder;
+	};
+
+	// ids rather than addresses in the cache, so a new histogram at an old one's address
+	// doesn't find its recorders
+	const uint64_t mId;
+	std::unordered_map<std::thread::id, std::unique_ptr<AtomicHistogram>> mRecorders;
+	mutable std::mutex mMutex;
+
+	static uint64_t nextId() {
+		static std::atomic<uint64_t> id(1);
+		return id.fetch_add(1);
+	}
+
+	AtomicHistogram& addRecorder() {
+		std::lock_guard<std::mutex> lock(mMutex);
+		auto &recorder = mRecorders[std::this_thread::get_id()];
+		if (!recorder) recorder.reset(new AtomicHistogram());
+		return *recorder;
+	}
+};
+
+} // namespace whg
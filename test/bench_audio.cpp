@@ -0,0 +1,181 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <functional>
+
+#include "whelpersg/audio.h"
+
+// Accuracy and speed of the batch mtof / ftom / ftoo / ftomel / meltof / atodb / dbtoa /
+// logAmplitude at each Precision against the scalar double versions, over a million values
+// spread across each function's useful range. Errors are relative for the exponential ones,
+// for the rest absolute below 1 and relative above (past that the error is float rounding).
+// ftomel near 0 Hz is limited by rounding 1 + f / 700, not by the precision.
+// Then the same for the audio::lookup tables, where the speed is against the scalar double version
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_audio.cpp
+// usage: bench_audio [numValues=1000000]
+
+using namespace std;
+using namespace std::chrono;
+using whg::simd::Precision;
+
+struct Function {
+	string name;
+	double low, high;
+	bool isLogUniform; // spread the input evenly in log(x) instead of x
+	bool isRelative; // otherwise absolute below 1, relative above
+	function<double(double)> exact;
+	function<void(const float*, float*, size_t, Precision)> batch;
+	double tolerances[3]; // LOW, MEDIUM, HIGH
+};
+
+/// one of the audio::lookup functions against the exact version, templated so neither is
+/// timed through a std::function
+template <class Exact, class Lookup>
+bool checkLookup(const string &name, double low, double high, bool isLogUniform, bool isRelative, double tolerance,
+				 vector<float> &input, vector<float> &output, mt19937 &random, Exact exact, Lookup lookup) {
+
+	uniform_real_distribution<double> spread(isLogUniform ? std::log(low) : low, isLogUniform ? std::log(high) : high);
+	for (auto &x : input) {
+		double v = spread(random);
+		x = static_cast<float>(isLogUniform ? std::exp(v) : v);
+	}
+	const size_t N = input.size();
+
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < N; i++) output[i] = static_cast<float>(exact(input[i]));
+	double exactNs = 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+
+	start = steady_clock::now();
+	for (size_t i = 0; i < N; i++) output[i] = lookup(input[i]);
+	double ns = 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+
+	double maxError = 0;
+	for (size_t i = 0; i < N; i++) {
+		double value = exact(input[i]);
+		double error = std::abs(output[i] - value);
+		error/= isRelative ? std::abs(value) : max(1.0, std::abs(value));
+		maxError = max(maxError, error);
+	}
+
+	cout << setw(14) << name << setw(14) << maxError << setw(14) << tolerance
+	<< setw(12) << ns << setw(10) << exactNs / ns << endl;
+
+	if (!(maxError <= tolerance)) {
+		cout << "lookup " << name << ": error over tolerance" << endl;
+		return false;
+	}
+	return true;
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t N = argc > 1 ? stoul(argv[1]) : 1000000;
+
+	// exp2 / log2 on their own, then the audio functions built on them
+	vector<Function> functions = {
+		{ "exp2", -126, 127, false, true, [](double x) { return std::exp2(x); },
+			[](const float *i, float *o, size_t n, Precision p) { whg::simd::exp2(i, o, n, p); }, { 1.1e-4, 4e-6, 2e-7 } },
+		{ "log2", 1e-37, 1e38, true, false, [](double x) { return std::log2(x); },
+			[](const float *i, float *o, size_t n, Precision p) { whg::simd::log2(i, o, n, p); }, { 1e-4, 2.5e-6, 4e-7 } },
+		{ "mtof", -60, 180, false, true, [](double x) { return audio::mtof(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::mtof(i, o, n, p); }, { 1.1e-4, 5e-6, 1e-6 } },
+		{ "ftom", 1, 24000, true, false, [](double x) { return audio::ftom(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::ftom(i, o, n, p); }, { 2.5e-4, 6e-6, 6e-6 } },
+		{ "ftoo", 1, 24000, true, false, [](double x) { return audio::ftoo(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::ftoo(i, o, n, p); }, { 1e-4, 2.5e-6, 6e-7 } },
+		{ "ftomel", 0, 24000, false, false, [](double x) { return audio::ftomel(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::ftomel(i, o, n, p); }, { 2.5e-4, 2.5e-4, 2.5e-4 } },
+		{ "meltof", 0, 4000, false, false, [](double x) { return audio::meltof(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::meltof(i, o, n, p); }, { 1e-3, 5e-5, 6e-7 } },
+		{ "atodb", 1e-7, 100, true, false, [](double x) { return audio::atodb(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::atodb(i, o, n, p); }, { 2.5e-4, 5e-6, 1.5e-6 } },
+		{ "dbtoa", -140, 40, false, true, [](double x) { return audio::dbtoa(x); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::dbtoa(i, o, n, p); }, { 1.1e-4, 5e-6, 1e-6 } },
+		{ "logAmplitude", 0, 1000, false, false, [](double x) { return 20.0 * std::log10(x + 1); },
+			[](const float *i, float *o, size_t n, Precision p) { audio::logAmplitude(i, o, n, p); }, { 2.5e-4, 5e-6, 2e-6 } }
+	};
+
+	mt19937 random(1);
+	vector<float> input(N), output(N);
+	bool passed = true;
+
+	cout << setw(14) << "function" << setw(10) << "precision" << setw(14) << "max error" << setw(14) << "tolerance"
+	<< setw(12) << "ns/value" << setw(10) << "speedup" << endl;
+
+	for (const auto &f : functions) {
+
+		uniform_real_distribution<double> spread(f.isLogUniform ? std::log(f.low) : f.low, f.isLogUniform ? std::log(f.high) : f.high);
+		for (auto &x : input) {
+			double v = spread(random);
+			x = static_cast<float>(f.isLogUniform ? std::exp(v) : v);
+		}
+
+		// the exact version, one value at a time as the callers do now
+		auto start = steady_clock::now();
+		for (size_t i = 0; i < N; i++) {
+			output[i] = static_cast<float>(f.exact(input[i]));
+		}
+		double exactNs = 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+		cout << setw(14) << f.name << setw(10) << "double" << setw(14) << "-" << setw(14) << "-"
+		<< setw(12) << exactNs << setw(10) << 1 << endl;
+
+		const char *names[] = { "LOW", "MEDIUM", "HIGH" };
+		for (int p = 0; p < 3; p++) {
+			const Precision precision = static_cast<Precision>(p);
+
+			start = steady_clock::now();
+			f.batch(&input[0], &output[0], N, precision);
+			double ns = 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+
+			double maxError = 0;
+			for (size_t i = 0; i < N; i++) {
+				double exact = f.exact(input[i]);
+				double error = std::abs(output[i] - exact);
+				error/= f.isRelative ? std::abs(exact) : max(1.0, std::abs(exact));
+				maxError = max(maxError, error);
+			}
+
+			cout << setw(14) << f.name << setw(10) << names[p] << setw(14) << maxError << setw(14) << f.tolerances[p]
+			<< setw(12) << ns << setw(10) << exactNs / ns << endl;
+
+			if (!(maxError <= f.tolerances[p])) {
+				cout << f.name << " " << names[p] << ": error over tolerance" << endl;
+				passed = false;
+			}
+		}
+	}
+
+	// the constexpr table lookups, one value at a time
+	cout << endl << setw(14) << "lookup" << setw(14) << "max error" << setw(14) << "tolerance"
+	<< setw(12) << "ns/value" << setw(10) << "speedup" << endl;
+
+	passed&= checkLookup("mtof", 0, 128, false, true, 6e-7, input, output, random,
+						 [](double x) { return audio::mtof(x); }, [](float x) { return audio::lookup::mtof(x); });
+	passed&= checkLookup("ftom", 8.18, 13289, true, false, 2e-5, input, output, random,
+						 [](double x) { return audio::ftom(x); }, [](float x) { return audio::lookup::ftom(x); });
+	passed&= checkLookup("ftomel", 0, 24000, false, false, 2.5e-4, input, output, random,
+						 [](double x) { return audio::ftomel(x); }, [](float x) { return audio::lookup::ftomel(x); });
+	passed&= checkLookup("meltof", 0, 4000, false, false, 1e-4, input, output, random,
+						 [](double x) { return audio::meltof(x); }, [](float x) { return audio::lookup::meltof(x); });
+
+	// whole notes and cents come straight from the table, and outside the table is exact
+	for (int note = 0; note < 128; note++) {
+		for (int cents = 0; cents < 100; cents++) {
+			double exact = audio::mtof(note + cents / 100.0);
+			if (std::abs(audio::lookup::mtof(note, cents) - exact) > 2e-7 * exact) {
+				cout << "lookup mtof(" << note << ", " << cents << ") is off" << endl;
+				passed = false;
+			}
+		}
+	}
+	for (float x : { -20.0f, 130.0f, 200.0f }) {
+		if (audio::lookup::mtof(x) != static_cast<float>(audio::mtof(x))) {
+			cout << "lookup mtof(" << x << ") should fall back to the exact version" << endl;
+			passed = false;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,124 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+
+#define USE_FFTW
+#include "whelpersg/convolution.h"
+
+// CPU per channel of the partitioned convolvers against a direct form FIR,
+// as a percentage of realtime at 44.1kHz, and the largest difference of their output from
+// the direct form's relative to its peak. Exits with 1 if either is off by more than 1e-4
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_convolution.cpp -lfftw3f
+
+using namespace std;
+using namespace std::chrono;
+
+const double sampleRate = 44100;
+
+struct DirectConvolver {
+	DirectConvolver(const vector<float> &ir): mIR(ir), mHistory(ir.size() * 2, 0), mHead(0) {}
+
+	void process(const float *input, float *output, size_t N) {
+		const size_t L = mIR.size();
+		for (size_t n = 0; n < N; n++) {
+			// history is mirrored so the taps are always contiguous
+			mHead = (mHead + L - 1) % L;
+			mHistory[mHead] = mHistory[mHead + L] = input[n];
+			const float *x = &mHistory[mHead];
+			float sum = 0;
+			for (size_t k = 0; k < L; k++) {
+				sum+= mIR[k] * x[k];
+			}
+			output[n] = sum;
+		}
+	}
+
+	vector<float> mIR, mHistory;
+	size_t mHead;
+};
+
+/// the largest difference over the first N samples, relative to reference's peak
+double relativeDifference(const vector<float> &reference, const vector<float> &output, size_t N) {
+	float maxDiff = 0, peak = 0;
+	for (size_t i = 0; i < N; i++) {
+		maxDiff = max(maxDiff, abs(output[i] - reference[i]));
+		peak = max(peak, abs(reference[i]));
+	}
+	return maxDiff / peak;
+}
+
+template <class F>
+double cpuPercent(F process, size_t numSamples) {
+	auto start = steady_clock::now();
+	process();
+	double taken = duration<double>(steady_clock::now() - start).count();
+	return 100.0 * taken / (numSamples / sampleRate);
+}
+
+int main() {
+
+	mt19937 rng(0);
+	uniform_real_distribution<float> dist(-1, 1);
+
+	const size_t blockSize = 256;
+	const size_t numSamples = static_cast<size_t>(sampleRate * 2) / blockSize * blockSize;
+
+	vector<float> input(numSamples), directOutput(numSamples), uniformOutput(numSamples), nonUniformOutput(numSamples);
+	for (auto &v : input) v = dist(rng);
+	bool passed = true;
+
+	cout << "block size " << blockSize << ", CPU % per channel and max difference from direct over its peak" << endl;
+	cout << setw(10) << "taps" << setw(12) << "direct" << setw(12) << "uniform" << setw(12) << "non-uniform"
+	<< setw(14) << "uniform diff" << setw(14) << "non-uni diff" << endl;
+
+	for (size_t taps : { 1024, 8192, 32768, 100000 }) {
+
+		vector<float> ir(taps);
+		for (size_t i = 0; i < taps; i++) {
+			ir[i] = dist(rng) * exp(-6.0f * i / taps);
+		}
+
+		dsp::PartitionedConvolver uniform(ir, blockSize);
+		dsp::NonUniformConvolver nonUniform(ir, blockSize);
+
+		double directCpu = -1;
+		size_t numChecked = numSamples;
+		DirectConvolver direct(ir);
+		// direct form gets silly past here, don't wait for it, only check the first few blocks
+		if (taps <= 32768) {
+			directCpu = cpuPercent([&]() {
+				direct.process(&input[0], &directOutput[0], numSamples);
+			}, numSamples);
+		}
+		else {
+			numChecked = 16 * blockSize;
+			direct.process(&input[0], &directOutput[0], numChecked);
+		}
+
+		double uniformCpu = cpuPercent([&]() {
+			for (size_t i = 0; i < numSamples; i+= blockSize) {
+				uniform.process(&input[i], &uniformOutput[i]);
+			}
+		}, numSamples);
+
+		double nonUniformCpu = cpuPercent([&]() {
+			for (size_t i = 0; i < numSamples; i+= blockSize) {
+				nonUniform.process(&input[i], &nonUniformOutput[i]);
+			}
+		}, numSamples);
+
+		cout << setw(10) << taps << setw(12);
+		if (directCpu < 0) cout << "-";
+		else cout << directCpu;
+		const double uniformDiff = relativeDifference(directOutput, uniformOutput, numChecked);
+		const double nonUniformDiff = relativeDifference(directOutput, nonUniformOutput, numChecked);
+		cout << setw(12) << uniformCpu << setw(12) << nonUniformCpu << setw(14) << uniformDiff << setw(14) << nonUniformDiff << endl;
+		if (uniformDiff > 1e-4 || nonUniformDiff > 1e-4) {
+			cout << taps << " taps differ from the direct form" << endl;
+			passed = false;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#define USE_FFTW
+#include "whelpersg/cqt.h"
+
+// Chroma of a chord progression (C, Am, F, G, two seconds each, tones with a few harmonics
+// from C3 up) per frame from a 2048 point FFT and chromaFilterbank, dense and as a
+// SparseFilterbank, against a ConstantQ with its default settings, which needs a bigger FFT
+// per frame. Prints the time per frame of each and how often the three loudest pitch classes
+// are the chord's, and checks the constant-Q chroma gets them
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_cqt.cpp -lfftw3f
+// usage: bench_cqt [seconds=40] [binsPerOctave=12] [minFrequency=130.8]
+
+using namespace std;
+using namespace std::chrono;
+
+const size_t fftSize = 2048;
+const size_t hopSize = 512;
+
+/// true when the three largest of chroma are the pitch classes of the chord's notes
+bool hasChord(const float *chroma, const vector<int> &chord) {
+	vector<int> order(12), classes;
+	for (int i = 0; i < 12; i++) order[i] = i;
+	for (int note : chord) classes.push_back(note % 12);
+	partial_sort(order.begin(), order.begin() + 3, order.end(), [chroma](int a, int b) { return chroma[a] > chroma[b]; });
+	return is_permutation(order.begin(), order.begin() + 3, classes.begin());
+}
+
+int main(int argc, char *argv[]) {
+
+	const double seconds = argc > 1 ? stod(argv[1]) : 40;
+	dsp::ConstantQSettings settings;
+	if (argc > 2) settings.binsPerOctave = stoul(argv[2]);
+	if (argc > 3) settings.minFrequency = stod(argv[3]);
+	settings.numBins = settings.binsPerOctave * 6;
+	const float sr = static_cast<float>(settings.sampleRate);
+
+	// MIDI notes of each chord, two seconds each
+	const vector<vector<int>> chords = { { 48, 52, 55 }, { 57, 60, 64 }, { 53, 57, 60 }, { 55, 59, 62 } };
+	const size_t chordLength = 2 * settings.sampleRate;
+	vector<float> audio(static_cast<size_t>(seconds * sr));
+	for (size_t i = 0; i < audio.size(); i++) {
+		const auto &chord = chords[(i / chordLength) % chords.size()];
+		for (int note : chord) {
+			const double f = audio::mtof(note);
+			for (int h = 1; h <= 4; h++) audio[i]+= static_cast<float>(0.1 / h * sin(2 * PI * f * h * i / sr));
+		}
+	}
+
+	dsp::ConstantQ cq(settings);
+	const size_t cqSize = cq.getFFTSize();
+
+	dsp::ChromaFilterSettings filterSettings;
+	filterSettings.sampleRate = settings.sampleRate;
+	filterSettings.setSize(fftSize);
+	filterSettings.numChromas = 12;
+	const auto dense = dsp::chromaFilterbank<float>(filterSettings);
+	const dsp::SparseFilterbank<float> sparse(dense, 1e-4f);
+
+	dsp::RealFFT fft(fftSize), cqFFT(cqSize);
+	fft.setWindow(dsp::window<float>::Type::HANN);
+	vector<float> magnitudes(fftSize / 2 + 1);
+
+	// frames centred on the same samples for all three, away from chord changes
+	vector<size_t> centres;
+	for (size_t c = cqSize / 2; c + cqSize / 2 <= audio.size(); c+= hopSize) {
+		const size_t intoChord = c % chordLength;
+		if (intoChord > cqSize / 2 && intoChord + cqSize / 2 < chordLength) centres.push_back(c);
+	}
+	auto chordAt = [&](size_t c) { return chords[(c / chordLength) % chords.size()]; };
+
+	float chroma[12];
+	size_t denseRight = 0, sparseRight = 0, cqRight = 0;
+
+	auto start = steady_clock::now();
+	for (size_t c : centres) {
+		fft.forward(&audio[c - fftSize / 2]);
+		fft.getPower(magnitudes);
+		for (size_t k = 0; k < 12; k++) chroma[k] = whg::simd::dot(&dense[k][0], &magnitudes[0], magnitudes.size());
+		denseRight+= hasChord(chroma, chordAt(c));
+	}
+	const double denseUs = 1e6 * duration<double>(steady_clock::now() - start).count() / centres.size();
+
+	start = steady_clock::now();
+	for (size_t c : centres) {
+		fft.forward(&audio[c - fftSize / 2]);
+		fft.getPower(magnitudes);
+		sparse.apply(&magnitudes[0], chroma);
+		sparseRight+= hasChord(chroma, chordAt(c));
+	}
+	const double sparseUs = 1e6 * duration<double>(steady_clock::now() - start).count() / centres.size();
+
+	vector<float> cqMagnitudes(cq.getNumBins());
+	start = steady_clock::now();
+	for (size_t c : centres) {
+		cqFFT.forward(&audio[c - cqSize / 2]);
+		cq.transform(&cqFFT.getOutput()[0], &cqMagnitudes[0]);
+		cq.chroma(&cqMagnitudes[0], chroma);
+		cqRight+= hasChord(chroma, chordAt(c));
+	}
+	const double cqUs = 1e6 * duration<double>(steady_clock::now() - start).count() / centres.size();
+
+	const double N = static_cast<double>(centres.size());
+	cout << centres.size() << " frames, constant-Q " << settings.binsPerOctave << " bins per octave from "
+	<< settings.minFrequency << "Hz" << endl;
+	cout << setw(28) << "" << setw(10) << "fft" << setw(14) << "us/frame" << setw(14) << "chords right" << endl;
+	cout << setw(28) << "chromaFilterbank" << setw(10) << fftSize << setw(14) << denseUs << setw(14) << denseRight / N << endl;
+	cout << setw(28) << "SparseFilterbank" << setw(10) << fftSize << setw(14) << sparseUs << setw(14) << sparseRight / N << endl;
+	cout << setw(28) << "ConstantQ" << setw(10) << cqSize << setw(14) << cqUs << setw(14) << cqRight / N << endl;
+
+	if (cqRight < 0.95 * N) {
+		cout << "constant-Q chroma found too few chords" << endl;
+		return 1;
+	}
+	return 0;
+}
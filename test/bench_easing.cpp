@@ -0,0 +1,252 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <memory>
+
+#include "whelpersg/easing.h"
+
+// Checks every curve's name finds it, that each EasingShape starts at 0 and ends at 1 and
+// gives the same on floats and simd::float4s, and times the name lookup.
+// Builds the same random chains of eases (extend() by class and by name over every curve,
+// add() with gaps and jumps) as an EasingChain and a KeyframeTrack, checks they give exactly
+// the same values at random times and while playing forwards, and times both.
+// Then 10k and 100k channels as one Easer each against a BatchEaser, with every channel on
+// the same curve and with a random curve per channel
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_easing.cpp
+// usage: bench_easing [numSegments=1000]
+
+using namespace std;
+using namespace std::chrono;
+
+/// numChannels Easers updated one by one against a BatchEaser, returns false if they differ
+bool benchBatch(size_t numChannels, bool isMixed, mt19937 &random) {
+
+	const size_t numFrames = 200;
+	const float frameTime = 1.0f / 60;
+	uniform_real_distribution<float> unit(0, 1);
+
+	vector<unique_ptr<whg::Easer<float>>> easers;
+	whg::BatchEaser batch(numChannels);
+
+	for (size_t c = 0; c < numChannels; c++) {
+		float start = unit(random), end = start + 0.5f + 2 * unit(random);
+		float from = unit(random), to = unit(random);
+		whg::EasingCurve curve = isMixed ? static_cast<whg::EasingCurve>(random() % whg::numEasingCurves) : whg::EasingCurve::QUAD_IN_OUT;
+
+		easers.emplace_back(whg::makeEaser<float>(curve, start, end, from, to));
+		batch.set(c, curve, start, end, from, to);
+	}
+
+	vector<float> easerValues(numChannels), batchValues(numChannels);
+	float maxError = 0;
+	double easerSeconds = 0, batchSeconds = 0;
+
+	for (size_t f = 0; f < numFrames; f++) {
+		const float time = f * frameTime;
+
+		auto start = steady_clock::now();
+		for (size_t c = 0; c < numChannels; c++) easerValues[c] = easers[c]->update(time);
+		easerSeconds+= duration<double>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		batch.update(time, &batchValues[0]);
+		batchSeconds+= duration<double>(steady_clock::now() - start).count();
+
+		for (size_t c = 0; c < numChannels; c++) maxError = max(maxError, abs(easerValues[c] - batchValues[c]));
+	}
+
+	const double frames = static_cast<double>(numFrames);
+	cout << setw(10) << numChannels << setw(10) << (isMixed ? "all" : "in out")
+	<< setw(14) << 1e6 * easerSeconds / frames << setw(14) << 1e6 * batchSeconds / frames
+	<< setw(10) << easerSeconds / batchSeconds << setw(14) << maxError << endl;
+
+	// elastic and bounce are steep enough to make a few ulps of t a few 1e-6
+	return maxError < 5e-5f;
+}
+
+/// false if curve C doesn't go from 0 to 1, or gives different values on float4s
+template <whg::EasingCurve C>
+struct CheckShape {
+	bool operator()(const string &name) const {
+		typedef whg::EasingShape<C> Shape;
+		float maxDiff = 0;
+		for (int i = 0; i <= 1000; i++) {
+			float t = i / 1000.0f, vector[4];
+			Shape::apply(whg::simd::float4(t)).store(vector);
+			maxDiff = max(maxDiff, abs(Shape::apply(t) - vector[0]));
+		}
+		float first = Shape::apply(0.0f), last = Shape::apply(1.0f);
+		if (C == whg::EasingCurve::HOLD) first = 0;
+		if (maxDiff > 1e-6f || abs(first) > 1e-6f || abs(last - 1) > 1e-6f) {
+			cout << name << " goes from " << first << " to " << last << ", float4 off by " << maxDiff << endl;
+			return false;
+		}
+		return true;
+	}
+};
+
+/// names round trip, shapes go from 0 to 1 and match on floats and float4s, false if not
+bool checkCurves() {
+
+	bool passed = true;
+	for (size_t c = 0; c < whg::numEasingCurves; c++) {
+		const whg::EasingCurve curve = static_cast<whg::EasingCurve>(c);
+		const string name = whg::getEasingCurveName(curve);
+		whg::EasingCurve found = whg::EasingCurve::HOLD;
+		if (!whg::easingCurveFromName(name, found) || found != curve) {
+			cout << name << " doesn't find its curve" << endl;
+			passed = false;
+		}
+
+		if (!whg::withEasingCurve<CheckShape>(curve, name)) passed = false;
+	}
+
+	for (string name : { "", "Linear", "LinearEaserX", "linearEaser", "QuadInOutEase" }) {
+		whg::EasingCurve curve;
+		if (whg::easingCurveFromName(name, curve)) {
+			cout << "\"" << name << "\" shouldn't be a curve" << endl;
+			passed = false;
+		}
+	}
+
+	const size_t numLookups = 1000000;
+	vector<string> names;
+	for (size_t c = 0; c < whg::numEasingCurves; c++) names.push_back(whg::getEasingCurveName(static_cast<whg::EasingCurve>(c)));
+	size_t sum = 0;
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < numLookups; i++) {
+		whg::EasingCurve curve = whg::EasingCurve::LINEAR;
+		whg::easingCurveFromName(names[i % names.size()], curve);
+		sum+= static_cast<size_t>(curve);
+	}
+	double seconds = duration<double>(steady_clock::now() - start).count();
+	cout << whg::numEasingCurves << " curves, " << 1e9 * seconds / numLookups << " ns per name lookup (" << sum % 10 << ")" << endl;
+
+	return passed;
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t numSegments = argc > 1 ? stoul(argv[1]) : 1000;
+	const size_t numLookups = 1000000;
+	const bool curvesPassed = checkCurves();
+
+	mt19937 random(1);
+	uniform_real_distribution<float> unit(0, 1);
+
+	whg::EasingChain<float> chain;
+	whg::KeyframeTrack<float> track;
+
+	chain.add(new whg::LinearEaser<float>(0.5f, 0.0f, 1.0f));
+	track.add(whg::LinearEaser<float>(0.5f, 0.0f, 1.0f));
+
+	for (size_t i = 1; i < numSegments; i++) {
+		float duration = 0.01f + unit(random);
+		float value = 10 * unit(random) - 5;
+		int kind = static_cast<int>(random() % 8);
+
+		if (kind == 0) {
+			chain.extend<whg::QuadInOutEaser<float>>(duration, value);
+			track.extend<whg::QuadInOutEaser<float>>(duration, value);
+		}
+		else if (kind == 1) {
+			// a gap and a jump
+			float start = chain.getEndTime() + unit(random);
+			chain.add("QuadOutEaser", start, start + duration, value, -value);
+			track.add("QuadOutEaser", start, start + duration, value, -value);
+		}
+		else {
+			const char *name = whg::getEasingCurveName(static_cast<whg::EasingCurve>(random() % whg::numEasingCurves));
+			chain.extend(name, duration, value);
+			track.extend(name, duration, value);
+		}
+	}
+
+	const float endTime = chain.getEndTime();
+	cout << numSegments << " eases over " << endTime << "s, " << track.size() << " keyframe segments" << endl;
+
+	if (track.getEndTime() != endTime) {
+		cout << "end times differ: " << track.getEndTime() << " and " << endTime << endl;
+		return 1;
+	}
+
+	// random times, including before the start and after the end
+	vector<float> times(numLookups);
+	for (auto &t : times) t = (1.1f * unit(random) - 0.05f) * endTime;
+
+	vector<float> chainValues(numLookups), trackValues(numLookups);
+
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < numLookups; i++) chainValues[i] = chain.valueAt(times[i]);
+	double chainSeconds = duration<double>(steady_clock::now() - start).count();
+
+	start = steady_clock::now();
+	for (size_t i = 0; i < numLookups; i++) trackValues[i] = track.valueAt(times[i]);
+	double trackSeconds = duration<double>(steady_clock::now() - start).count();
+
+	size_t mismatches = 0;
+	for (size_t i = 0; i < numLookups; i++) {
+		if (chainValues[i] != trackValues[i]) {
+			if (mismatches++ < 5) {
+				cout << "at " << setprecision(9) << times[i] << " chain " << chainValues[i] << " track " << trackValues[i] << endl;
+			}
+		}
+	}
+
+	cout << setw(20) << "valueAt" << setw(14) << "chain ns" << setw(14) << "track ns" << endl;
+	cout << setw(20) << "random" << setw(14) << 1e9 * chainSeconds / numLookups << setw(14) << 1e9 * trackSeconds / numLookups << endl;
+
+	// playing forwards at a fixed rate, the chain stays whole (its update() drops passed easers)
+	const float step = endTime / numLookups;
+	{
+		start = steady_clock::now();
+		for (size_t i = 0; i < numLookups; i++) trackValues[i] = track.update(i * step);
+		trackSeconds = duration<double>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		for (size_t i = 0; i < numLookups; i++) chainValues[i] = chain.valueAt(i * step);
+		chainSeconds = duration<double>(steady_clock::now() - start).count();
+
+		for (size_t i = 0; i < numLookups; i++) {
+			if (chainValues[i] != trackValues[i]) {
+				if (mismatches++ < 5) {
+					cout << "update at " << setprecision(9) << i * step << " chain " << chainValues[i] << " track " << trackValues[i] << endl;
+				}
+			}
+		}
+	}
+	cout << setw(20) << "forwards" << setw(14) << 1e9 * chainSeconds / numLookups << setw(14) << 1e9 * trackSeconds / numLookups << endl;
+
+	// and jumping back
+	for (float t : { 0.25f * endTime, 0.0f, 0.75f * endTime }) {
+		if (track.update(t) != chain.valueAt(t)) {
+			cout << "update after seeking to " << t << " differs" << endl;
+			mismatches++;
+		}
+	}
+
+	cout << endl << setw(10) << "channels" << setw(10) << "curves" << setw(14) << "easers us" << setw(14) << "batch us"
+	<< setw(10) << "speedup" << setw(14) << "max diff" << endl;
+
+	bool batchMatches = true;
+	for (size_t numChannels : { 10000, 100000 }) {
+		for (bool isMixed : { false, true }) {
+			batchMatches&= benchBatch(numChannels, isMixed, random);
+		}
+	}
+
+	if (mismatches) {
+		cout << mismatches << " values differ" << endl;
+		return 1;
+	}
+	if (!curvesPassed) {
+		return 1;
+	}
+	if (!batchMatches) {
+		cout << "batch values differ from the easers" << endl;
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,152 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+
+#define USE_FFTW
+#include "whelpersg/graph.h"
+#include "whelpersg/evaluate.h"
+
+// Mel, chroma, MFCC, flux + tempo and band onsets of a click track, first as separate
+// analyses each doing their own window, FFT and magnitudes, then as one FeatureGraph
+// sharing them, on one thread and on several. Checks the graph gives the same features,
+// and prints the time per frame and the graph's per node timings
+// build with something like: g++ -std=c++14 -O3 -pthread -I../.. bench_graph.cpp -lfftw3f
+// usage: bench_graph [seconds=60] [threads=hardware]
+
+using namespace std;
+using namespace std::chrono;
+
+const size_t fftSize = 2048;
+const size_t hopSize = 512;
+
+int main(int argc, char *argv[]) {
+
+	const double seconds = argc > 1 ? stod(argv[1]) : 60;
+	const size_t numThreads = argc > 2 ? stoul(argv[2]) : max(2u, thread::hardware_concurrency());
+	const float sr = 44100;
+
+	const auto signal = whg::clickTrack(sr, seconds, 120, 120, 0.05f);
+	const auto &audio = signal.audio;
+	const size_t numFrames = (audio.size() - fftSize) / hopSize + 1;
+
+	dsp::MelFilterSettings mel;
+	mel.minFrequency = 30;
+	mel.maxFrequency = 16000;
+	mel.numBands = 40;
+	mel.sampleRate = static_cast<uint>(sr);
+	mel.setSize(fftSize);
+
+	dsp::ChromaFilterSettings chroma;
+	chroma.sampleRate = static_cast<uint>(sr);
+	chroma.setSize(fftSize);
+	chroma.numChromas = 12;
+
+	// every feature of every frame, to compare
+	vector<vector<float>> separate(numFrames), shared(numFrames);
+
+	// each analysis on its own, as if they didn't know about each other
+	double separateSeconds;
+	{
+		struct Analysis {
+			dsp::RealFFT fft;
+			vector<float> magnitudes;
+			unique_ptr<whg::FeatureNode> node;
+			vector<float> output;
+
+			Analysis(whg::FeatureNode *n): fft(fftSize), magnitudes(fftSize / 2 + 1), node(n), output(n->getSize()) {
+				fft.setWindow(dsp::window<float>::Type::HANN);
+			}
+
+			void process(const float *frame) {
+				fft.forward(frame);
+				for (size_t k = 0; k < magnitudes.size(); k++) magnitudes[k] = abs(fft.getOutput()[k]);
+				const float *input = &magnitudes[0];
+				node->process(&input, &output[0]);
+			}
+		};
+
+		vector<unique_ptr<Analysis>> analyses;
+		analyses.emplace_back(new Analysis(new whg::MelNode(mel)));
+		analyses.emplace_back(new Analysis(new whg::ChromaNode(chroma)));
+		analyses.emplace_back(new Analysis(new whg::MfccNode(mel)));
+		analyses.emplace_back(new Analysis(new whg::FluxNode(fftSize)));
+		analyses.emplace_back(new Analysis(new whg::OnsetNode(fftSize, sr)));
+		whg::TempoNode tempo(hopSize, sr);
+		float bpm;
+
+		auto start = steady_clock::now();
+		for (size_t f = 0; f < numFrames; f++) {
+			for (auto &analysis : analyses) analysis->process(&audio[f * hopSize]);
+			const float *flux = &analyses[3]->output[0];
+			tempo.process(&flux, &bpm);
+
+			for (auto &analysis : analyses) separate[f].insert(separate[f].end(), analysis->output.begin(), analysis->output.end());
+			separate[f].push_back(bpm);
+		}
+		separateSeconds = duration<double>(steady_clock::now() - start).count();
+	}
+
+	cout << numFrames << " frames of " << fftSize << ", hop " << hopSize << endl;
+	cout << setw(24) << "" << setw(12) << "us/frame" << setw(12) << "speedup" << setw(12) << "max diff" << endl;
+	cout << setw(24) << "separate" << setw(12) << 1e6 * separateSeconds / numFrames << setw(12) << 1.0 << setw(12) << "-" << endl;
+
+	for (size_t threads : { size_t(1), numThreads }) {
+
+		whg::FeatureGraph graph(fftSize);
+		auto stft = graph.add<whg::StftNode>({ graph.getInput() }, fftSize);
+		auto magnitude = graph.add<whg::PowerNode>({ stft }, fftSize);
+		vector<size_t> outputs = {
+			graph.add<whg::MelNode>({ magnitude }, mel),
+			graph.add<whg::ChromaNode>({ magnitude }, chroma),
+			graph.add<whg::MfccNode>({ magnitude }, mel),
+			graph.add<whg::FluxNode>({ magnitude }, fftSize),
+			graph.add<whg::OnsetNode>({ magnitude }, fftSize, sr)
+		};
+		outputs.push_back(graph.add<whg::TempoNode>({ outputs[3] }, hopSize, sr));
+		graph.setOutput(outputs[3]);
+		graph.setNumThreads(threads);
+
+		auto start = steady_clock::now();
+		for (size_t f = 0; f < numFrames; f++) {
+			graph.process(&audio[f * hopSize]);
+			shared[f].clear();
+			for (size_t id : outputs) {
+				shared[f].insert(shared[f].end(), graph.getOutput(id), graph.getOutput(id) + graph.getSize(id));
+			}
+		}
+		double graphSeconds = duration<double>(steady_clock::now() - start).count();
+
+		float maxDiff = 0;
+		for (size_t f = 0; f < numFrames; f++) {
+			if (shared[f].size() != separate[f].size()) {
+				cout << "graph gives " << shared[f].size() << " features instead of " << separate[f].size() << endl;
+				return 1;
+			}
+			for (size_t i = 0; i < shared[f].size(); i++) {
+				maxDiff = max(maxDiff, abs(shared[f][i] - separate[f][i]) / max(1.0f, abs(separate[f][i])));
+			}
+		}
+
+		cout << setw(24) << ("graph, " + to_string(graph.getNumThreads()) + " thread" + (threads > 1 ? "s" : ""))
+		<< setw(12) << 1e6 * graphSeconds / numFrames << setw(12) << separateSeconds / graphSeconds
+		<< setw(12) << maxDiff << endl;
+
+		if (threads == 1) {
+			size_t unpooled = 0;
+			for (size_t id = 1; id < graph.getNumNodes(); id++) unpooled+= graph.getSize(id);
+			cout << setw(28) << "node" << setw(12) << "us/frame" << endl;
+			for (const auto &timing : graph.getTimings()) {
+				cout << setw(28) << timing.name << setw(12) << timing.getMeanMicroseconds() << endl;
+			}
+			cout << setw(28) << "buffers" << setw(12) << graph.getBufferSize() << " floats, " << unpooled << " unpooled" << endl;
+		}
+
+		if (maxDiff > 1e-4f) {
+			cout << "graph features differ" << endl;
+			return 1;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "whelpersg/mfcc.h"
+
+// dsp::MFCC against a naive reference on random power spectra: the dense melFilterbank()
+// matrix, std::log and a direct DCT-II loop in double, deltas and delta-deltas as the
+// regression over neighbouring frames (the first frame repeated before the start).
+// Checks the coefficients, deltas and delta-deltas frame by frame and the batch process()
+// against the per frame one, as well as SparseFilterbank, simd::log and simd::dot on their
+// own, and times both. Exits with 1 on a mismatch
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_mfcc.cpp
+// usage: bench_mfcc [numFrames=2000] [numBands=40] [numCoefficients=13]
+
+using namespace std;
+using namespace std::chrono;
+
+typedef vector<vector<double>> Frames;
+
+/// the largest difference relative to the largest reference value
+double relativeError(const vector<double> &reference, const vector<double> &values) {
+	double maxError = 0, maxValue = 1e-9;
+	for (size_t i = 0; i < reference.size(); i++) {
+		maxError = max(maxError, abs(values[i] - reference[i]));
+		maxValue = max(maxValue, abs(reference[i]));
+	}
+	return maxError / maxValue;
+}
+
+/// sum of n * (frames[t + n] - frames[t - n]) / sum of 2n^2, frames clamped to the ends
+vector<double> regression(const Frames &frames, long t, long width) {
+	auto at = [&](long i) -> const vector<double>& { return frames[min<long>(max<long>(i, 0), frames.size() - 1)]; };
+	vector<double> output(frames[0].size(), 0.0);
+	double norm = 0;
+	for (long n = 1; n <= width; n++) {
+		for (size_t k = 0; k < output.size(); k++) output[k]+= n * (at(t + n)[k] - at(t - n)[k]);
+		norm+= 2.0 * n * n;
+	}
+	for (auto &v : output) v/= norm;
+	return output;
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t numFrames = argc > 1 ? stoul(argv[1]) : 2000;
+	dsp::MelFilterSettings settings;
+	settings.sampleRate = 44100;
+	settings.setSize(1024);
+	settings.minFrequency = 0;
+	settings.maxFrequency = 8000;
+	settings.numBands = argc > 2 ? stoul(argv[2]) : 40;
+	const uint numCoefficients = argc > 3 ? stoul(argv[3]) : 13;
+	const uint width = 2;
+	const float logFloor = 1e-6f;
+	const size_t N = settings.nbins, B = settings.numBands;
+	bool passed = true;
+
+	// a few spectral peaks drifting under noise, so the deltas have something to follow
+	mt19937 random(1);
+	exponential_distribution<float> noise(1000);
+	vector<float> spectra(numFrames * N);
+	for (size_t f = 0; f < numFrames; f++) {
+		for (size_t k = 0; k < N; k++) {
+			const double peak = 40 + 30 * sin(2 * PI * f / 200.0);
+			spectra[f * N + k] = noise(random) + static_cast<float>(1 / (1 + pow((k % 100) - peak, 2)));
+		}
+	}
+
+	// the reference
+	const auto dense = dsp::melFilterbank<float>(settings);
+	auto start = steady_clock::now();
+	Frames cepstra(numFrames, vector<double>(numCoefficients)), mels(numFrames, vector<double>(B));
+	for (size_t f = 0; f < numFrames; f++) {
+		for (size_t b = 0; b < B; b++) {
+			double mel = 0;
+			for (size_t k = 0; k < N; k++) mel+= static_cast<double>(dense[b][k]) * spectra[f * N + k];
+			mels[f][b] = mel;
+		}
+		for (uint k = 0; k < numCoefficients; k++) {
+			double sum = 0;
+			for (size_t n = 0; n < B; n++) sum+= log(mels[f][n] + logFloor) * cos(PI / B * (n + 0.5) * k);
+			cepstra[f][k] = sqrt((k == 0 ? 1.0 : 2.0) / B) * sum;
+		}
+	}
+	const double referenceUs = 1e6 * duration<double>(steady_clock::now() - start).count() / numFrames;
+
+	// frames before the start are the first frame, then the deltas of those
+	const long W = width, first = -3 * W;
+	Frames padded;
+	for (long t = first; t < static_cast<long>(numFrames); t++) padded.push_back(cepstra[max<long>(t, 0)]);
+	Frames deltas;
+	for (long t = first; t < static_cast<long>(numFrames); t++) deltas.push_back(regression(padded, t - first, W));
+	auto deltaAt = [&](long t) { return deltas[t - first]; };
+	auto deltaDeltaAt = [&](long t) { return regression(deltas, t - first, W); };
+
+	// SparseFilterbank, with and without dropping small weights
+	const dsp::SparseFilterbank<float> sparse(dense), thresholded(dense, 1e-3f);
+	double sparseError = 0, thresholdedError = 0;
+	for (size_t f = 0; f < numFrames; f++) {
+		const vector<float> a = sparse.apply(vector<float>(&spectra[f * N], &spectra[f * N] + N));
+		const vector<float> b = thresholded.apply(vector<float>(&spectra[f * N], &spectra[f * N] + N));
+		sparseError = max(sparseError, relativeError(mels[f], vector<double>(a.begin(), a.end())));
+		thresholdedError = max(thresholdedError, relativeError(mels[f], vector<double>(b.begin(), b.end())));
+	}
+
+	// simd::log over six decades, simd::dot over odd lengths
+	double logError = 0, dotError = 0;
+	vector<float> x(4099), logs(x.size());
+	for (size_t i = 0; i < x.size(); i++) x[i] = static_cast<float>(pow(10.0, -6.0 + 6.0 * i / x.size()));
+	whg::simd::log(&x[0], &logs[0], x.size(), 0.5f);
+	for (size_t i = 0; i < x.size(); i++) logError = max(logError, abs(logs[i] - log(x[i] + 0.5)));
+	for (size_t length : { 1, 3, 4, 7, 64, 1023 }) {
+		double sum = 0, scale = 0;
+		for (size_t i = 0; i < length; i++) {
+			sum+= static_cast<double>(x[i]) * x[x.size() - length + i];
+			scale+= abs(static_cast<double>(x[i]) * x[x.size() - length + i]);
+		}
+		dotError = max(dotError, abs(whg::simd::dot(&x[0], &x[x.size() - length], length) - sum) / scale);
+	}
+	cout << "SparseFilterbank " << sparseError << ", dropping weights below 1e-3 " << thresholdedError
+	<< ", simd::log " << logError << ", simd::dot " << dotError << endl;
+	if (sparseError > 1e-5 || thresholdedError > 1e-2 || logError > 1e-6 || dotError > 1e-6) {
+		cout << "the filterbank or simd functions are off" << endl;
+		passed = false;
+	}
+
+	cout << numFrames << " frames of " << N << " bins, " << B << " bands, " << numCoefficients << " coefficients" << endl;
+	cout << setw(20) << "" << setw(12) << "us/frame" << setw(14) << "cepstra" << setw(14) << "deltas"
+	<< setw(14) << "delta-deltas" << setw(14) << "batch" << endl;
+	cout << setw(20) << "reference" << setw(12) << referenceUs << endl;
+
+	const char *names[] = { "MFCC", "with deltas", "and delta-deltas" };
+	for (int d = 0; d < 3; d++) {
+		dsp::MFCC mfcc(settings, numCoefficients), batch(settings, numCoefficients);
+		mfcc.setDeltas(d > 0, d > 1, width);
+		batch.setDeltas(d > 0, d > 1, width);
+		mfcc.setLogFloor(logFloor);
+		batch.setLogFloor(logFloor);
+
+		const size_t M = mfcc.getNumFeatures();
+		vector<float> features(numFrames * M), batchFeatures(numFrames * M);
+		start = steady_clock::now();
+		for (size_t f = 0; f < numFrames; f++) mfcc.process(&spectra[f * N], &features[f * M]);
+		const double us = 1e6 * duration<double>(steady_clock::now() - start).count() / numFrames;
+		batch.process(&spectra[0], numFrames, &batchFeatures[0]);
+
+		// output f is frame f - latency
+		double errors[3] = { 0, 0, 0 };
+		const long latency = static_cast<long>(mfcc.getLatency());
+		for (size_t f = 0; f < numFrames; f++) {
+			const long t = static_cast<long>(f) - latency;
+			const float *output = &features[f * M];
+			const vector<double> expected[3] = { padded[t - first], d > 0 ? deltaAt(t) : vector<double>(), d > 1 ? deltaDeltaAt(t) : vector<double>() };
+			for (int part = 0; part <= d; part++) {
+				const float *values = output + part * numCoefficients;
+				errors[part] = max(errors[part], relativeError(expected[part], vector<double>(values, values + numCoefficients)));
+			}
+		}
+		double batchError = 0;
+		for (size_t i = 0; i < features.size(); i++) batchError = max<double>(batchError, abs(batchFeatures[i] - features[i]));
+
+		cout << setw(20) << names[d] << setw(12) << us;
+		for (int part = 0; part < 3; part++) {
+			if (part <= d) cout << setw(14) << errors[part];
+			else cout << setw(14) << "";
+		}
+		cout << setw(14) << batchError << endl;
+
+		// float sums of float logs, relative to the largest value
+		if (*max_element(errors, errors + 3) > 1e-4 || batchError > 0) {
+			cout << names[d] << " differs from the reference" << endl;
+			passed = false;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
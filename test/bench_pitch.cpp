@@ -0,0 +1,89 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+#include <algorithm>
+
+#define USE_FFTW
+#include "whelpersg/pitch.h"
+#include "whelpersg/audio.h"
+
+// PitchDetector on a harmonic tone stepping through a scale with some noise, reporting
+// time spent per hop (mean and worst) next to the algorithmic latency, and accuracy
+// as the median error in cents over confident frames
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_pitch.cpp -lfftw3f
+
+using namespace std;
+using namespace std::chrono;
+
+const uint sampleRate = 44100;
+
+int main() {
+
+	mt19937 rng(0);
+	normal_distribution<float> noise(0, 0.02f);
+
+	// a new note every 250ms, MIDI 45 to 81, three harmonics
+	const size_t noteLength = sampleRate / 4;
+	vector<float> input;
+	vector<float> truth;
+	double phase = 0;
+	for (int note = 45; note <= 81; note+= 3) {
+		double frequency = audio::mtof(note);
+		for (size_t i = 0; i < noteLength; i++) {
+			phase+= 2.0 * PI * frequency / sampleRate;
+			input.push_back(0.5f * sin(phase) + 0.25f * sin(2 * phase) + 0.12f * sin(3 * phase) + noise(rng));
+			truth.push_back(frequency);
+		}
+	}
+	const double seconds = static_cast<double>(input.size()) / sampleRate;
+
+	cout << setw(8) << "method" << setw(8) << "frame" << setw(14) << "latency ms"
+	<< setw(14) << "us/hop" << setw(14) << "worst us" << setw(10) << "cpu %" << setw(12) << "cents" << endl;
+
+	for (auto method : { dsp::PitchSettings::Method::YIN, dsp::PitchSettings::Method::MCLEOD }) {
+		for (uint frameSize : { 1024, 2048 }) {
+
+			dsp::PitchSettings s;
+			s.method = method;
+			s.frameSize = frameSize;
+			s.hopSize = 256;
+			dsp::PitchDetector detector(s);
+
+			vector<double> errors;
+			double total = 0, worst = 0;
+			size_t hops = 0;
+
+			for (size_t i = 0; i + s.hopSize <= input.size(); i+= s.hopSize) {
+
+				auto start = steady_clock::now();
+				detector.process(&input[i], s.hopSize);
+				double elapsed = duration<double, micro>(steady_clock::now() - start).count();
+
+				total+= elapsed;
+				worst = max(worst, elapsed);
+				hops++;
+
+				// compare against the note at the centre of the frame, skipping frames over a note change
+				size_t end = i + s.hopSize;
+				if (end < frameSize) continue;
+				size_t first = end - frameSize;
+				if (truth[first] != truth[end - 1] || detector.getConfidence() < 0.8f) continue;
+				errors.push_back(abs(1200.0 * log2(detector.getFrequency() / truth[end - 1])));
+			}
+
+			sort(errors.begin(), errors.end());
+			double median = errors.empty() ? 0 : errors[errors.size() / 2];
+
+			cout << setw(8) << (method == dsp::PitchSettings::Method::YIN ? "yin" : "mcleod")
+			<< setw(8) << frameSize
+			<< setw(14) << 1000.0 * detector.getLatency() / sampleRate
+			<< setw(14) << total / hops
+			<< setw(14) << worst
+			<< setw(10) << 100.0 * total * 1e-6 / seconds
+			<< setw(12) << median << endl;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,202 @@
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include <string>
+#include <map>
+#include <limits>
+
+#include "whelpersg/profile.h"
+#include "whelpersg/timing.h"
+#include "whelpersg/json/json.hpp"
+
+// The cost of a profiling zone around a tiny bit of work against the same work bare, and
+// against a ScopedTimer printing (to nowhere) as it does now. Then zones recorded on several
+// threads at once, nested, with the background aggregator running, checking every event is
+// counted and the stats are in order. Last, traces: the last bit of a trace ring written as
+// Chrome trace_event JSON, checking old events have gone and zones nest on named threads
+// build with something like: g++ -std=c++14 -O3 -pthread -I../.. bench_profile.cpp
+//   (add -DUSE_TSC for time stamp counter timestamps)
+// usage: bench_profile [numZones=1000000] [numThreads=4]
+
+using namespace std;
+using namespace std::chrono;
+
+volatile float sink;
+
+/// a few ns of work so there's something to time
+inline void work(size_t i) {
+	float x = static_cast<float>(i);
+	for (int j = 0; j < 8; j++) x = x * 0.999f + 1.0f;
+	sink = x;
+}
+
+double nanosecondsPer(size_t N, steady_clock::time_point start) {
+	return 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+}
+
+void inner() {
+	WHG_PROFILE_ZONE("inner");
+	work(0);
+}
+
+void outer(size_t N) {
+	WHG_PROFILE_FUNCTION();
+	for (size_t i = 0; i < N; i++) inner();
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t numZones = argc > 1 ? stoul(argv[1]) : 1000000;
+	const size_t numThreads = argc > 2 ? stoul(argv[2]) : 4;
+	auto &profiler = whg::profile::Profiler::get();
+	bool passed = true;
+
+	auto start = steady_clock::now();
+	for (size_t i = 0; i < numZones; i++) work(i);
+	const double bareNs = nanosecondsPer(numZones, start);
+
+	// collecting as we go so nothing's dropped
+	const size_t batch = 10000;
+	double zoneSeconds = 0;
+	for (size_t b = 0; b < numZones; b+= batch) {
+		start = steady_clock::now();
+		for (size_t i = b; i < min(b + batch, numZones); i++) {
+			WHG_PROFILE_ZONE("work");
+			work(i);
+		}
+		zoneSeconds+= duration<double>(steady_clock::now() - start).count();
+		profiler.collect();
+	}
+	const double zoneNs = 1e9 * zoneSeconds / numZones;
+
+	const size_t numTimers = min<size_t>(numZones, 100000);
+	ostringstream nowhere;
+	auto buffer = cout.rdbuf(nowhere.rdbuf());
+	start = steady_clock::now();
+	for (size_t i = 0; i < numTimers; i++) {
+		whg::ScopedTimer timer("work");
+		work(i);
+	}
+	const double timerNs = nanosecondsPer(numTimers, start);
+	cout.rdbuf(buffer);
+
+#ifdef WHG_PROFILE_TSC
+	cout << "time stamp counter" << endl;
+#else
+	cout << "steady_clock" << endl;
+#endif
+	cout << setw(20) << "" << setw(12) << "ns each" << setw(16) << "ns overhead" << endl;
+	cout << setw(20) << "bare" << setw(12) << bareNs << setw(16) << "-" << endl;
+	cout << setw(20) << "zone" << setw(12) << zoneNs << setw(16) << zoneNs - bareNs << endl;
+	cout << setw(20) << "ScopedTimer" << setw(12) << timerNs << setw(16) << timerNs - bareNs << endl << endl;
+
+	auto stats = profiler.getStats();
+	if (stats.size() != 1 || stats[0].count != numZones || string(stats[0].zone->name) != "work") {
+		cout << "expected " << numZones << " events of one zone" << endl;
+		passed = false;
+	}
+	profiler.reset();
+
+	// threads recording nested zones while the aggregator runs
+	const size_t perThread = numZones / numThreads / 10;
+	profiler.start(milliseconds(5));
+	vector<thread> threads;
+	for (size_t t = 0; t < numThreads; t++) {
+		threads.emplace_back([perThread]() {
+			for (size_t i = 0; i < perThread; i+= 100) {
+				outer(100);
+				this_thread::yield();
+			}
+		});
+	}
+	for (auto &t : threads) t.join();
+	profiler.stop();
+	profiler.collect();
+
+	profiler.print();
+
+	const uint64_t dropped = profiler.getNumDropped();
+	uint64_t counted = 0;
+	for (const auto &s : profiler.getStats()) {
+		counted+= s.count;
+		if (!(s.min <= s.p50 * 1.07 && s.p50 <= s.p99 * 1.07 && s.p99 <= s.max * 1.07 && s.min <= s.mean && s.mean <= s.max)) {
+			cout << s.zone->name << " stats are out of order" << endl;
+			passed = false;
+		}
+	}
+	const uint64_t expected = numThreads * (perThread / 100) * 101;
+	if (counted + dropped != expected) {
+		cout << counted << " events counted and " << dropped << " dropped, expected " << expected << endl;
+		passed = false;
+	}
+
+	// a burst of old events, then nested zones on named threads, keeping 200ms
+	profiler.reset();
+	profiler.setTraceLength(0.2);
+	for (int i = 0; i < 1000; i++) {
+		WHG_PROFILE_ZONE("old");
+	}
+	profiler.collect();
+	this_thread::sleep_for(milliseconds(300));
+	threads.clear();
+	for (size_t t = 0; t < numThreads; t++) {
+		threads.emplace_back([t]() {
+			whg::profile::Profiler::setThreadName("worker " + to_string(t));
+			for (int i = 0; i < 10; i++) outer(100);
+		});
+	}
+	for (auto &t : threads) t.join();
+
+	const size_t numTraceEvents = profiler.getNumTraceEvents();
+	ostringstream trace;
+	start = steady_clock::now();
+	profiler.writeTrace(trace, 0.1);
+	const double traceMs = 1e3 * duration<double>(steady_clock::now() - start).count();
+	cout << endl << "wrote " << trace.str().size() / 1e3 << "kB of trace in " << traceMs << "ms" << endl;
+
+	try {
+		auto json = nlohmann::json::parse(trace.str());
+		map<int, string> names;
+		map<int, vector<nlohmann::json>> outers;
+		size_t numInner = 0, numOuter = 0, numNested = 0;
+		for (const auto &event : json["traceEvents"]) {
+			const string name = event["name"], phase = event["ph"];
+			const int tid = event["tid"];
+			if (phase == "M") names[tid] = event["args"]["name"].get<string>();
+			else if (name == "old") numOuter = numeric_limits<size_t>::max();
+			else if (name == "outer") {
+				numOuter++;
+				outers[tid].push_back(event);
+			}
+			else if (name == "inner") {
+				numInner++;
+				const double ts = event["ts"], end = ts + event["dur"].get<double>();
+				for (const auto &o : outers[tid]) {
+					const double oTs = o["ts"], oEnd = oTs + o["dur"].get<double>();
+					if (oTs <= ts && end <= oEnd + 1e-3 && event["args"]["depth"] == 1) {
+						numNested++;
+						break;
+					}
+				}
+			}
+		}
+		size_t numNamed = 0;
+		for (const auto &n : names) numNamed+= n.second.find("worker") == 0;
+
+		if (numOuter != numThreads * 10 || numInner != numThreads * 1000 || numNested != numInner || numNamed != numThreads) {
+			cout << "expected " << numThreads * 10 << " outer zones with " << numThreads * 1000 << " inner zones in them on "
+			<< numThreads << " named threads, got " << numOuter << " with " << numNested << " of " << numInner << " in them on "
+			<< numNamed << " (of " << numTraceEvents << " events kept)" << endl;
+			passed = false;
+		}
+	}
+	catch (const std::exception &e) {
+		cout << "couldn't read the trace back, " << e.what() << endl;
+		passed = false;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,194 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+
+#include "whelpersg/show.h"
+
+// A show of 100k segments over every curve, with gaps and jumps, split over a thousand tracks.
+// Times building it with EasingChain::extend() by name as the startup does now, then saving
+// and loading it as a binary show file, just opening the file, and as JSON. Checks both
+// loads give back exactly the same keyframes, and that broken files are turned down
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_show.cpp
+// usage: bench_show [numSegments=100000] [numTracks=1000]
+
+using namespace std;
+using namespace std::chrono;
+
+bool sameKeyframes(const whg::Show &a, const whg::Show &b) {
+	if (a.size() != b.size()) return false;
+	for (size_t t = 0; t < a.size(); t++) {
+		const auto &x = a.getTrack(t).getKeyframes(), &y = b.getTrack(t).getKeyframes();
+		if (a.getName(t) != b.getName(t) || x.size() != y.size()) return false;
+		for (size_t k = 0; k < x.size(); k++) {
+			if (x[k].time != y[k].time || x[k].value != y[k].value || x[k].curve != y[k].curve || x[k].duration != y[k].duration) {
+				return false;
+			}
+		}
+	}
+	return true;
+}
+
+double millisecondsSince(steady_clock::time_point start) {
+	return 1e3 * duration<double>(steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t numSegments = argc > 1 ? stoul(argv[1]) : 100000;
+	const size_t numTracks = argc > 2 ? stoul(argv[2]) : 1000;
+	const string binaryPath = "bench_show.whgs", jsonPath = "bench_show.json";
+
+	mt19937 random(1);
+	uniform_real_distribution<float> unit(0, 1);
+
+	// the cue list, as a show file would have it
+	struct Cue {
+		size_t track;
+		string curve;
+		float start, duration, from, to; // start < 0 to carry on from the last
+	};
+	vector<Cue> cues;
+	for (size_t i = 0; i < numSegments; i++) {
+		const size_t track = i * numTracks / numSegments;
+		string curve = whg::getEasingCurveName(static_cast<whg::EasingCurve>(random() % whg::numEasingCurves));
+		bool isFirst = i == 0 || cues.back().track != track;
+		float start = isFirst || random() % 8 == 0 ? (isFirst ? 0 : 1e9f) : -1;
+		cues.push_back({ track, curve, start, 0.01f + unit(random), unit(random), unit(random) });
+	}
+
+	// as the startup does now
+	auto start = steady_clock::now();
+	vector<whg::EasingChain<float>> chains(numTracks);
+	for (const auto &cue : cues) {
+		auto &chain = chains[cue.track];
+		if (cue.start < 0) {
+			chain.extend(cue.curve, cue.duration, cue.to);
+		}
+		else {
+			float time = cue.start == 0 ? 0 : chain.getEndTime() + 0.5f;
+			chain.add(cue.curve, time, time + cue.duration, cue.from, cue.to);
+		}
+	}
+	double chainMs = millisecondsSince(start);
+
+	whg::Show show;
+	{
+		vector<whg::KeyframeTrack<float>> tracks(numTracks);
+		for (const auto &cue : cues) {
+			whg::EasingCurve curve = whg::EasingCurve::LINEAR;
+			whg::easingCurveFromName(cue.curve, curve);
+			auto &track = tracks[cue.track];
+			if (cue.start < 0) {
+				track.extend(curve, cue.duration, cue.to);
+			}
+			else {
+				float time = cue.start == 0 ? 0 : track.getEndTime() + 0.5f;
+				track.add(curve, time, time + cue.duration, cue.from, cue.to);
+			}
+		}
+		for (size_t t = 0; t < numTracks; t++) show.add("channel " + to_string(t), move(tracks[t]));
+	}
+
+	start = steady_clock::now();
+	bool saved = show.save(binaryPath);
+	double saveMs = millisecondsSince(start);
+
+	whg::Show loaded;
+	start = steady_clock::now();
+	bool isLoaded = loaded.load(binaryPath);
+	double loadMs = millisecondsSince(start);
+
+	start = steady_clock::now();
+	whg::ShowReader reader(binaryPath);
+	double openMs = millisecondsSince(start);
+
+	start = steady_clock::now();
+	bool savedJson = show.saveJson(jsonPath);
+	double saveJsonMs = millisecondsSince(start);
+
+	whg::Show loadedJson;
+	start = steady_clock::now();
+	bool isLoadedJson = loadedJson.loadJson(jsonPath);
+	double loadJsonMs = millisecondsSince(start);
+
+	ifstream binaryFile(binaryPath, ios::binary | ios::ate), jsonFile(jsonPath, ios::ate);
+	const auto binarySize = binaryFile.tellg(), jsonSize = jsonFile.tellg();
+
+	size_t numKeyframes = 0;
+	for (size_t t = 0; t < show.size(); t++) numKeyframes+= show.getTrack(t).getKeyframes().size();
+
+	cout << numSegments << " segments in " << numTracks << " tracks, " << numKeyframes << " keyframes" << endl;
+	cout << setw(24) << "" << setw(12) << "ms" << setw(12) << "MB" << endl;
+	cout << setw(24) << "EasingChain::extend()" << setw(12) << chainMs << endl;
+	cout << setw(24) << "save" << setw(12) << saveMs << setw(12) << binarySize / 1e6 << endl;
+	cout << setw(24) << "load" << setw(12) << loadMs << endl;
+	cout << setw(24) << "open in place" << setw(12) << openMs << endl;
+	cout << setw(24) << "save json" << setw(12) << saveJsonMs << setw(12) << jsonSize / 1e6 << endl;
+	cout << setw(24) << "load json" << setw(12) << loadJsonMs << endl;
+
+	bool passed = true;
+	if (!saved || !isLoaded || !reader.isOpen() || !savedJson || !isLoadedJson) {
+		cout << "couldn't save or load the show" << endl;
+		passed = false;
+	}
+	if (!sameKeyframes(show, loaded) || !sameKeyframes(show, loadedJson)) {
+		cout << "loaded keyframes differ" << endl;
+		passed = false;
+	}
+	if (reader.size() != show.size() || reader.getName(1) != show.getName(1) ||
+		reader.getNumKeyframes(1) != show.getTrack(1).getKeyframes().size() ||
+		reader.getTrack(1).valueAt(1) != show.getTrack(1).valueAt(1)) {
+		cout << "the reader gives a different show" << endl;
+		passed = false;
+	}
+	reader.close();
+
+	// a truncated file, a wrong version, a curve that doesn't exist, a track whose keyframes
+	// wrap around past the end, and times going backwards or not a number
+	{
+		ifstream file(binaryPath, ios::binary);
+		string bytes((istreambuf_iterator<char>(file)), istreambuf_iterator<char>());
+		const size_t keyframesOffset = 32 + 24 * numTracks;
+		auto withBytes = [&](size_t offset, const void *value, size_t size) {
+			string output = bytes;
+			output.replace(offset, size, static_cast<const char*>(value), size);
+			return output;
+		};
+		const uint64_t wrapping = UINT64_MAX;
+		const float backwards = -1, notANumber = NAN;
+
+		string truncated = bytes.substr(0, bytes.size() - 1), versioned = bytes, curved = bytes;
+		versioned[4] = 2;
+		curved[keyframesOffset + 8] = static_cast<char>(whg::numEasingCurves);
+		const string wrapped = withBytes(32 + 24, &wrapping, 8);
+		const string reversed = withBytes(keyframesOffset + 16, &backwards, 4);
+		const string nanned = withBytes(keyframesOffset + 16, &notANumber, 4);
+
+		for (const string &broken : { truncated, versioned, curved, wrapped, reversed, nanned }) {
+			ofstream(binaryPath, ios::binary) << broken;
+			if (loaded.load(binaryPath) || !loaded.empty() || whg::ShowReader(binaryPath).isOpen()) {
+				cout << "loaded a broken show file" << endl;
+				passed = false;
+			}
+		}
+
+		auto json = show.toJson(), reversedJson = json, infiniteJson = json;
+		json["tracks"][0]["keyframes"][1]["curve"] = "WobbleEaser";
+		reversedJson["tracks"][0]["keyframes"][1]["time"] = -1;
+		infiniteJson["tracks"][0]["keyframes"][1]["time"] = 1e39; // inf as a float
+		if (loadedJson.fromJson(json) || loadedJson.fromJson({ { "tracks", 1 } }) ||
+			loadedJson.fromJson(reversedJson) || loadedJson.fromJson(infiniteJson)) {
+			cout << "loaded a broken json show" << endl;
+			passed = false;
+		}
+	}
+
+	std::remove(binaryPath.c_str());
+	std::remove(jsonPath.c_str());
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,137 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <cmath>
+
+#include "whelpersg/stats.h"
+
+// Latencies drawn from a long-tailed distribution recorded into a Histogram, an
+// AtomicHistogram and a ConcurrentHistogram, timing each record() against pushing onto a
+// vector to sort later. Checks percentiles against the sorted values, then records from
+// several threads at once while another keeps taking snapshots, checking every value is
+// counted and that the per-thread snapshots merge to the same thing
+// build with something like: g++ -std=c++14 -O3 -pthread -I../.. bench_stats.cpp
+// usage: bench_stats [numValues=10000000] [numThreads=4]
+
+using namespace std;
+using namespace std::chrono;
+
+double nanosecondsPer(size_t N, steady_clock::time_point start) {
+	return 1e9 * duration<double>(steady_clock::now() - start).count() / N;
+}
+
+int main(int argc, char *argv[]) {
+
+	const size_t numValues = argc > 1 ? stoul(argv[1]) : 10000000;
+	const size_t numThreads = argc > 2 ? stoul(argv[2]) : 4;
+	bool passed = true;
+
+	// mostly a few hundred us with a tail out to tens of ms, as callbacks go
+	mt19937 random(1);
+	lognormal_distribution<double> latency(log(300.0), 0.8);
+	vector<uint64_t> values(numValues);
+	for (auto &v : values) v = static_cast<uint64_t>(latency(random));
+
+	auto start = steady_clock::now();
+	vector<uint64_t> sorted;
+	sorted.reserve(numValues);
+	for (auto v : values) sorted.push_back(v);
+	const double vectorNs = nanosecondsPer(numValues, start);
+	sort(sorted.begin(), sorted.end());
+
+	whg::Histogram histogram;
+	start = steady_clock::now();
+	for (auto v : values) histogram.record(v);
+	const double histogramNs = nanosecondsPer(numValues, start);
+
+	whg::AtomicHistogram single;
+	start = steady_clock::now();
+	for (auto v : values) single.record(v);
+	const double atomicNs = nanosecondsPer(numValues, start);
+
+	whg::ConcurrentHistogram concurrent;
+	start = steady_clock::now();
+	for (auto v : values) concurrent.record(v);
+	const double concurrentNs = nanosecondsPer(numValues, start);
+
+	cout << setw(24) << "" << setw(16) << "ns per record" << endl;
+	cout << setw(24) << "vector push_back" << setw(16) << vectorNs << endl;
+	cout << setw(24) << "Histogram" << setw(16) << histogramNs << endl;
+	cout << setw(24) << "AtomicHistogram" << setw(16) << atomicNs << endl;
+	cout << setw(24) << "ConcurrentHistogram" << setw(16) << concurrentNs << endl << endl;
+
+	// within a bucket's width of the exact percentile
+	auto exact = [&](double q) {
+		return static_cast<double>(sorted[max<size_t>(static_cast<size_t>(ceil(q * numValues)), 1) - 1]);
+	};
+	cout << setw(12) << "" << setw(12) << "exact" << setw(12) << "Histogram" << endl;
+	const whg::Histogram snapshots[] = { histogram, single.getSnapshot(), concurrent.getSnapshot() };
+	const double quantiles[] = { 0.5, 0.99, 0.999, 1 };
+	const char *names[] = { "p50", "p99", "p99.9", "max" };
+	for (size_t i = 0; i < 4; i++) {
+		cout << setw(12) << names[i] << setw(12) << exact(quantiles[i]) << setw(12) << histogram.getQuantile(quantiles[i]) << endl;
+		for (const auto &h : snapshots) {
+			if (abs(h.getQuantile(quantiles[i]) - exact(quantiles[i])) > exact(quantiles[i]) / 60 + 0.5) {
+				cout << names[i] << " is " << h.getQuantile(quantiles[i]) << " instead of " << exact(quantiles[i]) << endl;
+				passed = false;
+			}
+		}
+	}
+	for (const auto &h : snapshots) {
+		if (h.getCount() != numValues || h.getMin() != sorted.front() || h.getMax() != sorted.back()) {
+			cout << "a snapshot has " << h.getCount() << " values from " << h.getMin() << " to " << h.getMax() << endl;
+			passed = false;
+		}
+	}
+
+	// threads recording while snapshots are taken
+	whg::ConcurrentHistogram shared;
+	vector<whg::Histogram> perThread(numThreads);
+	atomic<bool> isRecording(true);
+	size_t numSnapshots = 0, numBackwards = 0;
+	thread reader([&]() {
+		uint64_t last = 0;
+		while (isRecording) {
+			const uint64_t count = shared.getSnapshot().getCount();
+			if (count < last) numBackwards++;
+			last = count;
+			numSnapshots++;
+		}
+	});
+	vector<thread> threads;
+	for (size_t t = 0; t < numThreads; t++) {
+		threads.emplace_back([&, t]() {
+			for (size_t i = t; i < numValues; i+= numThreads) {
+				shared.record(values[i]);
+				perThread[t].record(values[i]);
+			}
+		});
+	}
+	for (auto &t : threads) t.join();
+	isRecording = false;
+	reader.join();
+
+	whg::Histogram merged;
+	for (const auto &h : perThread) merged.merge(h);
+	const whg::Histogram total = shared.getSnapshot();
+	cout << endl << numThreads << " threads recording, " << numSnapshots << " snapshots taken meanwhile" << endl;
+	if (total.getCount() != numValues || merged.getCount() != numValues || numBackwards) {
+		cout << total.getCount() << " values recorded and " << merged.getCount() << " merged of " << numValues
+		<< ", counts went backwards " << numBackwards << " times" << endl;
+		passed = false;
+	}
+	for (double q : quantiles) {
+		if (total.getQuantile(q) != merged.getQuantile(q) || total.getQuantile(q) != histogram.getQuantile(q)) {
+			cout << "merged quantile " << q << " differs" << endl;
+			passed = false;
+		}
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,56 @@
+#include <iostream>
+#include <iomanip>
+#include <random>
+#include <chrono>
+
+#define USE_FFTW
+#include "whelpersg/onset.h"
+
+// TempoEstimator on a synthetic onset strength signal (decaying pulses at 128 BPM plus noise)
+// at ~86 values per second, comparing an FFT every push, an FFT every 8 pushes and the
+// incremental autocorrelation. Reports the estimate and microseconds per push
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_tempo.cpp -lfftw3f
+
+using namespace std;
+using namespace std::chrono;
+
+int main() {
+
+	mt19937 rng(0);
+	uniform_real_distribution<float> noise(0, 0.2f);
+
+	const float sampleRate = 44100;
+	const size_t hopSize = 512;
+	const double onsetRate = sampleRate / hopSize;
+	const double bpm = 128;
+
+	// two minutes of onset strength
+	vector<float> onsets(static_cast<size_t>(onsetRate * 120));
+	const double period = onsetRate * 60.0 / bpm;
+	for (size_t i = 0; i < onsets.size(); i++) {
+		double phase = fmod(static_cast<double>(i), period);
+		onsets[i] = exp(-phase / 2.0) + noise(rng);
+	}
+
+	cout << setw(14) << "mode" << setw(10) << "bpm" << setw(14) << "us/push" << endl;
+
+	for (int mode = 0; mode < 3; mode++) {
+
+		whg::TempoEstimator<float> estimator;
+		estimator.setHopSize(hopSize);
+		estimator.setSampleRate(sampleRate);
+		if (mode == 1) estimator.setUpdateInterval(8);
+		if (mode == 2) estimator.setIncremental(true);
+
+		auto start = steady_clock::now();
+		for (float value : onsets) {
+			estimator.update(value);
+		}
+		double elapsed = duration<double, micro>(steady_clock::now() - start).count();
+
+		const char *names[] = { "fft", "fft / 8", "incremental" };
+		cout << setw(14) << names[mode] << setw(10) << estimator.getBpm() << setw(14) << elapsed / onsets.size() << endl;
+	}
+
+	return 0;
+}
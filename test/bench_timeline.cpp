@@ -0,0 +1,119 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <memory>
+
+#include "whelpersg/timeline.h"
+
+// A show of many short fades (single eases and little EasingChains over every curve) spread
+// over ten minutes, played at 60 fps by calling update() on every one of them as the app loop
+// does now, and by a Timeline. Checks every value matches each frame and that every fade
+// started and ended once, then prints the time per frame of both
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_timeline.cpp
+// usage: bench_timeline [numFades=100000] [numFrames=2000]
+
+using namespace std;
+using namespace std::chrono;
+
+int main(int argc, char *argv[]) {
+
+	const size_t numFades = argc > 1 ? stoul(argv[1]) : 100000;
+	const size_t numFrames = argc > 2 ? stoul(argv[2]) : 2000;
+	const float showLength = 600;
+	const float frameTime = 1.0f / 60;
+
+	mt19937 random(1);
+	uniform_real_distribution<float> unit(0, 1);
+
+	auto makeFade = [&]() -> whg::Easer<float>* {
+		float start = unit(random) * showLength;
+		float duration = 0.1f + 2 * unit(random);
+		whg::EasingCurve curve = static_cast<whg::EasingCurve>(random() % whg::numEasingCurves);
+
+		if (random() % 4) {
+			return whg::makeEaser<float>(curve, start, start + duration, unit(random), unit(random));
+		}
+		auto chain = new whg::EasingChain<float>();
+		chain->add(whg::makeEaser<float>(curve, start, start + duration, unit(random), unit(random)));
+		chain->extend("SineInOutEaser", duration, unit(random));
+		chain->extend("BounceOutEaser", duration, unit(random));
+		return chain;
+	};
+
+	// the same fades twice over
+	mt19937 seed = random;
+	vector<unique_ptr<whg::Easer<float>>> fades;
+	for (size_t i = 0; i < numFades; i++) fades.emplace_back(makeFade());
+
+	random = seed;
+	whg::Timeline<float> timeline;
+	size_t numStarted = 0, numEnded = 0, numOutOfOrder = 0;
+	vector<whg::Timeline<float>::Id> ids;
+	for (size_t i = 0; i < numFades; i++) {
+		ids.push_back(timeline.add(makeFade(),
+			[&](size_t) { numStarted++; },
+			[&](size_t id) {
+				numEnded++;
+				if (timeline.getState(id) != whg::Timeline<float>::State::FINISHED) numOutOfOrder++;
+			}));
+	}
+
+	// frames spread evenly over the show, each a 60 fps frame
+	const float stride = showLength / numFrames;
+	double allSeconds = 0, timelineSeconds = 0;
+	size_t mismatches = 0, maxPlaying = 0;
+
+	for (size_t f = 0; f <= numFrames; f++) {
+		const float time = f * stride + (f % 2) * frameTime;
+
+		auto start = steady_clock::now();
+		for (auto &fade : fades) fade->update(time);
+		allSeconds+= duration<double>(steady_clock::now() - start).count();
+
+		start = steady_clock::now();
+		timeline.update(time);
+		timelineSeconds+= duration<double>(steady_clock::now() - start).count();
+
+		maxPlaying = max(maxPlaying, timeline.getNumPlaying());
+		for (size_t i = 0; i < numFades; i++) {
+			if (timeline.getValue(ids[i]) != fades[i]->getValue() && mismatches++ < 5) {
+				cout << "fade " << i << " at " << time << " is " << timeline.getValue(ids[i])
+				<< " instead of " << fades[i]->getValue() << endl;
+			}
+		}
+	}
+
+	// anything not done by now gets its callbacks too
+	timeline.update(showLength * 2);
+	timeline.removeFinished();
+
+	cout << numFades << " fades, at most " << maxPlaying << " playing at once" << endl;
+	cout << setw(24) << "update all us/frame" << setw(24) << "timeline us/frame" << setw(10) << "speedup" << endl;
+	cout << setw(24) << 1e6 * allSeconds / (numFrames + 1) << setw(24) << 1e6 * timelineSeconds / (numFrames + 1)
+	<< setw(10) << allSeconds / timelineSeconds << endl;
+
+	bool passed = mismatches == 0;
+	if (numStarted != numFades || numEnded != numFades || numOutOfOrder) {
+		cout << numStarted << " starts and " << numEnded << " ends for " << numFades << " fades, "
+		<< numOutOfOrder << " ended while not finished" << endl;
+		passed = false;
+	}
+	if (timeline.size() != 0) {
+		cout << timeline.size() << " fades left after removing the finished ones" << endl;
+		passed = false;
+	}
+
+	// ids are reused after removal, and removing from a callback is fine
+	whg::Timeline<float> reuse;
+	auto first = reuse.add(new whg::LinearEaser<float>(1, 2, 0, 1), nullptr, [&](size_t id) { reuse.remove(id); });
+	reuse.update(3);
+	auto second = reuse.add(new whg::LinearEaser<float>(4, 5, 0, 1));
+	if (second != first || reuse.size() != 1 || reuse.getState(second) != whg::Timeline<float>::State::PENDING) {
+		cout << "removed ids aren't reused" << endl;
+		passed = false;
+	}
+
+	return passed ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cstdio>
+
+#include "whelpersg/wav.h"
+
+// Writes a stereo test tone in each WavFormat with WavWriter, checks WavReader gets it back
+// (interleaved, deinterleaved and in blocks) and times scanning the whole file, reported
+// as a multiple of realtime and MB/s
+// build with something like: g++ -std=c++14 -O3 -I../.. bench_wav.cpp
+// usage: bench_wav [minutes=10]
+
+using namespace std;
+using namespace std::chrono;
+
+const double pi = 3.14159265358979;
+
+int main(int argc, char *argv[]) {
+
+	const double minutes = argc > 1 ? stod(argv[1]) : 10;
+	const float sampleRate = 48000;
+	const size_t numChannels = 2;
+	const size_t numFrames = static_cast<size_t>(minutes * 60 * sampleRate);
+	const size_t blockSize = 4096;
+	const string path = "bench_wav_temp.wav";
+
+	cout << setw(10) << "format" << setw(10) << "MB" << setw(14) << "max error"
+	<< setw(14) << "x realtime" << setw(10) << "MB/s" << endl;
+
+	struct Format { whg::WavFormat format; const char *name; float tolerance; };
+
+	for (auto f : { Format { whg::WavFormat::PCM16, "pcm16", 0.5f / 32768 },
+					Format { whg::WavFormat::PCM24, "pcm24", 0.5f / 8388608 },
+					Format { whg::WavFormat::PCM32, "pcm32", 1e-6f },
+					Format { whg::WavFormat::FLOAT32, "float32", 0.0f } }) {
+
+		// left is a sine, right the same upside down
+		auto sample = [&](size_t i, size_t c) {
+			float v = 0.9f * sin(2.0 * pi * 441.0 * i / sampleRate);
+			return c == 0 ? v : -v;
+		};
+
+		{
+			whg::WavWriter writer(path, sampleRate, numChannels, f.format);
+			vector<float> block(blockSize * numChannels);
+			for (size_t i = 0; i < numFrames; i+= blockSize) {
+				size_t n = min(blockSize, numFrames - i);
+				for (size_t j = 0; j < n; j++) {
+					for (size_t c = 0; c < numChannels; c++) block[j * numChannels + c] = sample(i + j, c);
+				}
+				writer.write(&block[0], n);
+			}
+		}
+
+		whg::WavReader reader(path);
+		if (!reader.isOpen() || reader.getNumFrames() != numFrames || reader.getNumChannels() != numChannels) {
+			cout << f.name << ": couldn't read back" << endl;
+			return 1;
+		}
+
+		// correctness on the first block, interleaved and per channel
+		float maxError = 0;
+		vector<float> interleaved(blockSize * numChannels), left(blockSize), right(blockSize);
+		float *channels[] = { &left[0], &right[0] };
+		reader.read(0, blockSize, &interleaved[0]);
+		reader.read(0, blockSize, channels);
+		for (size_t i = 0; i < blockSize; i++) {
+			for (size_t c = 0; c < numChannels; c++) {
+				maxError = max(maxError, abs(interleaved[i * numChannels + c] - sample(i, c)));
+				maxError = max(maxError, abs(channels[c][i] - sample(i, c)));
+			}
+		}
+
+		// scan everything in blocks, deinterleaving
+		auto start = steady_clock::now();
+		double sum = 0;
+		for (auto block : reader.blocks(blockSize)) {
+			block.read(channels);
+			sum+= left[0];
+		}
+		double seconds = duration<double>(steady_clock::now() - start).count();
+
+		double megabytes = numFrames * numChannels * reader.getBytesPerSample() / 1e6;
+		cout << setw(10) << f.name << setw(10) << megabytes << setw(14) << maxError
+		<< setw(14) << reader.getDuration() / seconds << setw(10) << megabytes / seconds << endl;
+
+		if (maxError > f.tolerance * 1.01f || sum == 12345) {
+			cout << f.name << ": error over " << f.tolerance << endl;
+			return 1;
+		}
+	}
+
+	std::remove(path.c_str());
+	return 0;
+}
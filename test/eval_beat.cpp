@@ -0,0 +1,82 @@
+#include <iostream>
+#include <iomanip>
+
+#define USE_FFTW
+#include "whelpersg/onset.h"
+#include "whelpersg/evaluate.h"
+
+// TempoEstimator + BeatTracker on synthetic click tracks. Onset strength is the rectified
+// rise in log energy per hop. Beats are fired with latency compensation, the predicted time
+// of each is matched against the clicks within 70ms after a warm up, reporting the
+// F-measure, mean timing offset and the time spent per update
+// build with something like: g++ -std=c++14 -O3 -I../.. eval_beat.cpp -lfftw3f
+
+using namespace std;
+
+const float sampleRate = 44100;
+const size_t hopSize = 512;
+const double tolerance = 0.07;
+const double warmUp = 8.0;
+const double latencyCompensation = 0.05;
+
+int main() {
+
+	struct Case { const char *name; double bpm, endBpm, jitter; float noise; };
+	vector<Case> cases = {
+		{ "90", 90, 90, 0, 0.01f },
+		{ "120", 120, 120, 0, 0.01f },
+		{ "128 noisy", 128, 128, 0, 0.1f },
+		{ "140 jitter", 140, 140, 0.01, 0.01f },
+		{ "174", 174, 174, 0, 0.01f },
+		{ "ramp 120-128", 120, 128, 0, 0.01f },
+	};
+
+	cout << setw(14) << "case" << setw(10) << "bpm" << setw(10) << "F" << setw(14) << "offset ms"
+	<< setw(12) << "us/update" << setw(12) << "99% us" << endl;
+
+	for (const auto &c : cases) {
+
+		const double seconds = 60;
+		auto track = whg::clickTrack(sampleRate, seconds, c.bpm, c.endBpm, c.noise, c.jitter);
+
+		whg::TempoEstimator<float> tempo(256);
+		tempo.setHopSize(hopSize);
+		tempo.setSampleRate(sampleRate);
+		tempo.setIncremental(true);
+
+		whg::BeatTracker<float> tracker(hopSize, sampleRate);
+		tracker.setLatencyCompensation(latencyCompensation);
+
+		vector<double> fired;
+		whg::LatencyRecorder latency;
+		double lastEnergy = 0;
+
+		for (size_t i = 0; i + hopSize <= track.audio.size(); i+= hopSize) {
+
+			double energy = 0;
+			for (size_t n = 0; n < hopSize; n++) {
+				energy+= track.audio[i + n] * track.audio[i + n];
+			}
+			double logEnergy = log(energy / hopSize + 1e-10);
+			float strength = static_cast<float>(max(logEnergy - lastEnergy, 0.0));
+			lastEnergy = logEnergy;
+
+			latency.start();
+			float bpm = tempo.update(strength);
+			bool beat = tracker.update(strength, bpm);
+			latency.stop();
+
+			if (beat) {
+				fired.push_back(tracker.getNextBeatTime());
+			}
+		}
+
+		auto matches = whg::matchEvents(fired, track.onsets, tolerance, warmUp);
+
+		cout << setw(14) << c.name << setw(10) << tracker.getBpm() << setw(10) << matches.fMeasure()
+		<< setw(14) << 1000.0 * matches.meanOffset << setw(12) << latency.mean() / 1000.0
+		<< setw(12) << latency.percentile(99) / 1000.0 << endl;
+	}
+
+	return 0;
+}
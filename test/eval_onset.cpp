@@ -0,0 +1,154 @@
+#include <iostream>
+#include <iomanip>
+#include <string>
+
+#define USE_FFTW
+#include "whelpersg/onset.h"
+#include "whelpersg/evaluate.h"
+
+// Accuracy and cost of OnsetDetector, SpectralFluxOnsetDetector and TempoEstimator on
+// synthetic click tracks (steady, ramps, jitter, noise) or on a WAV file with onset
+// annotations, reporting the onset F-measure (50ms), mean offset, false positives per minute
+// (all of the detections on noise, which has no onsets), final tempo error, nanoseconds per
+// input sample and the median / 99th percentile time per update
+// build with something like: g++ -std=c++14 -O3 -I../.. eval_onset.cpp -lfftw3f
+// usage: eval_onset [audio.wav onsets.txt [bpm]]
+
+using namespace std;
+
+const size_t fftSize = 1024;
+const size_t hopSize = 512;
+const double tolerance = 0.05;
+const double warmUp = 2.0;
+
+void printHeader() {
+	cout << setw(18) << "signal" << setw(12) << "detector" << setw(8) << "F" << setw(12) << "offset ms"
+	<< setw(10) << "FP/min" << setw(12) << "tempo err" << setw(12) << "ns/sample" << setw(10) << "p50 ns" << setw(10) << "p99 ns" << endl;
+}
+
+void printRow(const string &name, const string &detector, const whg::TestSignal &signal,
+			  const whg::EventMatches *matches, double tempoError, whg::LatencyRecorder &latency) {
+
+	cout << setw(18) << name << setw(12) << detector;
+	if (matches && matches->annotations) {
+		cout << setw(8) << setprecision(3) << matches->fMeasure() << setw(12) << 1000.0 * matches->meanOffset;
+	}
+	else {
+		cout << setw(8) << "-" << setw(12) << "-";
+	}
+	if (matches) {
+		const double minutes = (signal.audio.size() / signal.sampleRate - warmUp) / 60;
+		cout << setw(10) << setprecision(3) << (matches->detections - matches->hits) / minutes;
+	}
+	else {
+		cout << setw(10) << "-";
+	}
+	if (tempoError >= 0) cout << setw(12) << tempoError;
+	else cout << setw(12) << "-";
+
+	cout << setw(12) << latency.total() / signal.audio.size()
+	<< setw(10) << latency.percentile(50) << setw(10) << latency.percentile(99) << endl;
+}
+
+void evaluate(const string &name, const whg::TestSignal &signal) {
+
+	const auto &audio = signal.audio;
+	const float sr = signal.sampleRate;
+	const double bpm = signal.endBpm;
+
+	// scalar detector on the peak level of each hop
+	{
+		whg::OnsetDetector<float> detector;
+		whg::LatencyRecorder latency;
+		vector<double> detections;
+
+		for (size_t i = 0; i + hopSize <= audio.size(); i+= hopSize) {
+			float peak = 0;
+			for (size_t n = 0; n < hopSize; n++) peak = max(peak, abs(audio[i + n]));
+
+			latency.start();
+			bool onset = detector.update(peak);
+			latency.stop();
+
+			if (onset) detections.push_back(i / sr);
+		}
+
+		auto matches = whg::matchEvents(detections, signal.onsets, tolerance, warmUp);
+		printRow(name, "level", signal, &matches, -1, latency);
+	}
+
+	// spectral flux, an onset in any band counts, timed from the start of the newest hop
+	{
+		dsp::RealFFT fft(fftSize);
+		fft.setWindow(dsp::window<float>::Type::HANN);
+		whg::SpectralFluxOnsetDetector detector(fftSize, sr);
+		whg::LatencyRecorder latency;
+		vector<double> detections;
+
+		for (size_t i = 0; i + fftSize <= audio.size(); i+= hopSize) {
+			latency.start();
+			fft.forward(&audio[i]);
+			bool onset = detector.process(fft.getOutput());
+			latency.stop();
+
+			if (onset) detections.push_back((i + fftSize - hopSize) / sr);
+		}
+
+		auto matches = whg::matchEvents(detections, signal.onsets, tolerance, warmUp);
+		printRow(name, "flux", signal, &matches, -1, latency);
+	}
+
+	// tempo from the rise in log energy per hop
+	if (bpm > 0) {
+		whg::TempoEstimator<float> estimator(256);
+		estimator.setHopSize(hopSize);
+		estimator.setSampleRate(sr);
+		estimator.setIncremental(true);
+		whg::LatencyRecorder latency;
+
+		double lastEnergy = 0;
+		for (size_t i = 0; i + hopSize <= audio.size(); i+= hopSize) {
+			double energy = 0;
+			for (size_t n = 0; n < hopSize; n++) energy+= audio[i + n] * audio[i + n];
+			double logEnergy = log(energy / hopSize + 1e-10);
+
+			latency.start();
+			estimator.update(static_cast<float>(max(logEnergy - lastEnergy, 0.0)));
+			latency.stop();
+
+			lastEnergy = logEnergy;
+		}
+
+		printRow(name, "tempo", signal, nullptr, whg::tempoError(estimator.getBpm(), bpm), latency);
+	}
+}
+
+int main(int argc, char *argv[]) {
+
+	printHeader();
+
+	if (argc >= 3) {
+		whg::TestSignal signal;
+		if (!whg::loadWav(argv[1], signal.audio, signal.sampleRate)) {
+			cerr << "couldn't read " << argv[1] << endl;
+			return 1;
+		}
+		signal.onsets = whg::loadAnnotations(argv[2]);
+		signal.bpm = signal.endBpm = argc >= 4 ? stod(argv[3]) : 0;
+		evaluate(argv[1], signal);
+		return 0;
+	}
+
+	const float sr = 44100;
+	const double seconds = 30;
+
+	evaluate("clicks 90", whg::clickTrack(sr, seconds, 90, 90));
+	evaluate("clicks 120", whg::clickTrack(sr, seconds, 120, 120));
+	evaluate("clicks 174", whg::clickTrack(sr, seconds, 174, 174));
+	evaluate("ramp 110-130", whg::clickTrack(sr, seconds, 110, 130));
+	evaluate("jitter 128", whg::clickTrack(sr, seconds, 128, 128, 0.01f, 0.01));
+	evaluate("noisy 128", whg::clickTrack(sr, seconds, 128, 128, 0.15f));
+	evaluate("noise", whg::noiseSignal(sr, seconds));
+
+	return 0;
+}
@@ -0,0 +1,237 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <functional>
+#include <algorithm>
+#include <limits>
+
+#include "whelpersg/easing.h"
+
+namespace whg {
+
+/// Plays many easers (single eases, EasingChains, KeyframeTracks) against one clock, only
+/// evaluating the ones playing. Waiting easers sit in a heap by start time and playing ones in
+/// a heap by end time, so update() costs O(playing) plus O(log n) for each easer starting or
+/// ending, however many are waiting or done.
+/// A finished easer is freed and keeps its last value until remove() or removeFinished(), after
+/// which its id goes to the next one added. update() times shouldn't go backwards (finished
+/// easers aren't restarted) and easers shouldn't change their start or end once added.
+template <typename T>
+class Timeline {
+public:
+
+	typedef size_t Id;
+	typedef std::function<void(Id)> Callback;
+
+	enum class State : uint8_t { PENDING, PLAYING, FINISHED, REMOVED };
+
+	Timeline(): mTime(-std::numeric_limits<float>::infinity()), mNumPending(0) {}
+
+	/// takes ownership of easer. onStart is called by the first update() at or after its start
+	/// time, onEnd by the first one after its end time, both once update() has set every value
+	Id add(Easer<T> *easer, Callback onStart=nullptr, Callback onEnd=nullptr) {
+
+		Id id;
+		if (mFreeIds.empty()) {
+			id = mAnimations.size();
+			mAnimations.emplace_back();
+		}
+		else {
+			id = mFreeIds.back();
+			mFreeIds.pop_back();
+		}
+
+		Animation &animation = mAnimations[id];
+		animation.easer.reset(easer);
+		animation.value = easer->valueAt(easer->getStartTime());
+		animation.state = State::PENDING;
+		animation.onStart = std::move(onStart);
+		animation.onEnd = std::move(onEnd);
+
+		push(mPending, { easer->getStartTime(), id, animation.generation });
+		mNumPending++;
+		return id;
+	}
+
+	/// a copy of track
+	Id add(const KeyframeTrack<T> &track, Callback onStart=nullptr, Callback onEnd=nullptr) {
+		return add(new TrackEaser(track), std::move(onStart), std::move(onEnd));
+	}
+
+	/// stops id without calling its callbacks, the id can be reused from now on
+	void remove(Id id) {
+		Animation &animation = mAnimations[id];
+		if (animation.state == State::REMOVED) return;
+
+		if (animation.state == State::PENDING) mNumPending--;
+		if (animation.state == State::PLAYING) unlist(id);
+
+		// the heaps and events still holding id skip it, its generation won't match
+		animation.generation++;
+		animation.state = State::REMOVED;
+		animation.easer.reset();
+		animation.onStart = nullptr;
+		animation.onEnd = nullptr;
+		mFreeIds.push_back(id);
+	}
+
+	/// removes everything that's finished
+	void removeFinished() {
+		for (const auto &entry : mFinished) {
+			const Animation &animation = mAnimations[entry.id];
+			if (animation.generation == entry.generation && animation.state == State::FINISHED) {
+				remove(entry.id);
+			}
+		}
+		mFinished.clear();
+	}
+
+	void update(float time) {
+
+		mTime = time;
+
+		while (!mPending.empty() && mPending.front().time <= time) {
+			const Entry entry = pop(mPending);
+			Animation &animation = mAnimations[entry.id];
+			if (animation.generation != entry.generation || animation.state != State::PENDING) continue;
+
+			mNumPending--;
+			animation.state = State::PLAYING;
+			animation.playingIndex = mPlaying.size();
+			mPlaying.push_back(entry.id);
+			push(mEnding, { animation.easer->getEndTime(), entry.id, entry.generation });
+			if (animation.onStart) mEvents.push_back({ entry.id, entry.generation, false });
+		}
+
+		for (Id id : mPlaying) {
+			Animation &animation = mAnimations[id];
+			animation.value = animation.easer->update(time);
+		}
+
+		while (!mEnding.empty() && mEnding.front().time < time) {
+			const Entry entry = pop(mEnding);
+			Animation &animation = mAnimations[entry.id];
+			if (animation.generation != entry.generation || animation.state != State::PLAYING) continue;
+
+			animation.state = State::FINISHED;
+			animation.easer.reset();
+			unlist(entry.id);
+			mFinished.push_back(entry);
+			if (animation.onEnd) mEvents.push_back({ entry.id, entry.generation, true });
+		}
+
+		// last, so callbacks can add and remove as they like
+		for (size_t i = 0; i < mEvents.size(); i++) {
+			const Event event = mEvents[i];
+			Animation &animation = mAnimations[event.id];
+			if (animation.generation != event.generation) continue;
+			// moved out, the callback could remove its own animation
+			Callback callback = std::move(event.isEnd ? animation.onEnd : animation.onStart);
+			if (callback) callback(event.id);
+		}
+		mEvents.clear();
+	}
+
+	/// the value of id at the last update(), its start value before it starts
+	T getValue(Id id) const { return mAnimations[id].value; }
+
+	State getState(Id id) const { return mAnimations[id].state; }
+
+	/// nullptr once finished
+	Easer<T>* getEaser(Id id) const { return mAnimations[id].easer.get(); }
+
+	float getTime() const { return mTime; }
+
+	size_t getNumPending() const { return mNumPending; }
+	size_t getNumPlaying() const { return mPlaying.size(); }
+
+	/// the playing ids, in no particular order
+	const std::vector<Id>& getPlaying() const { return mPlaying; }
+
+	/// number of ids in use, pending, playing or finished
+	size_t size() const { return mAnimations.size() - mFreeIds.size(); }
+
+	void clear() {
+		mAnimations.clear();
+		mFreeIds.clear();
+		mPending.clear();
+		mEnding.clear();
+		mPlaying.clear();
+		mFinished.clear();
+		mEvents.clear();
+		mNumPending = 0;
+	}
+
+protected:
+
+	struct Animation {
+		std::unique_ptr<Easer<T>> easer;
+		T value;
+		State state = State::REMOVED;
+		uint32_t generation = 0; // changes on remove() so stale heap entries can be skipped
+		size_t playingIndex = 0;
+		Callback onStart, onEnd;
+	};
+
+	struct Entry {
+		float time;
+		Id id;
+		uint32_t generation;
+
+		/// for a min heap
+		bool operator<(const Entry &other) const { return time > other.time; }
+	};
+
+	struct Event {
+		Id id;
+		uint32_t generation;
+		bool isEnd;
+	};
+
+	/// a KeyframeTrack as an Easer
+	class TrackEaser : public Easer<T> {
+	public:
+		TrackEaser(const KeyframeTrack<T> &track):
+		Easer<T>(track.getStartTime(), track.getEndTime(), track.valueAt(track.getStartTime()), track.valueAt(track.getEndTime())),
+		mTrack(track) {}
+
+		T valueAt(float time) const override { return mTrack.valueAt(time); }
+		T update(float time) override { return this->mCurrentValue = mTrack.update(time); }
+
+	protected:
+		KeyframeTrack<T> mTrack;
+	};
+
+	std::vector<Animation> mAnimations; // by id
+	std::vector<Id> mFreeIds;
+	std::vector<Entry> mPending, mEnding; // heaps by start and end time
+	std::vector<Id> mPlaying;
+	std::vector<Entry> mFinished;
+	std::vector<Event> mEvents;
+	float mTime;
+	size_t mNumPending;
+
+	static void push(std::vector<Entry> &heap, Entry entry) {
+		heap.push_back(entry);
+		std::push_heap(heap.begin(), heap.end());
+	}
+
+	static Entry pop(std::vector<Entry> &heap) {
+		std::pop_heap(heap.begin(), heap.end());
+		Entry entry = heap.back();
+		heap.pop_back();
+		return entry;
+	}
+
+	/// out of mPlaying, the last playing id takes its place
+	void unlist(Id id) {
+		const size_t i = mAnimations[id].playingIndex;
+		mPlaying[i] = mPlaying.back();
+		mAnimations[mPlaying[i]].playingIndex = i;
+		mPlaying.pop_back();
+	}
+};
+
+} // namespace whg
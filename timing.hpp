@@ -1,19 +1,24 @@
+#pragma once
+
 #include <chrono>
+#include <string>
+#include <iostream>
 
 namespace whg {
 
 template<class T>
 struct _Timer {
 	// we're using time_points and durations because VS can't do arithmetic on durations
-    std::chrono::time_point<std::chrono::system_clock> startTime;
+	// steady_clock so the system clock being set can't make timings jump or go negative
+	std::chrono::time_point<std::chrono::steady_clock> startTime;
 	T timeTaken;
 
 	void start() {
-		startTime = std::chrono::system_clock::now();
+		startTime = std::chrono::steady_clock::now();
 	}
 
 	void end() {
-		timeTaken = std::chrono::duration_cast<T>(std::chrono::system_clock::now() - startTime);
+		timeTaken = std::chrono::duration_cast<T>(std::chrono::steady_clock::now() - startTime);
 	}
 };
 
@@ -21,6 +26,14 @@ using Timer = _Timer<std::chrono::seconds>;
 using SecondsTimer = _Timer<std::chrono::seconds>;
 using MillisTimer = _Timer<std::chrono::milliseconds>;
 
+/// the unit a duration is counted in, for printing
+template<class T> inline const char *getDurationUnit() { return "ticks"; }
+template<> inline const char *getDurationUnit<std::chrono::seconds>() { return "s"; }
+template<> inline const char *getDurationUnit<std::chrono::milliseconds>() { return "ms"; }
+template<> inline const char *getDurationUnit<std::chrono::microseconds>() { return "us"; }
+template<> inline const char *getDurationUnit<std::chrono::nanoseconds>() { return "ns"; }
+
+/// for timing a whole scope once; to time something small or often use WHG_PROFILE_ZONE from profile.hpp
 template<class T>
 struct _ScopedTimer : public T {
 	std::string name;
@@ -32,7 +45,7 @@ struct _ScopedTimer : public T {
 
 	~_ScopedTimer() {
 		T::end();
-		std::cout << name << " took " << T::timeTaken.count() << "ms" << std::endl;
+		std::cout << name << " took " << T::timeTaken.count() << getDurationUnit<decltype(T::timeTaken)>() << std::endl;
 	}
 };
 
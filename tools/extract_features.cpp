@@ -0,0 +1,291 @@
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+
+#define USE_FFTW
+#include "whelpersg/dsp.h"
+#include "whelpersg/onset.h"
+#include "whelpersg/wav.h"
+#include "whelpersg/parallel.h"
+
+// Onset, tempo, mel and chroma features for a whole WAV file, one row per hop.
+// The file is split into chunks that are processed in parallel, each chunk starts
+// --warmup seconds early so the running state (thresholds, tempo) has settled by the
+// time its own frames start, those early frames are thrown away. Settled isn't the same:
+// the adaptive onset thresholds and the tempo only converge towards what a single pass
+// would have, so flux, onsets and bpm near the start of each chunk can differ a little
+// (the rest is per frame and matches). --check runs a single pass too and reports how much.
+//
+// Output is CSV, or if the output name ends in .bin, columns of float32:
+//   "WHGF", uint32 version (1), uint32 numColumns, uint64 numRows,
+//   float32 sampleRate, uint32 hopSize,
+//   numColumns x (uint16 length, name),
+//   numColumns x numRows float32, one column after another
+//
+// build with something like: g++ -std=c++14 -O3 -pthread -I../.. extract_features.cpp -lfftw3f
+// usage: extract_features input.wav output.(csv|bin) [--threads n] [--fft 2048] [--hop 512]
+//                         [--chunk 30] [--warmup 8] [--check]
+
+using namespace std;
+using namespace std::chrono;
+
+struct Options {
+	string input, output;
+	size_t threads = 0;
+	size_t fftSize = 2048;
+	size_t hopSize = 512;
+	double chunkSeconds = 30;
+	double warmUpSeconds = 8;
+	bool check = false;
+};
+
+const uint numMelBands = 40;
+const uint numChromas = 12;
+
+vector<string> columnNames(size_t numFluxBands) {
+	vector<string> names = { "time", "rms" };
+	for (size_t b = 0; b < numFluxBands; b++) names.push_back("flux_" + to_string(b));
+	for (size_t b = 0; b < numFluxBands; b++) names.push_back("onset_" + to_string(b));
+	names.push_back("bpm");
+	for (uint b = 0; b < numMelBands; b++) names.push_back("mel_" + to_string(b));
+	for (uint c = 0; c < numChromas; c++) names.push_back("chroma_" + to_string(c));
+	return names;
+}
+
+/// everything one chunk needs, filterbanks are cheap enough to build per chunk
+class Extractor {
+public:
+
+	Extractor(const Options &options, float sampleRate):
+	mOptions(options), mSampleRate(sampleRate), mFFT(options.fftSize), mFlux(options.fftSize, sampleRate) {
+
+		mFFT.setWindow(dsp::window<float>::Type::HANN);
+
+		mTempo.setHopSize(options.hopSize);
+		mTempo.setSampleRate(sampleRate);
+		mTempo.setIncremental(true);
+
+		dsp::MelFilterSettings mel;
+		mel.minFrequency = 30;
+		mel.maxFrequency = std::min(16000.0, sampleRate / 2.0);
+		mel.numBands = numMelBands;
+		mel.sampleRate = static_cast<uint>(sampleRate);
+		mel.setSize(static_cast<uint>(options.fftSize));
+		mMel = dsp::SparseFilterbank<float>(dsp::melFilterbank<float>(mel));
+
+		dsp::ChromaFilterSettings chroma;
+		chroma.sampleRate = static_cast<uint>(sampleRate);
+		chroma.setSize(static_cast<uint>(options.fftSize));
+		chroma.numChromas = numChromas;
+		mChroma = dsp::SparseFilterbank<float>(dsp::chromaFilterbank<float>(chroma), 1e-4f);
+
+		mFrame.resize(options.fftSize);
+		mMagnitudes.resize(options.fftSize / 2 + 1);
+		mRow.resize(columnNames(mFlux.getNumBands()).size());
+	}
+
+	/// frames [first, last) go to columns, processing starts at warmUp
+	void run(const whg::WavReader &reader, size_t warmUp, size_t first, size_t last, vector<vector<float>> &columns) {
+
+		const size_t hop = mOptions.hopSize;
+
+		for (size_t frame = warmUp; frame < last; frame++) {
+
+			reader.readMono(frame * hop, mOptions.fftSize, &mFrame[0]);
+			process(frame);
+
+			if (frame >= first) {
+				for (size_t c = 0; c < columns.size(); c++) {
+					columns[c][frame] = mRow[c];
+				}
+			}
+		}
+	}
+
+protected:
+	const Options &mOptions;
+	float mSampleRate;
+
+	dsp::RealFFT mFFT;
+	whg::SpectralFluxOnsetDetector mFlux;
+	whg::TempoEstimator<float> mTempo;
+	dsp::SparseFilterbank<float> mMel, mChroma;
+
+	vector<float> mFrame, mMagnitudes, mRow;
+
+	void process(size_t frame) {
+
+		float energy = 0;
+		for (float v : mFrame) energy+= v * v;
+
+		mFFT.forward(&mFrame[0]);
+		const auto &spectrum = mFFT.getOutput();
+		for (size_t k = 0; k < mMagnitudes.size(); k++) {
+			mMagnitudes[k] = abs(spectrum[k]);
+		}
+
+		mFlux.process(&mMagnitudes[0]);
+
+		float strength = 0;
+		for (size_t b = 0; b < mFlux.getNumBands(); b++) strength+= mFlux.getFlux(b);
+		float bpm = mTempo.update(strength);
+
+		float *row = &mRow[0];
+		*row++ = static_cast<float>((frame * mOptions.hopSize + mOptions.fftSize / 2) / mSampleRate);
+		*row++ = sqrt(energy / mFrame.size());
+		for (size_t b = 0; b < mFlux.getNumBands(); b++) *row++ = mFlux.getFlux(b);
+		for (size_t b = 0; b < mFlux.getNumBands(); b++) *row++ = mFlux.isOnset(b) ? 1.0f : 0.0f;
+		*row++ = bpm;
+
+		mMel.apply(&mMagnitudes[0], row);
+		whg::simd::log(row, row, numMelBands, 1e-6f);
+		row+= numMelBands;
+
+		mChroma.apply(&mMagnitudes[0], row);
+		float total = 1e-9f;
+		for (uint c = 0; c < numChromas; c++) total+= row[c];
+		for (uint c = 0; c < numChromas; c++) row[c]/= total;
+	}
+};
+
+bool writeCSV(const string &path, const vector<string> &names, const vector<vector<float>> &columns) {
+
+	ofstream file(path);
+	if (!file) return false;
+
+	for (size_t c = 0; c < names.size(); c++) file << names[c] << (c + 1 < names.size() ? "," : "\n");
+
+	const size_t numRows = columns.empty() ? 0 : columns[0].size();
+	for (size_t r = 0; r < numRows; r++) {
+		for (size_t c = 0; c < columns.size(); c++) {
+			file << columns[c][r] << (c + 1 < columns.size() ? "," : "\n");
+		}
+	}
+	return static_cast<bool>(file);
+}
+
+template <typename T>
+void writeValue(ofstream &file, T value) {
+	file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+bool writeBinary(const string &path, const vector<string> &names, const vector<vector<float>> &columns,
+				 float sampleRate, uint32_t hopSize) {
+
+	ofstream file(path, ios::binary);
+	if (!file) return false;
+
+	file.write("WHGF", 4);
+	writeValue<uint32_t>(file, 1);
+	writeValue<uint32_t>(file, static_cast<uint32_t>(columns.size()));
+	writeValue<uint64_t>(file, columns.empty() ? 0 : columns[0].size());
+	writeValue<float>(file, sampleRate);
+	writeValue<uint32_t>(file, hopSize);
+
+	for (const auto &name : names) {
+		writeValue<uint16_t>(file, static_cast<uint16_t>(name.size()));
+		file.write(name.data(), name.size());
+	}
+	for (const auto &column : columns) {
+		file.write(reinterpret_cast<const char*>(column.data()), column.size() * sizeof(float));
+	}
+	return static_cast<bool>(file);
+}
+
+int main(int argc, char *argv[]) {
+
+	Options options;
+	vector<string> positional;
+
+	for (int i = 1; i < argc; i++) {
+		string arg = argv[i];
+		bool hasValue = i + 1 < argc;
+		if (arg == "--threads" && hasValue) options.threads = stoul(argv[++i]);
+		else if (arg == "--fft" && hasValue) options.fftSize = stoul(argv[++i]);
+		else if (arg == "--hop" && hasValue) options.hopSize = stoul(argv[++i]);
+		else if (arg == "--chunk" && hasValue) options.chunkSeconds = stod(argv[++i]);
+		else if (arg == "--warmup" && hasValue) options.warmUpSeconds = stod(argv[++i]);
+		else if (arg == "--check") options.check = true;
+		else positional.push_back(arg);
+	}
+
+	if (positional.size() != 2) {
+		cerr << "usage: " << argv[0] << " input.wav output.(csv|bin) [--threads n] [--fft 2048] [--hop 512]"
+		<< " [--chunk 30] [--warmup 8] [--check]" << endl;
+		return 1;
+	}
+	options.input = positional[0];
+	options.output = positional[1];
+
+	auto start = steady_clock::now();
+
+	whg::WavReader reader(options.input);
+	if (!reader.isOpen()) {
+		cerr << "couldn't read " << options.input << endl;
+		return 1;
+	}
+
+	const float sampleRate = reader.getSampleRate();
+	const size_t hop = options.hopSize;
+	const size_t numFrames = reader.getNumFrames() >= options.fftSize ? (reader.getNumFrames() - options.fftSize) / hop + 1 : 0;
+	const size_t chunkFrames = max<size_t>(1, static_cast<size_t>(options.chunkSeconds * sampleRate / hop));
+	const size_t warmUpFrames = static_cast<size_t>(options.warmUpSeconds * sampleRate / hop);
+	const size_t numChunks = (numFrames + chunkFrames - 1) / chunkFrames;
+
+	const auto names = columnNames(whg::SpectralFluxOnsetDetector(options.fftSize, sampleRate).getNumBands());
+	vector<vector<float>> columns(names.size(), vector<float>(numFrames));
+
+	whg::ThreadPool pool(options.threads);
+
+	whg::parallelFor(pool, 0, numChunks, [&](size_t chunk) {
+		size_t first = chunk * chunkFrames;
+		size_t last = min(first + chunkFrames, numFrames);
+		size_t warmUp = first > warmUpFrames ? first - warmUpFrames : 0;
+
+		Extractor extractor(options, sampleRate);
+		extractor.run(reader, warmUp, first, last, columns);
+	});
+
+	double seconds = duration<double>(steady_clock::now() - start).count();
+
+	bool binary = options.output.size() > 4 && options.output.compare(options.output.size() - 4, 4, ".bin") == 0;
+	bool written = binary ? writeBinary(options.output, names, columns, sampleRate, static_cast<uint32_t>(hop))
+	: writeCSV(options.output, names, columns);
+
+	if (!written) {
+		cerr << "couldn't write " << options.output << endl;
+		return 1;
+	}
+
+	cout << options.input << ": " << reader.getDuration() << "s, " << numFrames << " frames x " << names.size()
+	<< " features in " << numChunks << " chunks on " << pool.size() << " threads" << endl;
+	cout << "extracted in " << seconds << "s, " << reader.getDuration() / seconds << "x realtime" << endl;
+
+	if (options.check) {
+		vector<vector<float>> single(names.size(), vector<float>(numFrames));
+		Extractor(options, sampleRate).run(reader, 0, 0, numFrames, single);
+
+		cout << "against a single pass, columns that differ:" << endl;
+		size_t numDiffering = 0;
+		for (size_t c = 0; c < names.size(); c++) {
+			size_t numFramesDiffering = 0;
+			float maxDifference = 0;
+			for (size_t f = 0; f < numFrames; f++) {
+				const float difference = abs(columns[c][f] - single[c][f]);
+				numFramesDiffering+= difference > 0;
+				maxDifference = max(maxDifference, difference);
+			}
+			if (numFramesDiffering) {
+				cout << setw(16) << names[c] << setw(10) << numFramesDiffering << " frames, at most " << maxDifference << endl;
+				numDiffering++;
+			}
+		}
+		if (!numDiffering) cout << setw(16) << "none" << endl;
+	}
+
+	return 0;
+}
@@ -4,9 +4,28 @@
 #include <string>
 #include <sstream>
 #include <iterator>
+#include <type_traits>
 
 namespace whg {
 
+/// 0, 1, ... N - 1 as a pack, made in log(N) steps so big tables don't hit the template depth limit
+template <size_t... I>
+struct Indices {
+	typedef Indices<I..., (sizeof...(I) + I)...> Doubled;
+	typedef Indices<I..., (sizeof...(I) + I)..., 2 * sizeof...(I)> DoubledPlusOne;
+};
+
+template <size_t N>
+struct MakeIndices {
+	typedef typename std::conditional<N % 2, typename MakeIndices<N / 2>::Type::DoubledPlusOne,
+		typename MakeIndices<N / 2>::Type::Doubled>::type Type;
+};
+
+template <>
+struct MakeIndices<0> {
+	typedef Indices<> Type;
+};
+
 template<class T>
 size_t argmax(const T &iterable) {
 	size_t output = 0;
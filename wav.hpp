@@ -0,0 +1,491 @@
+#pragma once
+
+#include "whelpersg/simd.h"
+
+#include <string>
+#include <vector>
+#include <fstream>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+
+#ifdef _WIN32
+#include <iterator>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace whg {
+
+enum class WavFormat { PCM16, PCM24, PCM32, FLOAT32 };
+
+
+/// Reads 16, 24 and 32 bit integer or 32 bit float WAV files of any channel count.
+/// The file is memory mapped so opening is instant and only the parts that are read
+/// get paged in, samples are converted to float (SIMD for 16 and 32 bit) as they're read.
+/// Reading is const and doesn't keep any state, so one reader can be shared between threads.
+class WavReader {
+public:
+
+	/// a range of frames, still in the file's own format until it's read
+	struct Block {
+		const WavReader *reader;
+		size_t frame, numFrames;
+
+		const uint8_t* data() const { return reader->getFrame(frame); }
+		void read(float *interleaved) const { reader->read(frame, numFrames, interleaved); }
+		void read(float *const *channels) const { reader->read(frame, numFrames, channels); }
+		void readMono(float *output) const { reader->readMono(frame, numFrames, output); }
+	};
+
+	class BlockIterator {
+	public:
+		BlockIterator(const WavReader *reader, size_t frame, size_t blockSize, size_t hopSize):
+		mReader(reader), mFrame(frame), mBlockSize(blockSize), mHopSize(hopSize) {}
+
+		Block operator*() const {
+			return { mReader, mFrame, std::min(mBlockSize, mReader->getNumFrames() - mFrame) };
+		}
+
+		BlockIterator& operator++() {
+			mFrame = std::min(mFrame + mHopSize, mReader->getNumFrames());
+			return *this;
+		}
+
+		bool operator!=(const BlockIterator &other) const { return mFrame != other.mFrame; }
+		bool operator==(const BlockIterator &other) const { return mFrame == other.mFrame; }
+
+	protected:
+		const WavReader *mReader;
+		size_t mFrame, mBlockSize, mHopSize;
+	};
+
+	struct BlockRange {
+		BlockIterator first, last;
+		BlockIterator begin() const { return first; }
+		BlockIterator end() const { return last; }
+	};
+
+	WavReader(): mMapped(nullptr), mMappedSize(0), mData(nullptr) {
+		clearFormat();
+	}
+
+	WavReader(const std::string &path): WavReader() {
+		open(path);
+	}
+
+	~WavReader() {
+		close();
+	}
+
+	WavReader(const WavReader&) = delete;
+	WavReader& operator=(const WavReader&) = delete;
+
+	bool open(const std::string &path) {
+
+		close();
+
+#ifdef _WIN32
+		std::ifstream file(path, std::ios::binary);
+		if (!file) return false;
+		mBuffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+		const uint8_t *bytes = reinterpret_cast<const uint8_t*>(mBuffer.data());
+		size_t size = mBuffer.size();
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) return false;
+
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size < 12) {
+			::close(fd);
+			return false;
+		}
+
+		mMappedSize = static_cast<size_t>(info.st_size);
+		mMapped = mmap(nullptr, mMappedSize, PROT_READ, MAP_PRIVATE, fd, 0);
+		::close(fd);
+
+		if (mMapped == MAP_FAILED) {
+			mMapped = nullptr;
+			mMappedSize = 0;
+			return false;
+		}
+		madvise(mMapped, mMappedSize, MADV_SEQUENTIAL);
+
+		const uint8_t *bytes = static_cast<const uint8_t*>(mMapped);
+		size_t size = mMappedSize;
+#endif
+
+		if (!parse(bytes, size)) {
+			close();
+			return false;
+		}
+		return true;
+	}
+
+	void close() {
+#ifdef _WIN32
+		mBuffer.clear();
+#else
+		if (mMapped) {
+			munmap(mMapped, mMappedSize);
+		}
+#endif
+		mMapped = nullptr;
+		mMappedSize = 0;
+		mData = nullptr;
+		clearFormat();
+	}
+
+	bool isOpen() const { return mData != nullptr; }
+
+	size_t getNumChannels() const { return mNumChannels; }
+	size_t getNumFrames() const { return mNumFrames; }
+	float getSampleRate() const { return mSampleRate; }
+	WavFormat getFormat() const { return mFormat; }
+	size_t getBytesPerSample() const { return mBytesPerSample; }
+	double getDuration() const { return mSampleRate > 0 ? mNumFrames / static_cast<double>(mSampleRate) : 0; }
+
+	/// raw interleaved samples, starting at frame
+	const uint8_t* getFrame(size_t frame) const { return mData + frame * mNumChannels * mBytesPerSample; }
+
+	/// interleaved floats, numFrames * getNumChannels() of them
+	void read(size_t frame, size_t numFrames, float *output) const {
+		numFrames = clampFrames(frame, numFrames);
+		convert(getFrame(frame), output, numFrames * mNumChannels);
+	}
+
+	/// one buffer of numFrames per channel
+	void read(size_t frame, size_t numFrames, float *const *channels) const {
+
+		numFrames = clampFrames(frame, numFrames);
+		const size_t C = mNumChannels;
+
+		if (C == 1) {
+			read(frame, numFrames, channels[0]);
+			return;
+		}
+
+		// convert a chunk at a time on the stack, then scatter
+		float chunk[CHUNK_SIZE];
+		const size_t framesPerChunk = std::max<size_t>(CHUNK_SIZE / C, 1);
+
+		for (size_t done = 0; done < numFrames; done+= framesPerChunk) {
+			size_t n = std::min(framesPerChunk, numFrames - done);
+			convert(getFrame(frame + done), chunk, n * C);
+			for (size_t c = 0; c < C; c++) {
+				float *output = channels[c] + done;
+				for (size_t i = 0; i < n; i++) {
+					output[i] = chunk[i * C + c];
+				}
+			}
+		}
+	}
+
+	/// average of all channels
+	void readMono(size_t frame, size_t numFrames, float *output) const {
+
+		numFrames = clampFrames(frame, numFrames);
+		const size_t C = mNumChannels;
+
+		if (C == 1) {
+			read(frame, numFrames, output);
+			return;
+		}
+
+		float chunk[CHUNK_SIZE];
+		const size_t framesPerChunk = std::max<size_t>(CHUNK_SIZE / C, 1);
+		const float scale = 1.0f / C;
+
+		for (size_t done = 0; done < numFrames; done+= framesPerChunk) {
+			size_t n = std::min(framesPerChunk, numFrames - done);
+			convert(getFrame(frame + done), chunk, n * C);
+			for (size_t i = 0; i < n; i++) {
+				float sum = 0;
+				for (size_t c = 0; c < C; c++) sum+= chunk[i * C + c];
+				output[done + i] = sum * scale;
+			}
+		}
+	}
+
+	/// blocks of blockSize frames every hopSize frames (blockSize if 0), the last ones can be short
+	BlockRange blocks(size_t blockSize, size_t hopSize=0) const {
+		if (hopSize == 0) hopSize = blockSize;
+		return { BlockIterator(this, 0, blockSize, hopSize), BlockIterator(this, mNumFrames, blockSize, hopSize) };
+	}
+
+protected:
+	enum { CHUNK_SIZE = 2048 };
+
+	void *mMapped;
+	size_t mMappedSize;
+#ifdef _WIN32
+	std::vector<char> mBuffer;
+#endif
+
+	const uint8_t *mData;
+	size_t mNumChannels, mNumFrames, mBytesPerSample;
+	float mSampleRate;
+	WavFormat mFormat;
+
+	void clearFormat() {
+		mNumChannels = mNumFrames = mBytesPerSample = 0;
+		mSampleRate = 0;
+		mFormat = WavFormat::PCM16;
+	}
+
+	size_t clampFrames(size_t frame, size_t numFrames) const {
+		return frame >= mNumFrames ? 0 : std::min(numFrames, mNumFrames - frame);
+	}
+
+	void convert(const uint8_t *input, float *output, size_t N) const {
+		switch (mFormat) {
+			case WavFormat::PCM16:
+				simd::pcm16ToFloat(input, output, N);
+				break;
+			case WavFormat::PCM24:
+				for (size_t i = 0; i < N; i++) {
+					// into the top of an int32 so the sign comes along
+					int32_t v = static_cast<int32_t>(static_cast<uint32_t>(input[3*i]) << 8 |
+													 static_cast<uint32_t>(input[3*i+1]) << 16 |
+													 static_cast<uint32_t>(input[3*i+2]) << 24);
+					output[i] = v * (1.0f / 2147483648.0f);
+				}
+				break;
+			case WavFormat::PCM32:
+				simd::pcm32ToFloat(input, output, N);
+				break;
+			case WavFormat::FLOAT32:
+				std::memcpy(output, input, N * sizeof(float));
+				break;
+		}
+	}
+
+	static uint16_t read16(const uint8_t *p) { return static_cast<uint16_t>(p[0] | p[1] << 8); }
+	static uint32_t read32(const uint8_t *p) { return p[0] | p[1] << 8 | p[2] << 16 | static_cast<uint32_t>(p[3]) << 24; }
+
+	bool parse(const uint8_t *bytes, size_t size) {
+
+		if (size < 12 || std::memcmp(bytes, "RIFF", 4) || std::memcmp(bytes + 8, "WAVE", 4)) return false;
+
+		bool hasFormat = false;
+		size_t position = 12;
+
+		while (position + 8 <= size) {
+
+			const uint8_t *chunk = bytes + position;
+			size_t chunkSize = read32(chunk + 4);
+			const uint8_t *body = chunk + 8;
+			size_t available = size - position - 8;
+
+			if (!std::memcmp(chunk, "fmt ", 4) && chunkSize >= 16 && available >= 16) {
+
+				uint16_t tag = read16(body);
+				mNumChannels = read16(body + 2);
+				mSampleRate = static_cast<float>(read32(body + 4));
+				uint16_t bits = read16(body + 14);
+
+				if (tag == 0xFFFE && chunkSize >= 26 && available >= 26) {
+					// WAVE_FORMAT_EXTENSIBLE, the real tag starts the sub format GUID
+					tag = read16(body + 24);
+				}
+
+				if (tag == 1 && bits == 16) mFormat = WavFormat::PCM16;
+				else if (tag == 1 && bits == 24) mFormat = WavFormat::PCM24;
+				else if (tag == 1 && bits == 32) mFormat = WavFormat::PCM32;
+				else if (tag == 3 && bits == 32) mFormat = WavFormat::FLOAT32;
+				else return false;
+
+				mBytesPerSample = bits / 8;
+				hasFormat = mNumChannels > 0;
+			}
+			else if (!std::memcmp(chunk, "data", 4)) {
+
+				if (!hasFormat) return false;
+
+				// recorders that die mid file leave a wrong (or 0xFFFFFFFF) size, trust the file
+				size_t dataSize = std::min(chunkSize, available);
+				mData = body;
+				mNumFrames = dataSize / (mNumChannels * mBytesPerSample);
+				return true;
+			}
+
+			position+= 8 + chunkSize + (chunkSize & 1);
+		}
+
+		return false;
+	}
+};
+
+
+/// Streams interleaved or per-channel floats to a WAV file, the header is finished off in
+/// close() (or the destructor). Sizes are 32 bit so files stop at 4GB.
+class WavWriter {
+public:
+
+	WavWriter(): mNumChannels(0), mNumFrames(0), mSampleRate(0), mFormat(WavFormat::PCM16) {}
+
+	WavWriter(const std::string &path, float sampleRate, size_t numChannels, WavFormat format=WavFormat::PCM16): WavWriter() {
+		open(path, sampleRate, numChannels, format);
+	}
+
+	~WavWriter() {
+		close();
+	}
+
+	WavWriter(const WavWriter&) = delete;
+	WavWriter& operator=(const WavWriter&) = delete;
+
+	bool open(const std::string &path, float sampleRate, size_t numChannels, WavFormat format=WavFormat::PCM16) {
+
+		close();
+
+		mFile.open(path, std::ios::binary | std::ios::trunc);
+		if (!mFile) return false;
+
+		mSampleRate = sampleRate;
+		mNumChannels = numChannels;
+		mFormat = format;
+		mNumFrames = 0;
+
+		writeHeader();
+		return static_cast<bool>(mFile);
+	}
+
+	bool isOpen() const { return mFile.is_open(); }
+
+	/// numFrames * getNumChannels() interleaved samples
+	void write(const float *interleaved, size_t numFrames) {
+
+		const size_t N = numFrames * mNumChannels;
+		const size_t bytes = getBytesPerSample();
+		mBuffer.resize(N * bytes);
+		uint8_t *out = &mBuffer[0];
+
+		switch (mFormat) {
+			case WavFormat::PCM16:
+				for (size_t i = 0; i < N; i++) {
+					int32_t v = toInteger(interleaved[i], 32768.0);
+					out[2*i] = static_cast<uint8_t>(v);
+					out[2*i+1] = static_cast<uint8_t>(v >> 8);
+				}
+				break;
+			case WavFormat::PCM24:
+				for (size_t i = 0; i < N; i++) {
+					int32_t v = toInteger(interleaved[i], 8388608.0);
+					out[3*i] = static_cast<uint8_t>(v);
+					out[3*i+1] = static_cast<uint8_t>(v >> 8);
+					out[3*i+2] = static_cast<uint8_t>(v >> 16);
+				}
+				break;
+			case WavFormat::PCM32:
+				for (size_t i = 0; i < N; i++) {
+					int32_t v = toInteger(interleaved[i], 2147483648.0);
+					std::memcpy(out + 4*i, &v, 4);
+				}
+				break;
+			case WavFormat::FLOAT32:
+				std::memcpy(out, interleaved, N * sizeof(float));
+				break;
+		}
+
+		mFile.write(reinterpret_cast<const char*>(out), mBuffer.size());
+		mNumFrames+= numFrames;
+	}
+
+	/// one buffer of numFrames per channel
+	void write(const float *const *channels, size_t numFrames) {
+		mInterleaved.resize(numFrames * mNumChannels);
+		for (size_t c = 0; c < mNumChannels; c++) {
+			for (size_t i = 0; i < numFrames; i++) {
+				mInterleaved[i * mNumChannels + c] = channels[c][i];
+			}
+		}
+		write(&mInterleaved[0], numFrames);
+	}
+
+	void close() {
+		if (!mFile.is_open()) return;
+
+		const uint32_t dataSize = static_cast<uint32_t>(mNumFrames * mNumChannels * getBytesPerSample());
+		if (dataSize & 1) mFile.put(0);
+
+		mFile.seekp(4);
+		writeValue<uint32_t>(36 + dataSize + (dataSize & 1));
+		mFile.seekp(40);
+		writeValue<uint32_t>(dataSize);
+		mFile.close();
+	}
+
+	size_t getNumFrames() const { return mNumFrames; }
+	size_t getNumChannels() const { return mNumChannels; }
+	float getSampleRate() const { return mSampleRate; }
+
+protected:
+	std::ofstream mFile;
+	size_t mNumChannels, mNumFrames;
+	float mSampleRate;
+	WavFormat mFormat;
+	std::vector<uint8_t> mBuffer;
+	std::vector<float> mInterleaved;
+
+	size_t getBytesPerSample() const {
+		switch (mFormat) {
+			case WavFormat::PCM16: return 2;
+			case WavFormat::PCM24: return 3;
+			default: return 4;
+		}
+	}
+
+	/// the same power of two scale WavReader divides by, so 1.0 clips to the largest value
+	static int32_t toInteger(float x, double scale) {
+		double v = std::floor(static_cast<double>(x) * scale + 0.5);
+		return static_cast<int32_t>(std::min(std::max(v, -scale), scale - 1.0));
+	}
+
+	template <typename T>
+	void writeValue(T value) {
+		// little endian
+		for (size_t i = 0; i < sizeof(T); i++) {
+			mFile.put(static_cast<char>((value >> (8 * i)) & 0xFF));
+		}
+	}
+
+	void writeHeader() {
+		const uint16_t bits = static_cast<uint16_t>(getBytesPerSample() * 8);
+		const uint16_t blockAlign = static_cast<uint16_t>(mNumChannels * getBytesPerSample());
+
+		mFile.write("RIFF", 4);
+		writeValue<uint32_t>(36);
+		mFile.write("WAVE", 4);
+
+		mFile.write("fmt ", 4);
+		writeValue<uint32_t>(16);
+		writeValue<uint16_t>(mFormat == WavFormat::FLOAT32 ? 3 : 1);
+		writeValue<uint16_t>(static_cast<uint16_t>(mNumChannels));
+		writeValue<uint32_t>(static_cast<uint32_t>(mSampleRate));
+		writeValue<uint32_t>(static_cast<uint32_t>(mSampleRate) * blockAlign);
+		writeValue<uint16_t>(blockAlign);
+		writeValue<uint16_t>(bits);
+
+		mFile.write("data", 4);
+		writeValue<uint32_t>(0);
+	}
+};
+
+
+/// a whole file as mono floats, false if it couldn't be read
+inline bool loadWav(const std::string &path, std::vector<float> &output, float &sampleRate) {
+	WavReader reader(path);
+	if (!reader.isOpen()) return false;
+	output.resize(reader.getNumFrames());
+	reader.readMono(0, reader.getNumFrames(), output.data());
+	sampleRate = reader.getSampleRate();
+	return true;
+}
+
+} // namespace whg